@@ -0,0 +1,7 @@
+# naive doubly recursive fib, exercises non-tail calls
+(defun fib (n)
+    (if (lt n 2)
+        n
+        (add (fib (sub n 1)) (fib (sub n 2)))))
+
+(println (fib 27))
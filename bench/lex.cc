@@ -0,0 +1,86 @@
+#include "../include/lexer.h"
+#include "../include/scan.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+/**
+ * @brief Build a script of roughly "bytes" bytes shaped like generated
+ *        configs: deep indentation, long comments and long string constants.
+ *
+ * @param bytes
+ * @return std::string
+ */
+static auto generate(std::size_t bytes) -> std::string {
+    std::string script;
+    script.reserve(bytes + 256);
+
+    for (std::size_t i = 0; script.size() < bytes; ++i) {
+        script += "# ";
+        script.append(80, '-');
+        script += " entry " + std::to_string(i) + "\n";
+        script.append(4 * (i % 16), ' ');
+        script += "(println\n";
+        script.append(4 * (i % 16) + 8, ' ');
+        script += "\"";
+        script.append(64 + i % 64, 'x');
+        script += "\"\t\t";
+        script += std::to_string(i);
+        script += ")\n\n";
+    }
+    return script;
+}
+
+/**
+ * @brief Tokenize "script" from start to finish and return how many tokens it held.
+ *
+ * @param script
+ * @return std::size_t
+ */
+static auto lex_all(const std::string &script) -> std::size_t {
+    Text text(script);
+    std::size_t count = 0;
+
+    while (parse_token(text).take().type != TokenType::THE_END) {
+        ++count;
+    }
+    return count;
+}
+
+int main(int argc, char *argv[]) {
+    const std::size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64;
+    const auto script = generate(megabytes << 20);
+
+    static const char *const names[] {"scalar", "sse2", "avx2"};
+    double baseline = 0.0;
+
+    for (const auto level : {ScanLevel::SCALAR, ScanLevel::SSE2, ScanLevel::AVX2}) {
+        if (set_scan_level(level) != level) {
+            std::cout << names[static_cast<int>(level)] << ": unsupported\n";
+            continue;
+        }
+
+        double best = 0.0;
+        std::size_t tokens = 0;
+
+        for (int run = 0; run < 5; ++run) {
+            const auto start = std::chrono::steady_clock::now();
+            tokens = lex_all(script);
+            const std::chrono::duration<double> took = std::chrono::steady_clock::now() - start;
+
+            const auto throughput = static_cast<double>(script.size()) / (1 << 20) / took.count();
+            best = throughput > best ? throughput : best;
+        }
+
+        if (level == ScanLevel::SCALAR) {
+            baseline = best;
+        }
+        std::cout << names[static_cast<int>(level)] << ": "
+                  << best << " MB/s, " << tokens << " tokens, "
+                  << best / baseline << "x scalar\n";
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,7 @@
+# tail-recursive countdown run for 10^7 iterations, must not grow the stack
+(defun count (i acc)
+    (if (eq i 0)
+        acc
+        (count (sub i 1) (add acc 1))))
+
+(println (count 10000000 0))
@@ -0,0 +1,99 @@
+#include "../include/builtin.h"
+#include "../include/cache.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+/**
+ * @brief Sum of the result types seen, printed at the end so the
+ *        compiler has to keep every call.
+ */
+static std::size_t checksum = 0;
+
+/**
+ * @brief Call "fn" on "lhs" and "rhs" "count" times and return the
+ *        best time per call over a few runs, in nanoseconds.
+ *
+ * @param fn
+ * @param lhs
+ * @param rhs
+ * @param count
+ * @return double
+ */
+static auto time_builtin(BuiltinFn fn, const Data &lhs, const Data &rhs, std::size_t count) -> double {
+    double best = 0.0;
+
+    for (int run = 0; run < 5; ++run) {
+        Data args[2] {lhs, rhs};
+
+        const auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < count; ++i) {
+            const auto result = fn(Args(args, 2));
+            checksum += static_cast<std::size_t>(result.type);
+        }
+        const std::chrono::duration<double, std::nano> took = std::chrono::steady_clock::now() - start;
+
+        const auto per_call = took.count() / static_cast<double>(count);
+        best = run == 0 || per_call < best ? per_call : best;
+    }
+    return best;
+}
+
+/**
+ * @brief Run "lhs" "op" "rhs" through the inline cache fast path "count"
+ *        times and return the best time per operation over a few runs,
+ *        in nanoseconds, falling back to "fn" like the evaluators do.
+ *
+ * @param fn
+ * @param op
+ * @param lhs
+ * @param rhs
+ * @param count
+ * @return double
+ */
+static auto time_cached(BuiltinFn fn, BinaryOp op, const Data &lhs, const Data &rhs, std::size_t count) -> double {
+    double best = 0.0;
+
+    for (int run = 0; run < 5; ++run) {
+        CallCache cache {CacheState::EMPTY, op, 0, nullptr};
+        Data args[2] {lhs, rhs};
+        Data result;
+
+        const auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < count; ++i) {
+            if (!try_binary(cache, args[0], args[1], result)) {
+                result = fn(Args(args, 2));
+            }
+            checksum += static_cast<std::size_t>(result.type);
+        }
+        const std::chrono::duration<double, std::nano> took = std::chrono::steady_clock::now() - start;
+
+        const auto per_call = took.count() / static_cast<double>(count);
+        best = run == 0 || per_call < best ? per_call : best;
+    }
+    return best;
+}
+
+int main(int argc, char *argv[]) {
+    const std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000000;
+
+    const auto small = Data::from_number(12345);
+    const auto large = Data::from_number(9223372036854775807);
+    const auto real = Data::from_real(1.5);
+    const auto big = Data::from_bignum(BigInt::parse("123456789012345678901234567890"));
+
+    std::cout << "builtin add, small ints:      " << time_builtin(builtin_add, small, small, count) << " ns\n"
+              << "builtin mul, small ints:      " << time_builtin(builtin_mul, small, small, count) << " ns\n"
+              << "builtin add, overflow:        " << time_builtin(builtin_add, large, large, count / 10) << " ns\n"
+              << "builtin add, reals:           " << time_builtin(builtin_add, real, real, count) << " ns\n"
+              << "builtin add, bignums:         " << time_builtin(builtin_add, big, big, count / 10) << " ns\n"
+              << "builtin mul, bignums:         " << time_builtin(builtin_mul, big, big, count / 10) << " ns\n"
+              << "cached add, small ints:       " << time_cached(builtin_add, BinaryOp::ADD, small, small, count) << " ns\n"
+              << "cached mul, small ints:       " << time_cached(builtin_mul, BinaryOp::MUL, small, small, count) << " ns\n"
+              << "cached add, reals:            " << time_cached(builtin_add, BinaryOp::ADD, real, real, count) << " ns\n"
+              << "cached add, overflow:         " << time_cached(builtin_add, BinaryOp::ADD, large, large, count / 10) << " ns\n"
+              << "checksum: " << checksum << '\n';
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,84 @@
+#include "../include/lisp.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string_view>
+
+/**
+ * @brief Lines fed to the interpreter the way a REPL would, most of them
+ *        wrong in a different way. The type error is raised 32 calls deep,
+ *        so handing it back up costs what a real mistake in a program does.
+ */
+static constexpr std::string_view LINES[] = {
+    "(add 1 2",
+    "(define)",
+    "(nope 1 2)",
+    "(deep 1 2)",
+    "(deep 32)",
+    "(div 1 0)",
+    "\"unterminated",
+    "(add (mul 2 3) (sub 10 4))",
+};
+
+/**
+ * @brief Count of lines that failed, printed at the end so the
+ *        compiler has to keep every call.
+ */
+static std::size_t failures = 0;
+
+/**
+ * @brief Return how many of "count" lines "feed" gets through per
+ *        second, best of 5 runs. "feed" is handed each line and
+ *        returns whether it failed.
+ *
+ * @param count
+ * @param feed
+ * @return double
+ */
+static auto lines_per_second(std::size_t count, const auto &feed) -> double {
+    const std::size_t lines = sizeof(LINES) / sizeof(LINES[0]);
+    double best = 0.0;
+
+    for (int run = 0; run < 5; ++run) {
+        const auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < count; ++i) {
+            failures += feed(LINES[i % lines]) ? 1 : 0;
+        }
+        const std::chrono::duration<double> took = std::chrono::steady_clock::now() - start;
+
+        const auto per_second = static_cast<double>(count) / took.count();
+        best = per_second > best ? per_second : best;
+    }
+    return best;
+}
+
+int main(int argc, char *argv[]) {
+    const std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+
+    Config config;
+    config.sinks.out = [](std::string_view) {};
+    config.sinks.err = [](std::string_view) {};
+    Interpreter interpreter(config);
+    interpreter.run("(defun deep (n) (if (eq n 0) (add 1 \"x\") (add 1 (deep (sub n 1)))))");
+
+    // what an embedder that catches does, next to what the REPL does
+    const auto caught = lines_per_second(count, [&](std::string_view line) {
+        try {
+            interpreter.eval(line);
+            return false;
+        }
+        catch (Error &err) {
+            return true;
+        }
+    });
+    const auto handed_back = lines_per_second(count, [&](std::string_view line) {
+        return !interpreter.try_eval(line).ok();
+    });
+
+    std::cout << "repl lines, mostly errors, eval + catch: " << static_cast<std::size_t>(caught) << " lines/s\n"
+              << "repl lines, mostly errors, try_eval:     " << static_cast<std::size_t>(handed_back) << " lines/s\n"
+              << "failures: " << failures << '\n';
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,343 @@
+#include "../include/arena.h"
+#include "../include/builtin.h"
+#include "../include/lexer.h"
+#include "../include/lisp.h"
+#include "../include/parser.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Struct holding one measurement, written out as one entry of the
+ *        JSON report. Names are "group/what" so tools can pick groups apart.
+ */
+struct Measurement final {
+    std::string name;
+    std::string unit;
+    double value;
+};
+
+/**
+ * @brief Struct describing a call to a built-in to time, with each argument
+ *        given as source evaluated once up front.
+ */
+struct BuiltinCase final {
+    BuiltinFn fn;
+    std::vector<std::string_view> args;
+};
+
+/**
+ * @brief Bytes written to the sinks and results seen, printed at the end
+ *        so the compiler has to keep every call.
+ */
+static std::size_t checksum = 0;
+
+/**
+ * @brief Run "op" "count" times in a row and return how long it took, in
+ *        nanoseconds. The form arena is reset first, since most of what is
+ *        measured leaves temporaries in it.
+ *
+ * @param op
+ * @param count
+ * @return double
+ */
+static auto time_batch(auto &&op, std::size_t count) -> double {
+    form_arena().reset();
+
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < count; ++i) {
+        op();
+    }
+    const std::chrono::duration<double, std::nano> took = std::chrono::steady_clock::now() - start;
+    return took.count();
+}
+
+/**
+ * @brief Return the best time per run of "op" over a few batches, in
+ *        nanoseconds. Batches are grown until one takes long enough to be
+ *        timed, so cheap and expensive operations need no tuning of their own.
+ *
+ * @param op
+ * @return double
+ */
+static auto measure(auto &&op) -> double {
+    std::size_t count = 1;
+    while (count < (std::size_t(1) << 30) && time_batch(op, count) < 2e7) {
+        count *= 2;
+    }
+
+    double best = 0.0;
+    for (int run = 0; run < 5; ++run) {
+        const auto per_op = time_batch(op, count) / static_cast<double>(count);
+        best = run == 0 || per_op < best ? per_op : best;
+    }
+    return best;
+}
+
+/**
+ * @brief Return a form adding up "depth" nested calls with "leaf" as every
+ *        operand, like (add 1 (mul 1 ... 1)).
+ *
+ * @param depth
+ * @param leaf
+ * @return std::string
+ */
+static auto nested_form(std::size_t depth, std::string_view leaf) -> std::string {
+    std::string form;
+
+    for (std::size_t i = 0; i < depth; ++i) {
+        form += i % 2 == 0 ? "(add " : "(mul ";
+        form += leaf;
+        form += ' ';
+    }
+    form += leaf;
+    form.append(depth, ')');
+    return form;
+}
+
+/**
+ * @brief Return a form concatenating "width" times "part" in one call.
+ *
+ * @param width
+ * @param part
+ * @return std::string
+ */
+static auto wide_concat_form(std::size_t width, std::string_view part) -> std::string {
+    std::string form = "(concat";
+
+    for (std::size_t i = 0; i < width; ++i) {
+        form += ' ';
+        form += part;
+    }
+    form += ")";
+    return form;
+}
+
+/**
+ * @brief Return the scripts run whole, by name, at "scale" times their
+ *        usual size: deeply nested arithmetic, wide concats, a million
+ *        printlns from a loop and a long stream of small top-level forms.
+ *        Operands are globals rather than literals, since the constant
+ *        folder would otherwise do the work before anything is timed.
+ *
+ * @param scale
+ * @return std::vector<std::pair<std::string, std::string>>
+ */
+static auto generate_scripts(std::size_t scale) -> std::vector<std::pair<std::string, std::string>> {
+    std::vector<std::pair<std::string, std::string>> scripts;
+
+    auto &nested = scripts.emplace_back("nested", "(define one 1)\n").second;
+    for (std::size_t i = 0; i < 200 * scale; ++i) {
+        nested += nested_form(1000, "one") + "\n";
+    }
+
+    auto &concat = scripts.emplace_back("concat", "(define part \"abcdefgh\")\n").second;
+    for (std::size_t i = 0; i < 200 * scale; ++i) {
+        concat += wide_concat_form(2000, "part") + "\n";
+    }
+
+    scripts.emplace_back("println",
+        "(defun emit (i) (println \"line \" i) (if (eq i 0) 0 (emit (sub i 1))))\n"
+        "(emit " + std::to_string(1000000 * scale) + ")\n");
+
+    auto &forms = scripts.emplace_back("forms", "(define one 1)\n").second;
+    for (std::size_t i = 0; i < 200000 * scale; ++i) {
+        forms += "(define x" + std::to_string(i % 1000) + " (add " + std::to_string(i) + " one))\n";
+    }
+    return scripts;
+}
+
+/**
+ * @brief Return the config of an interpreter running on "engine"
+ *        whose output is only counted.
+ *
+ * @param engine
+ * @return Config
+ */
+static auto quiet_config(Engine engine) -> Config {
+    Config config;
+    config.engine = engine;
+    config.sinks.out = [](std::string_view text) { checksum += text.size(); };
+    config.sinks.err = [](std::string_view text) { checksum += text.size(); };
+    return config;
+}
+
+/**
+ * @brief Time the lexer and the parser over generated source, reporting
+ *        the cost per token and per node so the numbers do not depend
+ *        on how much source there was.
+ *
+ * @param results
+ */
+static auto bench_parser(std::vector<Measurement> &results) -> void {
+    std::string source;
+    while (source.size() < (1 << 20)) {
+        source += nested_form(64, "1") + "\n" + wide_concat_form(16, "\"abcdefgh\"") + "\n";
+    }
+
+    std::size_t tokens = 0;
+    for (Text text(source); parse_token(text).take().type != TokenType::THE_END;) {
+        ++tokens;
+    }
+    const auto lex = measure([&] {
+        Text text(source);
+        while (parse_token(text).take().type != TokenType::THE_END) {
+        }
+    });
+    results.push_back({"micro/parse_token", "ns/token", lex / static_cast<double>(tokens)});
+
+    const auto form = nested_form(256, "1");
+    Ast ast;
+    const auto parse = measure([&] {
+        ast.reset();
+        Text text(form);
+        checksum += parse_ast(text, ast).take();
+    });
+    results.push_back({"micro/parse_ast", "ns/node", parse / static_cast<double>(ast.nodes.size())});
+}
+
+/**
+ * @brief Time calls to a small user function on both engines: the tree
+ *        walker's eval_node over its body, and the VM running it compiled.
+ *
+ * @param results
+ */
+static auto bench_eval(std::vector<Measurement> &results) -> void {
+    for (const auto engine : {Engine::TREE, Engine::VM}) {
+        Interpreter interpreter(quiet_config(engine));
+        const auto poly = interpreter.eval("(lambda (x) (if (lt x 0) 0 (add (mul x x) (sub (div x 2) 1))))").persist();
+        const Interpreter::Scope scope(interpreter);
+        Data args[1] {Data::from_number(12345)};
+
+        const auto took = measure([&] {
+            checksum += static_cast<std::size_t>(interpreter.apply(poly, Args(args, 1)).type);
+        });
+        results.push_back({engine == Engine::TREE ? "micro/eval_node" : "micro/vm_run", "ns/call", took});
+    }
+}
+
+/**
+ * @brief Time a call to every built-in with typical arguments,
+ *        vectors of a thousand elements for the vector ones.
+ *
+ * @param results
+ */
+static auto bench_builtins(std::vector<Measurement> &results) -> void {
+    static const BuiltinCase cases[] {
+        {builtin_println, {"\"line\"", "42"}},
+        {builtin_print, {"\"line\"", "42"}},
+        {builtin_eprintln, {"\"line\"", "42"}},
+        {builtin_eprint, {"\"line\"", "42"}},
+        {builtin_concat, {"\"abcdefgh\"", "\"ijklmnop\"", "\"qrstuvwx\""}},
+        {builtin_to_string, {"123456789"}},
+        {builtin_to_number, {"\"123456789\""}},
+        {builtin_add, {"12345", "67890"}},
+        {builtin_sub, {"12345", "67890"}},
+        {builtin_mul, {"12345", "67890"}},
+        {builtin_div, {"67890", "12345"}},
+        {builtin_eq, {"12345", "12345"}},
+        {builtin_lt, {"12345", "67890"}},
+        {builtin_gt, {"12345", "67890"}},
+        {builtin_vec, {"1", "2", "3", "4", "5", "6", "7", "8"}},
+        {builtin_range, {"0", "1000"}},
+        {builtin_vec_add, {"(range 1000)", "(range 1000)"}},
+        {builtin_vec_mul, {"(range 1000)", "(range 1000)"}},
+        {builtin_vec_sum, {"(range 1000)"}},
+        {builtin_vec_dot, {"(range 1000)", "(range 1000)"}},
+        {builtin_pmap, {"(lambda (v) (mul v 2))", "(range 1000)"}},
+        {builtin_pfor_each, {"(lambda (v) (mul v 2))", "(range 1000)"}},
+        {builtin_preduce, {"add", "0", "(range 1000)"}},
+    };
+
+    Interpreter interpreter(quiet_config(Engine::TREE));
+
+    for (const auto &test : cases) {
+        std::vector<Data> args;
+        for (const auto source : test.args) {
+            // only lists are forms, so atoms are evaluated as what a define returns
+            args.push_back(interpreter.eval("(define arg " + std::string(source) + ")").persist());
+        }
+
+        const Interpreter::Scope scope(interpreter);
+        const auto took = measure([&] {
+            checksum += static_cast<std::size_t>(test.fn(Args(args.data(), args.size())).type);
+        });
+        results.push_back({"builtin/" + std::string(builtin_name(test.fn)), "ns/call", took});
+    }
+}
+
+/**
+ * @brief Time running each generated script whole on both engines,
+ *        taking the best of a few runs.
+ *
+ * @param results
+ * @param scale
+ */
+static auto bench_scripts(std::vector<Measurement> &results, std::size_t scale) -> void {
+    for (const auto &[name, source] : generate_scripts(scale)) {
+        for (const auto engine : {Engine::TREE, Engine::VM}) {
+            double best = 0.0;
+
+            for (int run = 0; run < 3; ++run) {
+                Interpreter interpreter(quiet_config(engine));
+
+                const auto start = std::chrono::steady_clock::now();
+                interpreter.run(source);
+                const std::chrono::duration<double, std::milli> took = std::chrono::steady_clock::now() - start;
+
+                best = run == 0 || took.count() < best ? took.count() : best;
+            }
+            results.push_back({"script/" + name + (engine == Engine::TREE ? "/tree" : "/vm"), "ms", best});
+        }
+    }
+}
+
+/**
+ * @brief Write "results" to "os" as a JSON object. Names and units
+ *        are plain ASCII without quotes, so they need no escaping.
+ *
+ * @param os
+ * @param results
+ * @param scale
+ */
+static auto write_json(std::ostream &os, const std::vector<Measurement> &results, std::size_t scale) -> void {
+    os << "{\n"
+       << "  \"version\": 1,\n"
+       << "  \"scale\": " << scale << ",\n"
+       << "  \"results\": [\n";
+
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const auto &result = results[i];
+        os << "    {\"name\": \"" << result.name << "\", \"unit\": \"" << result.unit << "\", \"value\": "
+           << std::fixed << std::setprecision(3) << result.value << '}'
+           << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+
+    os << "  ],\n"
+       << "  \"checksum\": " << checksum << "\n"
+       << "}\n";
+}
+
+int main(int argc, char *argv[]) {
+    const std::size_t scale = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1;
+    std::vector<Measurement> results;
+
+    try {
+        bench_parser(results);
+        bench_eval(results);
+        bench_builtins(results);
+        bench_scripts(results, scale);
+    }
+    catch (const Error &err) {
+        std::cerr << "ERROR: " << err.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    write_json(std::cout, results, scale);
+    return EXIT_SUCCESS;
+}
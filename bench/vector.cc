@@ -0,0 +1,75 @@
+#include "../include/kernel.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+/**
+ * @brief Run "kernel" five times and return the best throughput
+ *        in MB/s, counting "bytes" of memory touched per run.
+ *
+ * @param kernel
+ * @param bytes
+ * @return double
+ */
+static auto best_throughput(auto &&kernel, std::size_t bytes) -> double {
+    double best = 0.0;
+
+    for (int run = 0; run < 5; ++run) {
+        const auto start = std::chrono::steady_clock::now();
+        kernel();
+        const std::chrono::duration<double> took = std::chrono::steady_clock::now() - start;
+
+        const auto throughput = static_cast<double>(bytes) / (1 << 20) / took.count();
+        best = throughput > best ? throughput : best;
+    }
+    return best;
+}
+
+int main(int argc, char *argv[]) {
+    const std::size_t size = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1 << 22;
+
+    std::vector<std::int64_t> ints(size);
+    std::vector<std::int64_t> int_out(size);
+    std::vector<double> reals(size);
+    std::vector<double> real_out(size);
+
+    for (std::size_t i = 0; i < size; ++i) {
+        ints[i] = static_cast<std::int64_t>(i % 1000);
+        reals[i] = static_cast<double>(i % 1000) * 0.5;
+    }
+
+    static const char *const names[] {"scalar", "sse2", "avx2"};
+    const auto bytes = size * sizeof(std::int64_t);
+    std::int64_t int_sum = 0;
+    double real_sum = 0.0;
+
+    for (const auto level : {KernelLevel::SCALAR, KernelLevel::SSE2, KernelLevel::AVX2}) {
+        if (set_kernel_level(level) != level) {
+            std::cout << names[static_cast<int>(level)] << ": unsupported\n";
+            continue;
+        }
+
+        const auto add = best_throughput([&] {
+            add_ints(ints.data(), ints.data(), int_out.data(), size, false);
+        }, 3 * bytes);
+        const auto scale = best_throughput([&] {
+            mul_reals(reals.data(), reals.data(), real_out.data(), size, true);
+        }, 2 * bytes);
+        const auto sum = best_throughput([&] {
+            sum_ints(ints.data(), size, int_sum);
+        }, bytes);
+        const auto dot = best_throughput([&] {
+            real_sum = dot_reals(reals.data(), reals.data(), size);
+        }, 2 * bytes);
+
+        std::cout << names[static_cast<int>(level)] << ": add ints " << add
+                  << " MB/s, scale reals " << scale
+                  << " MB/s, sum ints " << sum
+                  << " MB/s, dot reals " << dot << " MB/s"
+                  << " (sum " << int_sum << ", dot " << real_sum << ")\n";
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,124 @@
+#ifndef LISP_ARENA_H
+#define LISP_ARENA_H
+
+#include <cstddef>
+#include <memory_resource>
+
+/**
+ * @brief Struct representing a region allocator. Allocating bumps a
+ *        pointer through large blocks, freeing does nothing, and reset
+ *        rewinds to the first block in constant time while keeping every
+ *        block for reuse, so a steady workload stops calling malloc.
+ *        It is a memory_resource so std::pmr containers can live in it.
+ */
+struct Arena final : std::pmr::memory_resource {
+    static constexpr std::size_t BLOCK_SIZE = 64 * 1024;
+
+    /**
+     * @brief Construct a new Arena object. No memory is taken until
+     *        the first allocation.
+     */
+    Arena();
+
+    Arena(const Arena&) = delete;
+    auto operator=(const Arena&) -> Arena& = delete;
+
+    /**
+     * @brief Destroy the Arena object and give every block back.
+     */
+    ~Arena() override;
+
+    /**
+     * @brief Forget everything allocated so far. Anything still pointing
+     *        into the arena must be dead before this is called.
+     */
+    auto reset() -> void;
+
+private:
+    struct Block {
+        Block *next;
+        std::size_t size;
+    };
+
+    Block *first;
+    Block *current;
+    std::byte *cursor;
+    std::byte *limit;
+
+    auto do_allocate(std::size_t bytes, std::size_t alignment) -> void* override;
+    auto do_deallocate(void *p, std::size_t bytes, std::size_t alignment) -> void override;
+    auto do_is_equal(const std::pmr::memory_resource &other) const noexcept -> bool override;
+
+    /**
+     * @brief Move on to a block with room for "bytes" bytes, reusing
+     *        the next block if it is big enough and allocating otherwise.
+     *
+     * @param bytes
+     */
+    auto next_block(std::size_t bytes) -> void;
+};
+
+/**
+ * @brief Struct making "arena" the form arena of the calling thread for
+ *        as long as it lives, then putting back the one before it. Each
+ *        interpreter evaluates its forms in an arena of its own this way.
+ */
+struct ArenaScope final {
+    /**
+     * @brief Construct a new ArenaScope object making "arena"
+     *        the form arena of the calling thread.
+     *
+     * @param arena
+     */
+    explicit ArenaScope(Arena &arena);
+
+    ArenaScope(const ArenaScope&) = delete;
+    auto operator=(const ArenaScope&) -> ArenaScope& = delete;
+
+    /**
+     * @brief Destroy the ArenaScope object, putting back the arena before it.
+     */
+    ~ArenaScope();
+
+private:
+    Arena *previous;
+};
+
+/**
+ * @brief Struct lending the calling thread an empty arena for as long as
+ *        it lives and making it the form arena, then putting back the one
+ *        before it. Work run in the middle of a form, like a task run while
+ *        the thread waits for others, resets this one instead of the arena
+ *        the form's temporaries are still in. Each thread keeps the arenas
+ *        it lends and lends them again, so their blocks are reused.
+ */
+struct TaskArena final {
+    /**
+     * @brief Construct a new TaskArena object making an empty
+     *        arena the form arena of the calling thread.
+     */
+    TaskArena();
+
+    TaskArena(const TaskArena&) = delete;
+    auto operator=(const TaskArena&) -> TaskArena& = delete;
+
+    /**
+     * @brief Destroy the TaskArena object, putting back the arena before it.
+     */
+    ~TaskArena();
+
+private:
+    Arena *previous;
+};
+
+/**
+ * @brief Return the arena holding the temporaries of the top-level form
+ *        being evaluated. It is reset before every form and REPL line.
+ *        Each thread has its own, as each one runs its own forms,
+ *        unless an ArenaScope or a TaskArena put another one in its place.
+ *
+ * @return Arena&
+ */
+extern auto form_arena() -> Arena&;
+
+#endif // LISP_ARENA_H
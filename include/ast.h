@@ -0,0 +1,163 @@
+#ifndef LISP_AST_H
+#define LISP_AST_H
+
+#include "node.h"
+#include "intern.h"
+
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <string_view>
+#include <vector>
+
+struct BigInt;
+struct Function;
+
+/**
+ * @brief Struct representing an arena holding abstract syntax trees.
+ *        Nodes sit next to each other in one vector and lists refer to
+ *        a contiguous range of child indices, so walking a tree never
+ *        chases heap pointers and copying a subtree is just its NodeId.
+ *        Where each node starts in the source is kept beside the nodes
+ *        rather than in them, since only errors ever look at it.
+ */
+struct Ast final {
+    // interned strings are kept across forms until there are this many
+    static constexpr std::size_t STRING_POOL_LIMIT = 4096;
+
+    std::vector<Node> nodes;
+    std::vector<std::uint32_t> offsets; // per node, 0 for the ones the parser didn't make
+    std::vector<NodeId> children;
+    StringPool strings;
+    std::vector<Function*> functions; // lifted lambdas, one reference each
+    std::vector<BigInt*> bignums;     // big integer literals, parsed once, one reference each
+    mutable std::vector<CallCache> caches; // written to while the tree runs
+
+    Ast() = default;
+    Ast(const Ast&) = delete;
+    auto operator=(const Ast&) -> Ast& = delete;
+
+    /**
+     * @brief Destroy the Ast object, dropping its references to functions
+     *        and big integers.
+     */
+    ~Ast();
+
+    /**
+     * @brief Append a number node and return its index.
+     *
+     * @param number
+     * @return NodeId
+     */
+    auto add_number(std::int64_t number) -> NodeId;
+
+    /**
+     * @brief Append a real node and return its index.
+     *
+     * @param real
+     * @return NodeId
+     */
+    auto add_real(double real) -> NodeId;
+
+    /**
+     * @brief Append a node for an integer literal too large for a number,
+     *        interning its digits and keeping "value", which must be what
+     *        they spell, and return its index. Takes a reference to "value".
+     *
+     * @param digits
+     * @param value
+     * @return NodeId
+     */
+    auto add_bignum(std::string_view digits, BigInt *value) -> NodeId;
+
+    /**
+     * @brief Append a string node, interning its text, and return its index.
+     *
+     * @param text
+     * @return NodeId
+     */
+    auto add_string(std::string_view text) -> NodeId;
+
+    /**
+     * @brief Append a symbol node, interning its name in the
+     *        global symbol table, and return its index.
+     *
+     * @param name
+     * @return NodeId
+     */
+    auto add_symbol(std::string_view name) -> NodeId;
+
+    /**
+     * @brief Append a list node whose children are the last "count"
+     *        entries pushed onto the scratch stack, and return its index.
+     *
+     * @param count
+     * @return NodeId
+     */
+    auto add_list(std::size_t count) -> NodeId;
+
+    /**
+     * @brief Push a finished child onto the scratch stack
+     *        until the list containing it is closed.
+     *
+     * @param id
+     */
+    auto push_child(NodeId id) -> void;
+
+    /**
+     * @brief Append a copy of the tree under "id" in "from", including what
+     *        the resolver bound it to and where it is in the source, and
+     *        return the index of its root.
+     *
+     * @param from
+     * @param id
+     * @return NodeId
+     */
+    auto copy_tree(const Ast &from, NodeId id) -> NodeId;
+
+    /**
+     * @brief Return the children of the list node "id".
+     *
+     * @param id
+     * @return std::span<const NodeId>
+     */
+    auto children_of(NodeId id) const -> std::span<const NodeId>;
+
+    /**
+     * @brief Return the text of the string, symbol or big integer node "id".
+     *
+     * @param id
+     * @return std::string_view
+     */
+    auto text_of(NodeId id) const -> std::string_view;
+
+    /**
+     * @brief Write the tree under "id" to "os" as an s-expression.
+     *
+     * @param id
+     * @param os
+     */
+    auto print(NodeId id, std::ostream &os) const -> void;
+
+    /**
+     * @brief Drop every node while keeping the allocated storage around
+     *        for the next form. Interned strings are kept too, so literals
+     *        repeated across forms are not allocated again, unless the pool
+     *        has outgrown STRING_POOL_LIMIT. Strings, big integers and
+     *        functions still referenced by values outlive the reset.
+     */
+    auto reset() -> void;
+
+private:
+    std::vector<NodeId> scratch;
+
+    /**
+     * @brief Append "node", with no offset yet, and return its index.
+     *
+     * @param node
+     * @return NodeId
+     */
+    auto append(const Node &node) -> NodeId;
+};
+
+#endif // LISP_AST_H
@@ -0,0 +1,129 @@
+#ifndef LISP_BIGNUM_H
+#define LISP_BIGNUM_H
+
+#include "refcount.h"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Struct representing an immutable, reference counted integer of any
+ *        size, stored as a sign and a magnitude in base 2^32 with the least
+ *        significant limb first. Integers only become one of these once they
+ *        no longer fit in 64 bits, and results that fit again are turned back
+ *        into plain numbers by the callers, so every operation here is off
+ *        the fast path.
+ */
+struct BigInt final {
+    std::uint32_t refs;
+    bool negative;
+    std::vector<std::uint32_t> limbs; // never ends in a zero limb, empty for 0
+
+    /**
+     * @brief Allocate an integer holding "value" with one reference.
+     *
+     * @param value
+     * @return BigInt*
+     */
+    static auto from_int(std::int64_t value) -> BigInt*;
+
+    /**
+     * @brief Allocate an integer holding the decimal "text", which may start
+     *        with a '-', with one reference. Returns null if "text" is not
+     *        a decimal integer.
+     *
+     * @param text
+     * @return BigInt*
+     */
+    static auto parse(std::string_view text) -> BigInt*;
+
+    /**
+     * @brief Return the integer if it fits in 64 bits.
+     *
+     * @return std::optional<std::int64_t>
+     */
+    auto to_int() const -> std::optional<std::int64_t>;
+
+    /**
+     * @brief Return the closest double to the integer.
+     *
+     * @return double
+     */
+    auto to_double() const -> double;
+
+    /**
+     * @brief Return the integer written in decimal.
+     *
+     * @return std::string
+     */
+    auto to_string() const -> std::string;
+
+    /**
+     * @brief Take another reference to the integer.
+     */
+    inline auto retain() -> void {
+        count_up(this->refs);
+    }
+
+    /**
+     * @brief Drop a reference to the integer, freeing it with the last one.
+     */
+    inline auto release() -> void {
+        if (count_down(this->refs)) {
+            delete this;
+        }
+    }
+};
+
+/**
+ * @brief Return a new integer holding "lhs" + "rhs" with one reference.
+ *
+ * @param lhs
+ * @param rhs
+ * @return BigInt*
+ */
+extern auto big_add(const BigInt &lhs, const BigInt &rhs) -> BigInt*;
+
+/**
+ * @brief Return a new integer holding "lhs" - "rhs" with one reference.
+ *
+ * @param lhs
+ * @param rhs
+ * @return BigInt*
+ */
+extern auto big_sub(const BigInt &lhs, const BigInt &rhs) -> BigInt*;
+
+/**
+ * @brief Return a new integer holding "lhs" * "rhs" with one reference.
+ *
+ * @param lhs
+ * @param rhs
+ * @return BigInt*
+ */
+extern auto big_mul(const BigInt &lhs, const BigInt &rhs) -> BigInt*;
+
+/**
+ * @brief Return a new integer holding "lhs" / "rhs" rounded towards zero,
+ *        like the division of built-in integers, with one reference.
+ *        "rhs" must not be zero.
+ *
+ * @param lhs
+ * @param rhs
+ * @return BigInt*
+ */
+extern auto big_div(const BigInt &lhs, const BigInt &rhs) -> BigInt*;
+
+/**
+ * @brief Return a negative number, zero or a positive number
+ *        as "lhs" is less than, equal to or greater than "rhs".
+ *
+ * @param lhs
+ * @param rhs
+ * @return int
+ */
+extern auto big_compare(const BigInt &lhs, const BigInt &rhs) -> int;
+
+#endif // LISP_BIGNUM_H
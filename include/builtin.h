@@ -2,20 +2,68 @@
 #define LISP_BUILTIN_H
 
 #include "data.h"
-#include "node.h"
-
-#include <deque>
-
-extern auto builtin_println(std::deque<Data> &args) -> Node;
-extern auto builtin_print(std::deque<Data> &args) -> Node;
-extern auto builtin_eprintln(std::deque<Data> &args) -> Node;
-extern auto builtin_eprint(std::deque<Data> &args) -> Node;
-extern auto builtin_concat(std::deque<Data> &args) -> Node;
-extern auto builtin_to_string(std::deque<Data> &args) -> Node;
-extern auto builtin_to_number(std::deque<Data> &args) -> Node;
-extern auto builtin_add(std::deque<Data> &args) -> Node;
-extern auto builtin_sub(std::deque<Data> &args) -> Node;
-extern auto builtin_mul(std::deque<Data> &args) -> Node;
-extern auto builtin_div(std::deque<Data> &args) -> Node;
+#include "symbol.h"
+
+#include <string_view>
+
+/**
+ * @brief Return the built-in function named by the symbol "id",
+ *        or nullptr if there is none.
+ *
+ * @param id
+ * @return BuiltinFn
+ */
+extern auto find_builtin(SymbolId id) -> BuiltinFn;
+
+/**
+ * @brief Return the built-in function called "name",
+ *        or nullptr if there is none.
+ *
+ * @param name
+ * @return BuiltinFn
+ */
+extern auto find_builtin(std::string_view name) -> BuiltinFn;
+
+/**
+ * @brief Return whether "fn" is a built-in whose result depends only on
+ *        its arguments and which has no side effects, so calls to it with
+ *        constant arguments can be evaluated ahead of time.
+ *
+ * @param fn
+ * @return bool
+ */
+extern auto is_pure_builtin(BuiltinFn fn) -> bool;
+
+/**
+ * @brief Return the name "fn" is called by, or "?" if it is not a built-in.
+ *
+ * @param fn
+ * @return std::string_view
+ */
+extern auto builtin_name(BuiltinFn fn) -> std::string_view;
+
+extern auto builtin_println(Args args) -> Data;
+extern auto builtin_print(Args args) -> Data;
+extern auto builtin_eprintln(Args args) -> Data;
+extern auto builtin_eprint(Args args) -> Data;
+extern auto builtin_concat(Args args) -> Data;
+extern auto builtin_to_string(Args args) -> Data;
+extern auto builtin_to_number(Args args) -> Data;
+extern auto builtin_add(Args args) -> Data;
+extern auto builtin_sub(Args args) -> Data;
+extern auto builtin_mul(Args args) -> Data;
+extern auto builtin_div(Args args) -> Data;
+extern auto builtin_eq(Args args) -> Data;
+extern auto builtin_lt(Args args) -> Data;
+extern auto builtin_gt(Args args) -> Data;
+extern auto builtin_vec(Args args) -> Data;
+extern auto builtin_range(Args args) -> Data;
+extern auto builtin_vec_add(Args args) -> Data;
+extern auto builtin_vec_mul(Args args) -> Data;
+extern auto builtin_vec_sum(Args args) -> Data;
+extern auto builtin_vec_dot(Args args) -> Data;
+extern auto builtin_pmap(Args args) -> Data;
+extern auto builtin_pfor_each(Args args) -> Data;
+extern auto builtin_preduce(Args args) -> Data;
 
 #endif // LISP_BUILTIN_H
@@ -0,0 +1,134 @@
+#ifndef LISP_BYTECODE_H
+#define LISP_BYTECODE_H
+
+#include "data.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+struct Function;
+
+/**
+ * @brief Enum representing every instruction understood by the VM.
+ *        Operands follow the opcode inline as little-endian values.
+ */
+enum struct OpCode : std::uint8_t {
+    PUSH_CONST,    // u16 constant index
+    CALL_BUILTIN,  // u16 function index, u16 argument count
+    CALL_DYNAMIC,  // u16 argument count, u16 cache, callee sits below the arguments
+    RETURN,
+    POP,
+    LOAD_GLOBAL,   // u32 symbol
+    DEFINE_GLOBAL, // u32 symbol, the value stays on the stack
+    SET_GLOBAL,    // u32 symbol, the value stays on the stack
+    LOAD_LOCAL,    // u16 depth, u16 slot
+    SET_LOCAL,     // u16 depth, u16 slot, the value stays on the stack
+    ENTER_SCOPE,   // u16 slot count, the initial values are popped off the stack
+    LEAVE_SCOPE,
+    JUMP,          // u32 target offset
+    JUMP_IF_FALSE, // u32 target offset, the condition is popped
+    MAKE_CLOSURE,  // u16 lambda index, closes over the current frame
+    TAIL_CALL,     // u16 argument count, u16 cache, like CALL_DYNAMIC but reuses the frame
+    CALL_BINARY,   // u16 function index, u16 cache, two arguments
+};
+
+/**
+ * @brief Struct recording that the instruction at "code" in the stream
+ *        was compiled from the node at "offset" in the source.
+ */
+struct SourceMark final {
+    std::uint32_t code;
+    std::uint32_t offset;
+};
+
+/**
+ * @brief Struct representing a compiled top-level form: the flat
+ *        instruction stream plus the tables its operands index into.
+ */
+struct Chunk final {
+    std::vector<std::uint8_t> code;
+    std::vector<Data> constants;
+    std::vector<BuiltinFn> functions;
+    std::vector<Function*> lambdas; // owned by the Ast the chunk was compiled from
+    CallCache *caches;              // so are the caches of its call sites
+    std::vector<SourceMark> marks;  // of the instructions that can fail, in code order
+
+    /**
+     * @brief Construct a new empty Chunk object.
+     */
+    Chunk();
+
+    /**
+     * @brief Empty the chunk while keeping its storage for the next form.
+     */
+    auto clear() -> void;
+
+    /**
+     * @brief Append an opcode to the instruction stream.
+     *
+     * @param op
+     */
+    auto emit(OpCode op) -> void;
+
+    /**
+     * @brief Append a 16-bit operand to the instruction stream.
+     *        Errors if the operand does not fit.
+     *
+     * @param operand
+     */
+    auto emit_u16(std::size_t operand) -> void;
+
+    /**
+     * @brief Append a 32-bit operand to the instruction stream.
+     *
+     * @param operand
+     */
+    auto emit_u32(std::uint32_t operand) -> void;
+
+    /**
+     * @brief Append a jump whose target is not known yet and
+     *        return where its operand is, for patch_jump.
+     *
+     * @param op
+     * @return std::size_t
+     */
+    auto emit_jump(OpCode op) -> std::size_t;
+
+    /**
+     * @brief Point the jump operand at "at" to the end of the instruction stream.
+     *
+     * @param at
+     */
+    auto patch_jump(std::size_t at) -> void;
+
+    /**
+     * @brief Add a value to the constant pool and return its index.
+     *
+     * @param value
+     * @return std::size_t
+     */
+    auto add_constant(const Data &value) -> std::size_t;
+
+    /**
+     * @brief Record that the next instruction appended was
+     *        compiled from the node at "offset" in the source.
+     *
+     * @param offset
+     */
+    auto mark(std::uint32_t offset) -> void;
+
+    /**
+     * @brief Return the offset in the source of the last marked instruction
+     *        starting before "at" in the instruction stream, if there is one.
+     *        Handlers have read their operands by the time they fail, so "at"
+     *        is anywhere past the opcode of the instruction that did.
+     *
+     * @param at
+     * @return std::optional<std::uint32_t>
+     */
+    auto source_of(std::size_t at) const -> std::optional<std::uint32_t>;
+};
+
+#endif // LISP_BYTECODE_H
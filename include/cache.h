@@ -0,0 +1,77 @@
+#ifndef LISP_CACHE_H
+#define LISP_CACHE_H
+
+#include "ast.h"
+#include "data.h"
+#include "node.h"
+#include "number.h"
+#include "refcount.h"
+#include "symbol.h"
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief Give a cache to every call site under "root" that can make use
+ *        of one, outside of lambdas since they have their own Ast, and
+ *        point Node::slot of each site at it or at NO_CACHE.
+ *
+ * @param ast
+ * @param root
+ */
+extern auto attach_caches(Ast &ast, NodeId root) -> void;
+
+/**
+ * @brief Try the fast path of the arithmetic site cached by "cache" on
+ *        "lhs" and "rhs", storing the result in "result". Two numbers or
+ *        two reals take it, and the first time anything else shows up the
+ *        site gives up for good. False is returned whenever the caller has
+ *        to take the generic path, which includes numbers that overflow;
+ *        those stay on the fast path since the next call most likely fits.
+ *
+ * @param cache
+ * @param lhs
+ * @param rhs
+ * @param result
+ * @return bool
+ */
+inline auto try_binary(CallCache &cache, const Data &lhs, const Data &rhs, Data &result) -> bool {
+    // sites in the body of a function can run on several threads at once;
+    // any interleaving of the two states is fine, a torn write is not
+    const std::atomic_ref<CacheState> state(cache.state);
+
+    if (state.load(std::memory_order_relaxed) != CacheState::MEGAMORPHIC) {
+        if (lhs.type == DataType::NUMBER && rhs.type == DataType::NUMBER) {
+            std::int64_t value;
+            if (!int_binary(cache.op, lhs.number, rhs.number, value)) {
+                return false;
+            }
+            state.store(CacheState::MONOMORPHIC, std::memory_order_relaxed);
+            result = Data::from_number(value);
+            return true;
+        }
+        if (lhs.type == DataType::REAL && rhs.type == DataType::REAL) {
+            state.store(CacheState::MONOMORPHIC, std::memory_order_relaxed);
+            result = real_binary(cache.op, lhs.real, rhs.real);
+            return true;
+        }
+    }
+    state.store(CacheState::MEGAMORPHIC, std::memory_order_relaxed);
+    return false;
+}
+
+/**
+ * @brief Return the built-in named by "head" at the dynamic call site cached
+ *        by "cache", or null if it names none, raising an error first if it
+ *        is not a name at all. Symbols are looked up by name once per site
+ *        and only again when the site sees another symbol. Once threads
+ *        share values the cache is left alone, since the symbol and the
+ *        built-in it names could not be updated together.
+ *
+ * @param cache
+ * @param head
+ * @return BuiltinFn
+ */
+extern auto lookup_cached(CallCache &cache, const Data &head) -> BuiltinFn;
+
+#endif // LISP_CACHE_H
@@ -0,0 +1,41 @@
+#ifndef LISP_COMPILER_H
+#define LISP_COMPILER_H
+
+#include "bytecode.h"
+#include "ast.h"
+#include "node.h"
+
+struct Function;
+
+/**
+ * @brief Lower the abstract syntax tree of a top-level form
+ *        into bytecode that can be executed by the VM. The
+ *        previous contents of "chunk" are replaced. Calls and
+ *        assignments are marked with where they are in the source.
+ *
+ * @param ast
+ * @param root
+ * @param chunk
+ */
+extern auto compile(const Ast &ast, NodeId root, Chunk &chunk) -> void;
+
+/**
+ * @brief Lower the body of "function" into its own chunk. Calls in
+ *        tail position reuse the frame of the function instead of
+ *        pushing a new one, so tail recursion runs in constant space.
+ *
+ * @param function
+ */
+extern auto compile_function(Function &function) -> void;
+
+/**
+ * @brief Return the chunk of "function", compiling its body the first
+ *        time. Threads sharing the function compile it once between them,
+ *        and a body that fails to compile is tried again on the next call.
+ *
+ * @param function
+ * @return const Chunk&
+ */
+extern auto function_chunk(Function &function) -> const Chunk&;
+
+#endif // LISP_COMPILER_H
@@ -1,42 +1,373 @@
 #ifndef LISP_DATA_H
 #define LISP_DATA_H
 
+#include "ast.h"
+#include "bignum.h"
+#include "error.h"
 #include "node.h"
+#include "object.h"
+#include "symbol.h"
 
 #include <cstdint>
-#include <variant>
-#include <string>
+#include <ostream>
+#include <string_view>
+#include <utility>
 
 /**
- * @brief Enum representing the three types of values
+ * @brief Enum representing the types of values
  *        that can be returned by a function.
+ *        Types stored inline come first, the ones
+ *        held by reference count from STRING on.
  */
 enum struct DataType : std::uint8_t {
-    NUMBER,
-    STRING,
+    NUMBER, // 64 bit integer
     SYMBOL,
+    REAL,
+    STRING,
+    CLOSURE,
+    BIGNUM, // integer that does not fit in a NUMBER
+    VECTOR,
+    ROPE, // string made of other strings, see Rope
 };
 
 /**
  * @brief Struct representing the physical wrapper around
  *        a value that can be returned by a function.
+ *        It is a 16 byte tag plus payload: numbers, reals and symbols
+ *        are stored inline, strings, ropes, closures, big integers and
+ *        vectors are shared by reference count, so copying a value never
+ *        copies characters or elements.
  */
 struct Data final {
     DataType type;
-    std::variant<int, std::string> value;
+    union {
+        std::int64_t number;
+        double real;
+        SymbolId symbol;
+        String *string;
+        Closure *closure;
+        BigInt *bignum;
+        Vector *vector;
+        Rope *rope;
+    };
 
     /**
      * @brief Construct a new Data object.
      */
-    Data();
-    Data(DataType type, const auto &value);
+    inline Data()
+        : type(DataType::NUMBER), number(0) {
+    }
+
+    inline Data(const Data &other)
+        : type(other.type), string(other.string) {
+        this->retain();
+    }
+
+    inline Data(Data &&other) noexcept
+        : type(other.type), string(other.string) {
+        other.type = DataType::NUMBER;
+        other.number = 0;
+    }
+
+    inline auto operator=(const Data &other) -> Data& {
+        Data copy(other);
+        this->swap(copy);
+        return *this;
+    }
+
+    inline auto operator=(Data &&other) noexcept -> Data& {
+        Data moved(std::move(other));
+        this->swap(moved);
+        return *this;
+    }
+
+    /**
+     * @brief Destroy the Data object, dropping its reference if it holds one.
+     */
+    inline ~Data() {
+        if (this->type >= DataType::STRING) {
+            this->release();
+        }
+    }
+
+    /**
+     * @brief Return a number value.
+     *
+     * @param number
+     * @return Data
+     */
+    static auto from_number(std::int64_t number) -> Data;
+
+    /**
+     * @brief Return a real value.
+     *
+     * @param real
+     * @return Data
+     */
+    static auto from_real(double real) -> Data;
+
+    /**
+     * @brief Return an integer value taking over the reference held on
+     *        "bignum", or a plain number if it fits in one, in which case
+     *        the reference is dropped.
+     *
+     * @param bignum
+     * @return Data
+     */
+    static auto from_bignum(BigInt *bignum) -> Data;
+
+    /**
+     * @brief Return a string value taking over the reference held on "rope".
+     *
+     * @param rope
+     * @return Data
+     */
+    static auto from_rope(Rope *rope) -> Data;
+
+    /**
+     * @brief Return a vector value taking over the reference held on "vector".
+     *
+     * @param vector
+     * @return Data
+     */
+    static auto from_vector(Vector *vector) -> Data;
+
+    /**
+     * @brief Return a string value taking over the reference held on "string".
+     *
+     * @param string
+     * @return Data
+     */
+    static auto from_string(String *string) -> Data;
+
+    /**
+     * @brief Return a string value holding a new copy of "text".
+     *
+     * @param text
+     * @return Data
+     */
+    static auto from_text(std::string_view text) -> Data;
+
+    /**
+     * @brief Return a symbol value.
+     *
+     * @param symbol
+     * @return Data
+     */
+    static auto from_symbol(SymbolId symbol) -> Data;
+
+    /**
+     * @brief Return a function value taking over the reference held on "closure".
+     *
+     * @param closure
+     * @return Data
+     */
+    static auto from_closure(Closure *closure) -> Data;
+
+    /**
+     * @brief Return the number held, erroring if this is not a number
+     *        that fits in 64 bits.
+     *
+     * @return std::int64_t
+     */
+    inline auto as_number() const -> std::int64_t {
+        if (this->type != DataType::NUMBER) {
+            this->mismatch("number");
+        }
+        return this->number;
+    }
+
+    /**
+     * @brief Return whether the value is a number of any kind.
+     *
+     * @return bool
+     */
+    inline auto is_numeric() const -> bool {
+        return this->type == DataType::NUMBER || this->type == DataType::REAL
+            || this->type == DataType::BIGNUM;
+    }
+
+    /**
+     * @brief Return the vector held, erroring if this is not a vector.
+     *
+     * @return const Vector&
+     */
+    inline auto as_vector() const -> const Vector& {
+        if (this->type != DataType::VECTOR) {
+            this->mismatch("vector");
+        }
+        return *this->vector;
+    }
+
+    /**
+     * @brief Return whether the value is a string, flat or not.
+     *
+     * @return bool
+     */
+    inline auto is_string() const -> bool {
+        return this->type == DataType::STRING || this->type == DataType::ROPE;
+    }
+
+    /**
+     * @brief Return the characters of the string held,
+     *        erroring if this is not a string. Ropes are
+     *        put together in one piece the first time.
+     *
+     * @return std::string_view
+     */
+    inline auto as_string() const -> std::string_view {
+        if (this->type == DataType::STRING) {
+            return this->string->view();
+        }
+        if (this->type != DataType::ROPE) {
+            this->mismatch("string");
+        }
+        return this->rope->view();
+    }
+
+    /**
+     * @brief Return the name of the string or symbol held,
+     *        erroring if this is neither.
+     *
+     * @return std::string_view
+     */
+    auto as_name() const -> std::string_view;
+
+    /**
+     * @brief Return whether the value counts as true in a condition.
+     *        Only the number 0 is false, written either way.
+     *
+     * @return bool
+     */
+    inline auto is_truthy() const -> bool {
+        if (this->type == DataType::NUMBER) {
+            return this->number != 0;
+        }
+        return this->type != DataType::REAL || this->real != 0.0;
+    }
+
+    /**
+     * @brief Return a copy of the value that is safe to keep once the
+     *        current form is over: pinned strings living in the form
+     *        arena are copied to the heap, everything else is shared,
+     *        ropes included since their parts are never pinned.
+     *
+     * @return Data
+     */
+    auto persist() const -> Data;
+
+    /**
+     * @brief Error because a value of type "expected" was needed instead.
+     *
+     * @param expected
+     */
+    [[noreturn]] auto mismatch(const char *expected) const -> void;
+
+    /**
+     * @brief Raise the error mismatch throws instead of throwing it,
+     *        and return what a builtin that failed returns.
+     *
+     * @param expected
+     * @return Data
+     */
+    auto reject(const char *expected) const -> Data;
+
+private:
+    inline auto retain() const -> void {
+        switch (this->type) {
+            case DataType::STRING:
+                return this->string->retain();
+
+            case DataType::CLOSURE:
+                return this->closure->retain();
+
+            case DataType::BIGNUM:
+                return this->bignum->retain();
+
+            case DataType::VECTOR:
+                return this->vector->retain();
+
+            case DataType::ROPE:
+                return this->rope->retain();
+
+            default:
+                return;
+        }
+    }
+
+    inline auto release() const -> void {
+        switch (this->type) {
+            case DataType::STRING:
+                return this->string->release();
+
+            case DataType::CLOSURE:
+                return this->closure->release();
+
+            case DataType::BIGNUM:
+                return this->bignum->release();
+
+            case DataType::VECTOR:
+                return this->vector->release();
+
+            case DataType::ROPE:
+                return this->rope->release();
+
+            default:
+                return;
+        }
+    }
+
+    inline auto swap(Data &other) noexcept -> void {
+        std::swap(this->type, other.type);
+        std::swap(this->string, other.string);
+    }
 };
 
+static_assert(sizeof(Data) == 16, "Data is meant to stay a two word value");
+
+/**
+ * @brief Raise Error of the kind "code" with desc as its description
+ *        on the calling thread, and return what a builtin that failed
+ *        returns, which nobody should look at.
+ *
+ * @param code
+ * @param desc
+ * @return Data
+ */
+__attribute__((cold)) inline auto fail(ErrorCode code, const auto& ...desc) -> Data {
+    raise_error(Error(code, desc...));
+    return Data();
+}
+
+/**
+ * @brief Raise Error of the kind "code" with desc as its description,
+ *        located at "offset" in the source, like fail.
+ *
+ * @param offset
+ * @param code
+ * @param desc
+ * @return Data
+ */
+__attribute__((cold)) inline auto fail_at(std::size_t offset, ErrorCode code, const auto& ...desc) -> Data {
+    raise_error(error_at(offset, code, desc...));
+    return Data();
+}
+
+/**
+ * @brief Write "data" the way print shows it.
+ *
+ * @param os
+ * @param data
+ * @return std::ostream&
+ */
+extern auto operator<<(std::ostream &os, const Data &data) -> std::ostream&;
+
 /**
- * @brief Take a node and return its Data equivalent.
+ * @brief Take a node of "ast" and return its Data equivalent.
  *
- * @param node
+ * @param ast
+ * @param id
  * @return Data
  */
-extern auto convert_to_data(const Node &node) -> Data;
+extern auto convert_to_data(const Ast &ast, NodeId id) -> Data;
 #endif // LISP_DATA_H
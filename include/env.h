@@ -0,0 +1,199 @@
+#ifndef LISP_ENV_H
+#define LISP_ENV_H
+
+#include "data.h"
+#include "refcount.h"
+#include "symbol.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief How many calls of pmap, pfor-each or preduce deep the calling
+ *        thread is running, 0 outside of them. Frames remember the level
+ *        they were made at. Whatever was made at a lower level may be in
+ *        use by other threads at the same time, so only frames of the
+ *        current level can be assigned to, and globals only at level 0.
+ */
+inline thread_local std::uint16_t task_level = 0;
+
+/**
+ * @brief Struct setting the task level of the calling thread for as
+ *        long as it lives, then putting back the level before it.
+ */
+struct TaskLevel final {
+    /**
+     * @brief Construct a new TaskLevel object setting the
+     *        task level of the calling thread to "level".
+     *
+     * @param level
+     */
+    explicit TaskLevel(std::uint16_t level);
+
+    TaskLevel(const TaskLevel&) = delete;
+    auto operator=(const TaskLevel&) -> TaskLevel& = delete;
+
+    /**
+     * @brief Destroy the TaskLevel object, putting back the level before it.
+     */
+    ~TaskLevel();
+
+private:
+    std::uint16_t previous;
+};
+
+/**
+ * @brief Struct representing one frame of local variables, created each
+ *        time a scope is entered. The resolver has already turned every
+ *        local name into a (depth, slot) pair, so a lookup walks "depth"
+ *        parents and indexes an array. The slots are stored right after
+ *        the header in the same allocation and frames are reference
+ *        counted, since closures can keep them alive past their scope.
+ */
+struct Env final {
+    std::uint32_t refs;
+    std::uint16_t size;  // the resolver allows no more slots than this holds
+    std::uint16_t level; // the task level it was made at
+    Env *parent;
+
+    /**
+     * @brief Allocate a frame of "size" slots holding numbers with one
+     *        reference, taking a reference to "parent" if it is not null.
+     *
+     * @param size
+     * @param parent
+     * @return Env*
+     */
+    static auto make(std::size_t size, Env *parent) -> Env*;
+
+    /**
+     * @brief Return the slots of the frame.
+     *
+     * @return Data*
+     */
+    inline auto slots() -> Data* {
+        return reinterpret_cast<Data*>(this + 1);
+    }
+
+    /**
+     * @brief Return slot "slot" of the frame "depth" parents up.
+     *
+     * @param depth
+     * @param slot
+     * @return Data&
+     */
+    inline auto at(std::size_t depth, std::size_t slot) -> Data& {
+        auto env = this;
+        while (depth-- != 0) {
+            env = env->parent;
+        }
+        return env->slots()[slot];
+    }
+
+    /**
+     * @brief Store "value" in slot "slot" of the frame "depth" parents up,
+     *        raising an error instead if the frame was made at a lower
+     *        task level.
+     *
+     * @param depth
+     * @param slot
+     * @param value
+     */
+    inline auto assign_at(std::size_t depth, std::size_t slot, Data value) -> void {
+        auto env = this;
+        while (depth-- != 0) {
+            env = env->parent;
+        }
+        if (env->level != task_level) [[unlikely]] {
+            return Env::refuse_assign();
+        }
+        env->slots()[slot] = std::move(value);
+    }
+
+    /**
+     * @brief Take another reference to the frame.
+     */
+    inline auto retain() -> void {
+        count_up(this->refs);
+    }
+
+    /**
+     * @brief Drop a reference to the frame, freeing it and
+     *        dropping its parent with the last one.
+     */
+    inline auto release() -> void {
+        if (count_down(this->refs)) {
+            Env::destroy(this);
+        }
+    }
+
+private:
+    /**
+     * @brief Free "env" once nothing refers to it anymore.
+     *
+     * @param env
+     */
+    static auto destroy(Env *env) -> void;
+
+    /**
+     * @brief Raise an error about assigning to a variable
+     *        that other tasks may share.
+     */
+    static auto refuse_assign() -> void;
+};
+
+/**
+ * @brief Struct representing the global variables. Symbol ids are dense,
+ *        so the table is indexed by them directly instead of by name.
+ *        Reading a symbol that has never been defined gives back the
+ *        symbol itself, which is what bare symbols evaluated to before
+ *        variables existed.
+ */
+struct Globals final {
+    /**
+     * @brief Return the value bound to "symbol", or the symbol itself if unbound.
+     *
+     * @param symbol
+     * @return Data
+     */
+    inline auto get(SymbolId symbol) const -> Data {
+        if (symbol < this->bound.size() && this->bound[symbol]) {
+            return this->values[symbol];
+        }
+        return Data::from_symbol(symbol);
+    }
+
+    /**
+     * @brief Bind "symbol" to "value", replacing any previous value.
+     *        Only allowed at task level 0, raising an error elsewhere.
+     *
+     * @param symbol
+     * @param value
+     */
+    auto define(SymbolId symbol, Data value) -> void;
+
+    /**
+     * @brief Replace the value of "symbol", raising an error if it was never
+     *        defined. Only allowed at task level 0, raising an error elsewhere.
+     *
+     * @param symbol
+     * @param value
+     */
+    auto assign(SymbolId symbol, Data value) -> void;
+
+    /**
+     * @brief Make room for the symbols with ids below "count" up front, so
+     *        defining them never moves the table. Threads running forms
+     *        that touch different globals can then share it without a lock.
+     *
+     * @param count
+     */
+    auto reserve(std::size_t count) -> void;
+
+private:
+    std::vector<Data> values;
+    std::vector<std::uint8_t> bound;
+};
+
+#endif // LISP_ENV_H
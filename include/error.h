@@ -3,23 +3,54 @@
 
 #include <string>
 #include <exception>
-#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <utility>
+
+/**
+ * @brief Enum representing what kind of failure an error reports, so
+ *        callers can tell them apart without looking at the message.
+ */
+enum struct ErrorCode : std::uint8_t {
+    RUNTIME,    // anything else going wrong while a form runs
+    SYNTAX,     // text that is not a well formed form
+    INCOMPLETE, // input that ends in the middle of a form
+    NAME,       // a function or variable that does not exist or can't be used so
+    ARITY,      // a call with the wrong number of arguments
+    TYPE,       // an argument of the wrong type
+    VALUE,      // an argument of the right type the call can't do anything with
+    LIMIT,      // something larger than the interpreter can represent
+    IO,         // a file that can't be opened
+};
 
 /**
  * @brief Struct representing an error with a descriptive message.
  *        Used for error handling when parsing and evaluating code.
+ *        It carries where in the source it happened as a byte offset,
+ *        turned into a line and a column only once it is reported.
  */
 struct Error final : public std::exception {
+    /**
+     * @brief Construct a new Error object of the kind "code".
+     *
+     * @param code
+     * @param desc
+     */
+    inline Error(ErrorCode code, const auto& ...desc)
+        : error_code(code), source_offset(NO_OFFSET), source_line(0), source_column(0) {
+        // appended in place rather than each made into a string first
+        ((this->desc += desc), ...);
+    }
+
     /**
      * @brief Construct a new Error object.
      *
      * @param desc
      */
-    inline Error(const auto& ...desc) {
-        std::array<std::string, sizeof...(desc)> unpacked = {desc...};
-        for (const auto &v : unpacked) {
-            this->desc += v;
-        }
+    inline Error(const auto& ...desc)
+        : Error(ErrorCode::RUNTIME, desc...) {
     }
 
     /**
@@ -29,8 +60,61 @@ struct Error final : public std::exception {
      */
     auto what() const noexcept(true) -> const char* override;
 
+    /**
+     * @brief Return what kind of failure the error reports.
+     *
+     * @return ErrorCode
+     */
+    auto code() const -> ErrorCode;
+
+    /**
+     * @brief Return the offset in the source of the code that failed,
+     *        if it is known.
+     *
+     * @return std::optional<std::size_t>
+     */
+    auto offset() const -> std::optional<std::size_t>;
+
+    /**
+     * @brief Record that the error happened at "offset" in the source,
+     *        unless code closer to where it happened already did.
+     *
+     * @param offset
+     */
+    auto locate(std::size_t offset) -> void;
+
+    /**
+     * @brief Return the line the error happened on, counting from 1,
+     *        or 0 if it has not been placed.
+     *
+     * @return std::size_t
+     */
+    auto line() const -> std::size_t;
+
+    /**
+     * @brief Return the column the error happened at, counting from 1,
+     *        or 0 if it has not been placed.
+     *
+     * @return std::size_t
+     */
+    auto column() const -> std::size_t;
+
+    /**
+     * @brief Record the line and column the offset of the error is at,
+     *        worked out by whoever holds the source it refers to.
+     *
+     * @param line
+     * @param column
+     */
+    auto place(std::size_t line, std::size_t column) -> void;
+
 private:
+    static constexpr std::size_t NO_OFFSET = std::numeric_limits<std::size_t>::max();
+
     std::string desc;
+    ErrorCode error_code;
+    std::size_t source_offset;
+    std::size_t source_line, source_column;
 };
 
 /**
@@ -38,8 +122,81 @@ private:
  *
  * @param desc
  */
-inline auto quit(const auto& ...desc) -> void {
+[[noreturn]] inline auto quit(const auto& ...desc) -> void {
     throw Error(desc...);
 }
 
+/**
+ * @brief Throw Error of the kind "code" with desc as its description.
+ *
+ * @param code
+ * @param desc
+ */
+[[noreturn]] inline auto quit(ErrorCode code, const auto& ...desc) -> void {
+    throw Error(code, desc...);
+}
+
+/**
+ * @brief Return Error of the kind "code" with desc as its description,
+ *        located at "offset" in the source, for code that hands errors
+ *        back instead of throwing them.
+ *
+ * @param offset
+ * @param code
+ * @param desc
+ * @return Error
+ */
+inline auto error_at(std::size_t offset, ErrorCode code, const auto& ...desc) -> Error {
+    Error error(code, desc...);
+    error.locate(offset);
+    return error;
+}
+
+/**
+ * @brief Throw Error of the kind "code" with desc as its
+ *        description, located at "offset" in the source.
+ *
+ * @param offset
+ * @param code
+ * @param desc
+ */
+[[noreturn]] inline auto quit_at(std::size_t offset, ErrorCode code, const auto& ...desc) -> void {
+    throw error_at(offset, code, desc...);
+}
+
+/**
+ * @brief The error raised on the calling thread that nobody took yet, or
+ *        null. Builtins, globals and the tree-walker raise their errors here
+ *        instead of throwing them and return as if nothing happened, and
+ *        what runs them only looks at it at call boundaries. A pointer, so
+ *        looking costs a load from thread-local storage and nothing more.
+ */
+inline thread_local Error *raised_error = nullptr;
+
+/**
+ * @brief Raise "error" on the calling thread without throwing it. An error
+ *        raised earlier and not taken yet is kept instead, as whatever
+ *        failed after it only did so because of it.
+ *
+ * @param error
+ */
+__attribute__((cold)) inline auto raise_error(Error error) -> void {
+    if (raised_error == nullptr) {
+        raised_error = new Error(std::move(error));
+    }
+}
+
+/**
+ * @brief Return the error raised on the calling thread,
+ *        which there has to be, and clear it.
+ *
+ * @return Error
+ */
+inline auto take_raised_error() -> Error {
+    Error error = std::move(*raised_error);
+    delete raised_error;
+    raised_error = nullptr;
+    return error;
+}
+
 #endif // LISP_ERROR_H
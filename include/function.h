@@ -0,0 +1,77 @@
+#ifndef LISP_FUNCTION_H
+#define LISP_FUNCTION_H
+
+#include "ast.h"
+#include "bytecode.h"
+#include "node.h"
+#include "refcount.h"
+#include "symbol.h"
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+
+/**
+ * @brief Calls of user functions a thread may be inside of at once, not
+ *        counting tail calls. Both engines stop there with a LIMIT error
+ *        instead of running out of native stack or of memory.
+ */
+static constexpr std::size_t MAX_CALL_DEPTH = 10000;
+
+/**
+ * @brief Struct representing the code of a lambda or defun. The Ast of a
+ *        form is reset once the form has run, but closures made from it can
+ *        be called later, so the body is copied into a small Ast owned by the
+ *        function. Every closure made from the same lambda shares it. The
+ *        VM compiles the body into "chunk" the first time it is called,
+ *        and "compiled" is set once it has.
+ */
+struct Function final {
+    std::uint32_t refs;
+    std::uint16_t arity;
+    std::optional<SymbolId> name; // set for defun
+    Ast ast;
+    NodeId body; // list holding the expressions of the body
+    Chunk chunk;
+    std::atomic<bool> compiled {false};
+
+    /**
+     * @brief Allocate a function with one reference holding a copy of
+     *        the lambda or defun "id" of "from", which must be resolved.
+     *        Lambdas nested inside of it are lifted into its own Ast
+     *        and its call sites get caches of their own.
+     *
+     * @param from
+     * @param id
+     * @return Function*
+     */
+    static auto make(const Ast &from, NodeId id) -> Function*;
+
+    /**
+     * @brief Take another reference to the function.
+     */
+    inline auto retain() -> void {
+        count_up(this->refs);
+    }
+
+    /**
+     * @brief Drop a reference to the function, freeing it with the last one.
+     */
+    inline auto release() -> void {
+        if (count_down(this->refs)) {
+            delete this;
+        }
+    }
+};
+
+/**
+ * @brief Make a Function out of every outermost lambda and defun under
+ *        "root", add it to the functions of "ast" and point the node at it.
+ *        Runs after the tree has been resolved and folded.
+ *
+ * @param ast
+ * @param root
+ */
+extern auto lift_functions(Ast &ast, NodeId root) -> void;
+
+#endif // LISP_FUNCTION_H
@@ -0,0 +1,145 @@
+#ifndef LISP_IMAGE_H
+#define LISP_IMAGE_H
+
+#include "ast.h"
+#include "node.h"
+#include "source.h"
+#include "symbol.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Return the hash compiled images of "text" are keyed on.
+ *
+ * @param text
+ * @return std::uint64_t
+ */
+extern auto hash_source(std::string_view text) -> std::uint64_t;
+
+/**
+ * @brief Struct collecting the top-level forms of a script once prepared,
+ *        lifted functions and call site caches included, to be saved as a
+ *        compiled image of it. Symbols are saved by name and built-ins by
+ *        the name they are called by, so an image holds no pointers or ids
+ *        that only mean something to the process that wrote it.
+ */
+struct ImageWriter final {
+    /**
+     * @brief Construct a new ImageWriter object with no forms.
+     */
+    ImageWriter();
+
+    /**
+     * @brief Add the prepared top-level form "root", the only form
+     *        in "ast", after the ones added so far.
+     *
+     * @param ast
+     * @param root
+     */
+    auto add(const Ast &ast, NodeId root) -> void;
+
+    /**
+     * @brief Save the forms added so far as the image of a source of
+     *        "size" bytes hashing to "hash" in the directory "dir", made
+     *        if need be. Returns false if it could not be written, which
+     *        only means the next run parses the script again.
+     *
+     * @param dir
+     * @param hash
+     * @param size
+     * @return bool
+     */
+    auto save(const std::string &dir, std::uint64_t hash, std::size_t size) const -> bool;
+
+private:
+    std::string forms;                       // every form added, encoded
+    std::uint32_t count;                     // how many forms there are
+    std::vector<SymbolId> symbols;           // the symbols used, in the order they were met
+    std::vector<std::uint32_t> symbol_index; // per symbol id, its index in "symbols"
+
+    /**
+     * @brief Append "ast" to the forms, along with the functions lifted into it.
+     *
+     * @param ast
+     */
+    auto write_ast(const Ast &ast) -> void;
+
+    /**
+     * @brief Return the index of "symbol" in the image, giving it one if need be.
+     *
+     * @param symbol
+     * @return std::uint32_t
+     */
+    auto symbol_of(SymbolId symbol) -> std::uint32_t;
+};
+
+/**
+ * @brief Struct representing a compiled image of a script, mapped into
+ *        memory and checked once when opened, then handing out its forms
+ *        one by one, ready to run, with no parsing or preparing involved.
+ */
+struct Image final {
+    Image(const Image&) = delete;
+    auto operator=(const Image&) -> Image& = delete;
+
+    /**
+     * @brief Open the image of a source of "size" bytes hashing to "hash"
+     *        in the directory "dir". Returns null if there is none, or if
+     *        it was written for another source or by another version of
+     *        the interpreter, or is damaged in any way.
+     *
+     * @param dir
+     * @param hash
+     * @param size
+     * @return std::unique_ptr<Image>
+     */
+    static auto open(const std::string &dir, std::uint64_t hash, std::size_t size) -> std::unique_ptr<Image>;
+
+    /**
+     * @brief Return whether every form has been loaded.
+     *
+     * @return bool
+     */
+    auto done() const -> bool;
+
+    /**
+     * @brief Load the next form into "ast", which must be empty, and
+     *        return the index of its root. Only called until done.
+     *
+     * @param ast
+     * @return NodeId
+     */
+    auto next(Ast &ast) -> NodeId;
+
+private:
+    Source file;
+    std::size_t offset;            // where the next form starts in "file"
+    std::uint32_t remaining;       // how many forms are left
+    std::vector<SymbolId> symbols; // the ids of the symbols of the image in this process
+
+    /**
+     * @brief Construct a new Image object mapping the file at "path".
+     *
+     * @param path
+     */
+    explicit Image(const char *path);
+
+    /**
+     * @brief Check the image is one of a source of "size" bytes hashing
+     *        to "hash", is whole, and can be loaded without going out of
+     *        bounds, referring to anything missing or holding a tree the
+     *        resolver would not have left, and read its symbols.
+     *
+     * @param hash
+     * @param size
+     * @return bool
+     */
+    auto check(std::uint64_t hash, std::size_t size) -> bool;
+};
+
+#endif // LISP_IMAGE_H
@@ -0,0 +1,70 @@
+#ifndef LISP_INTERN_H
+#define LISP_INTERN_H
+
+#include "object.h"
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Struct representing a set of unique strings addressed by index.
+ *        Interning the same text twice returns the same index, so equal
+ *        strings are stored once and compare as integers. The pool holds
+ *        a reference on each of its strings.
+ */
+struct StringPool final {
+    StringPool() = default;
+    StringPool(const StringPool&) = delete;
+    auto operator=(const StringPool&) -> StringPool& = delete;
+
+    /**
+     * @brief Destroy the StringPool object, dropping its references.
+     */
+    ~StringPool();
+
+    /**
+     * @brief Return the index of "text", adding it to the pool if it is new.
+     *
+     * @param text
+     * @return std::uint32_t
+     */
+    auto intern(std::string_view text) -> std::uint32_t;
+
+    /**
+     * @brief Return the index of "text" if it has already been interned.
+     *
+     * @param text
+     * @return std::optional<std::uint32_t>
+     */
+    auto find(std::string_view text) const -> std::optional<std::uint32_t>;
+
+    /**
+     * @brief Return the string stored at "index".
+     *
+     * @param index
+     * @return String*
+     */
+    auto get(std::uint32_t index) const -> String*;
+
+    /**
+     * @brief Return how many strings are in the pool.
+     *
+     * @return std::size_t
+     */
+    auto size() const -> std::size_t;
+
+    /**
+     * @brief Drop every string from the pool.
+     */
+    auto clear() -> void;
+
+private:
+    // strings never move, so views of their characters are stable keys
+    std::vector<String*> strings;
+    std::unordered_map<std::string_view, std::uint32_t> lookup;
+};
+
+#endif // LISP_INTERN_H
@@ -0,0 +1,280 @@
+#ifndef LISP_INTERPRETER_H
+#define LISP_INTERPRETER_H
+
+#include "arena.h"
+#include "ast.h"
+#include "bytecode.h"
+#include "data.h"
+#include "env.h"
+#include "node.h"
+#include "options.h"
+#include "output.h"
+#include "reader.h"
+#include "result.h"
+#include "text.h"
+#include "vm.h"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Struct representing how an interpreter runs code
+ *        and where what it prints goes.
+ */
+struct Config final {
+    Engine engine = Engine::TREE;
+    bool dump_ast = false;       // print forms once optimized instead of running them
+    bool parallel_forms = false; // run_file runs forms that share no globals at the same time
+    Sinks sinks;                 // standard output and standard error unless set
+    std::string cache_dir;       // run_file keeps compiled images of scripts here, if set
+};
+
+/**
+ * @brief Struct representing an interpreter with global variables of its
+ *        own, the arena the temporaries of its forms live in, the VMs that
+ *        run its code and where what it prints goes. Any number of them can
+ *        live in one process, each used by one thread at a time, like one
+ *        per worker thread of a server. The symbol table and the task pool
+ *        behind pmap and parallel forms are all they share.
+ */
+struct Interpreter final {
+    /**
+     * @brief Struct making an interpreter the one running on the calling
+     *        thread for as long as it lives, with a VM of its own and its
+     *        output going to the interpreter's sinks, then putting back
+     *        whatever ran there before. Tasks an interpreter hands to the
+     *        pool enter it this way on whichever thread picks them up.
+     */
+    struct Scope final {
+        /**
+         * @brief Construct a new Scope object making "interpreter"
+         *        the one running on the calling thread.
+         *
+         * @param interpreter
+         */
+        explicit Scope(Interpreter &interpreter);
+
+        Scope(const Scope&) = delete;
+        auto operator=(const Scope&) -> Scope& = delete;
+
+        /**
+         * @brief Destroy the Scope object, giving the VM back and
+         *        putting back whatever ran on the thread before.
+         */
+        ~Scope();
+
+    private:
+        Interpreter &interpreter;
+        Interpreter *previous;
+        Vm *previous_vm;
+        Vm *vm;
+        TaskLevel level;
+        Redirect redirect;
+    };
+
+    /**
+     * @brief Construct a new Interpreter object set up as "config" says.
+     *
+     * @param config
+     */
+    explicit Interpreter(Config config = Config());
+
+    Interpreter(const Interpreter&) = delete;
+    auto operator=(const Interpreter&) -> Interpreter& = delete;
+
+    /**
+     * @brief Evaluate the top-level form at the start of "source" and return
+     *        its value, which is only valid until the next form is evaluated
+     *        unless it is persisted. Errors are thrown as Error,
+     *        placed at the line and column of "source" they come from.
+     *
+     * @param source
+     * @return Data
+     */
+    auto eval(std::string_view source) -> Data;
+
+    /**
+     * @brief Evaluate the top-level form at the start of "source" like eval,
+     *        but hand back the error instead of throwing it, for callers
+     *        that expect many of them, like a REPL.
+     *
+     * @param source
+     * @return Result<Data>
+     */
+    auto try_eval(std::string_view source) -> Result<Data>;
+
+    /**
+     * @brief Evaluate every top-level form of "source" in order and return
+     *        the value of the last one, or nothing if there are none. It is
+     *        only valid until the next form is evaluated unless it is
+     *        persisted. The first error stops the run and is thrown as Error,
+     *        placed at the line and column of "source" it comes from.
+     *
+     * @param source
+     * @return Data
+     */
+    auto run(std::string_view source) -> Data;
+
+    /**
+     * @brief Evaluate the script at "path", or stdin if "path" is "-". Each
+     *        top-level form is evaluated as soon as it has all been read,
+     *        unless forms run in parallel. The first error stops the run
+     *        and is thrown as Error once everything before it is written,
+     *        placed at the line and column of the script it comes from.
+     *        With a cache directory set, a script that was run before with
+     *        the same contents is loaded from its compiled image instead of
+     *        being parsed, and one that wasn't gets an image once it ran.
+     *
+     * @param path
+     */
+    auto run_file(const char *path) -> void;
+
+    /**
+     * @brief Call the function "callee" with "args" for a builtin and return
+     *        its result, running user functions with the engine picked in
+     *        the config. Like any result, it may point into the form arena.
+     *        Errors are raised the way builtins raise their own.
+     *
+     * @param callee
+     * @param args
+     * @return Data
+     */
+    auto apply(const Data &callee, Args args) -> Data;
+
+    /**
+     * @brief Return how many top-level forms have been evaluated so far.
+     *
+     * @return std::size_t
+     */
+    auto forms_evaluated() const -> std::size_t;
+
+    /**
+     * @brief Return the interpreter running on the calling thread,
+     *        or null if there is none.
+     *
+     * @return Interpreter*
+     */
+    static auto current() -> Interpreter*;
+
+private:
+    struct Batch;
+    struct Script;
+
+    Config config;
+    Globals globals;
+    Arena arena;
+    Ast ast; // the form being evaluated, reused for the next one
+    std::mutex vms_lock;
+    std::vector<std::unique_ptr<Vm>> spare_vms; // guarded by "vms_lock"
+    std::atomic<std::size_t> forms;
+
+    /**
+     * @brief Evaluate a node and slowly collapse an abstract syntax tree into a single value.
+     *
+     * @param ast
+     * @param id
+     * @param env
+     * @return Data
+     */
+    auto eval_node(const Ast &ast, NodeId id, Env *env) -> Data;
+
+    /**
+     * @brief Evaluate one of the special forms marked by the resolver that
+     *        has nothing in tail position.
+     *
+     * @param ast
+     * @param id
+     * @param env
+     * @return Data
+     */
+    auto eval_special(const Ast &ast, NodeId id, Env *env) -> Data;
+
+    /**
+     * @brief Evaluate a prepared top-level form with the engine picked in the
+     *        config, compiling it into "chunk" for the VM.
+     *
+     * @param ast
+     * @param root
+     * @param chunk
+     * @return Result<Data>
+     */
+    auto execute(const Ast &ast, NodeId root, Chunk &chunk) -> Result<Data>;
+
+    /**
+     * @brief Evaluate the prepared top-level form "root" of the form ast,
+     *        or print it with dump_ast set.
+     *
+     * @param root
+     * @return Result<Data>
+     */
+    auto evaluate(NodeId root) -> Result<Data>;
+
+    /**
+     * @brief Load the next top-level form of "script" into "ast", ready to
+     *        run, store the index of its root in "root" and return true,
+     *        or return false once there are none left, or the error that
+     *        keeps the form from running.
+     *
+     * @param script
+     * @param ast
+     * @param root
+     * @return Result<bool>
+     */
+    auto next_form(Script &script, Ast &ast, NodeId &root) -> Result<bool>;
+
+    /**
+     * @brief Evaluate every top-level form of "script" one after another and
+     *        return the value of the last one, or the first error.
+     *
+     * @param script
+     * @return Result<Data>
+     */
+    auto run_forms(Script &script) -> Result<Data>;
+
+    /**
+     * @brief Evaluate every top-level form of "script" in order, or all at
+     *        once if forms run in parallel, and return the first error.
+     *
+     * @param script
+     * @return Result<void>
+     */
+    auto run_script(Script &script) -> Result<void>;
+
+    /**
+     * @brief Run every form "script" has at once, forms that share no
+     *        globals at the same time, and return the first error.
+     *
+     * @param script
+     * @return Result<void>
+     */
+    auto run_batch(Script &script) -> Result<void>;
+
+    /**
+     * @brief Run the form "index" of "batch" on the calling thread.
+     *
+     * @param batch
+     * @param index
+     */
+    auto run_batch_form(Batch &batch, std::size_t index) -> void;
+
+    /**
+     * @brief Take a VM to run code on one thread, making one if none is spare.
+     *
+     * @return Vm*
+     */
+    auto borrow_vm() -> Vm*;
+
+    /**
+     * @brief Give "vm", taken with borrow_vm, back for the next thread.
+     *
+     * @param vm
+     */
+    auto give_back_vm(Vm *vm) -> void;
+};
+
+#endif // LISP_INTERPRETER_H
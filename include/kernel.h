@@ -0,0 +1,125 @@
+#ifndef LISP_KERNEL_H
+#define LISP_KERNEL_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Enum representing the instruction sets the numeric kernels can use.
+ */
+enum struct KernelLevel : std::uint8_t {
+    SCALAR,
+    SSE2,
+    AVX2,
+};
+
+/**
+ * @brief Store "lhs[i]" + "rhs[i]" in "out[i]" for every i below "size",
+ *        or "lhs[i]" + "rhs[0]" for all of them when "broadcast" is set.
+ *        Returns false if any sum overflowed, in which case "out" holds
+ *        garbage.
+ *
+ * @param lhs
+ * @param rhs
+ * @param out
+ * @param size
+ * @param broadcast
+ * @return bool
+ */
+extern auto add_ints(const std::int64_t *lhs, const std::int64_t *rhs, std::int64_t *out,
+                     std::size_t size, bool broadcast) -> bool;
+
+/**
+ * @brief Store "lhs[i]" * "rhs[i]" in "out[i]" for every i below "size",
+ *        or "lhs[i]" * "rhs[0]" for all of them when "broadcast" is set.
+ *        Returns false if any product overflowed, in which case "out"
+ *        holds garbage.
+ *
+ * @param lhs
+ * @param rhs
+ * @param out
+ * @param size
+ * @param broadcast
+ * @return bool
+ */
+extern auto mul_ints(const std::int64_t *lhs, const std::int64_t *rhs, std::int64_t *out,
+                     std::size_t size, bool broadcast) -> bool;
+
+/**
+ * @brief Store "lhs[i]" + "rhs[i]" in "out[i]" for every i below "size",
+ *        or "lhs[i]" + "rhs[0]" for all of them when "broadcast" is set.
+ *
+ * @param lhs
+ * @param rhs
+ * @param out
+ * @param size
+ * @param broadcast
+ */
+extern auto add_reals(const double *lhs, const double *rhs, double *out,
+                      std::size_t size, bool broadcast) -> void;
+
+/**
+ * @brief Store "lhs[i]" * "rhs[i]" in "out[i]" for every i below "size",
+ *        or "lhs[i]" * "rhs[0]" for all of them when "broadcast" is set.
+ *
+ * @param lhs
+ * @param rhs
+ * @param out
+ * @param size
+ * @param broadcast
+ */
+extern auto mul_reals(const double *lhs, const double *rhs, double *out,
+                      std::size_t size, bool broadcast) -> void;
+
+/**
+ * @brief Store the sum of the "size" integers at "values" in "total".
+ *        Returns false if the sum might not fit in 64 bits, in which
+ *        case the caller has to add them up the slow way.
+ *
+ * @param values
+ * @param size
+ * @param total
+ * @return bool
+ */
+extern auto sum_ints(const std::int64_t *values, std::size_t size, std::int64_t &total) -> bool;
+
+/**
+ * @brief Return the sum of the "size" reals at "values". The vector
+ *        kernels add them up in several lanes at once, so the rounding
+ *        can differ from adding them one after the other.
+ *
+ * @param values
+ * @param size
+ * @return double
+ */
+extern auto sum_reals(const double *values, std::size_t size) -> double;
+
+/**
+ * @brief Return the sum of "lhs[i]" * "rhs[i]" for every i below "size",
+ *        rounded like sum_reals.
+ *
+ * @param lhs
+ * @param rhs
+ * @param size
+ * @return double
+ */
+extern auto dot_reals(const double *lhs, const double *rhs, std::size_t size) -> double;
+
+/**
+ * @brief Return the instruction set the kernels are currently using.
+ *
+ * @return KernelLevel
+ */
+extern auto kernel_level() -> KernelLevel;
+
+/**
+ * @brief Force the kernels to "level", clamped to what the CPU
+ *        supports, and return the level actually picked. Only
+ *        meant for benchmarks comparing implementations.
+ *
+ * @param level
+ * @return KernelLevel
+ */
+extern auto set_kernel_level(KernelLevel level) -> KernelLevel;
+
+#endif // LISP_KERNEL_H
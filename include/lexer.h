@@ -0,0 +1,29 @@
+#ifndef LISP_LEXER_H
+#define LISP_LEXER_H
+
+#include "result.h"
+#include "text.h"
+#include "token.h"
+
+/**
+ * @brief Compare the type of "tok" with "type"
+ *        and return an error if they're different,
+ *        at the token. Used for comparing tokens
+ *        and creating the AST.
+ *
+ * @param tok
+ * @param type
+ * @return Result<void>
+ */
+extern auto expect(const Token &tok, TokenType type) -> Result<void>;
+
+/**
+ * @brief Take a Text object and return the first token found within,
+ *        or THE_END at the end of it, or the error it is instead.
+ *
+ * @param text
+ * @return Result<Token>
+ */
+extern auto parse_token(Text &text) -> Result<Token>;
+
+#endif // LISP_LEXER_H
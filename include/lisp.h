@@ -0,0 +1,17 @@
+#ifndef LISP_LISP_H
+#define LISP_LISP_H
+
+// Everything a program embedding the interpreter needs, to be linked
+// against target/liblisp.a (make library). Make an Interpreter, feed it
+// source with eval or run and catch Error. Set the number of task threads
+// with set_task_threads before the first interpreter runs anything.
+// The library does not replace the global operator new, so hosts keep
+// their own allocator.
+
+#include "data.h"
+#include "error.h"
+#include "interpreter.h"
+#include "output.h"
+#include "pool.h"
+
+#endif // LISP_LISP_H
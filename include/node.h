@@ -1,10 +1,27 @@
 #ifndef LISP_NODE_H
 #define LISP_NODE_H
 
+#include "symbol.h"
+
 #include <cstdint>
-#include <string>
-#include <variant>
-#include <list>
+#include <limits>
+#include <span>
+
+struct BigInt;
+struct Data;
+
+/**
+ * @brief Arguments of a call: a contiguous run of values owned by the
+ *        caller, usually its own stack frame or the VM value stack.
+ *        Builtins read them in place and never copy or reshape them.
+ */
+using Args = std::span<const Data>;
+
+/**
+ * @brief Plain function pointer to a built-in function, so that a
+ *        resolved call site costs one indirect call and nothing more.
+ */
+using BuiltinFn = auto (*)(Args args) -> Data;
 
 /**
  * @brief Enum representing all types of node-transformed tokens.
@@ -14,24 +31,119 @@ enum struct NodeType : std::uint8_t {
     STR_CONSTANT,
     SYM_CONSTANT,
     LIST_CONSTANT,
+    REAL_CONSTANT,
+    BIG_CONSTANT, // integers too large for 64 bits, kept as their literal text and value
+};
+
+/**
+ * @brief Enum representing what a list does when it is evaluated.
+ *        Every list starts out as a call and the resolver marks the
+ *        special forms.
+ */
+enum struct Form : std::uint8_t {
+    CALL,
+    DEFINE,
+    SET,
+    LET,
+    IF,
+    LAMBDA,
+    DEFUN,
+    SYNTAX, // binding and parameter lists, never evaluated on their own
+};
+
+/**
+ * @brief Enum representing where the value of a symbol is looked up.
+ */
+enum struct Binding : std::uint8_t {
+    GLOBAL, // the global slot of the symbol, or the symbol itself while unbound
+    LOCAL,  // slot "slot" of the environment "depth" frames up
+};
+
+/**
+ * @brief Index of a node inside of the Ast that owns it.
+ */
+using NodeId = std::uint32_t;
+
+/**
+ * @brief Value of Node::slot for call sites that have no cache.
+ */
+static constexpr std::uint16_t NO_CACHE = std::numeric_limits<std::uint16_t>::max();
+
+/**
+ * @brief Enum representing the built-ins that have a fast path
+ *        for call sites that only ever pass them two numbers,
+ *        plus division, which only the slow path handles.
+ */
+enum struct BinaryOp : std::uint8_t {
+    NONE,
+    ADD,
+    SUB,
+    MUL,
+    LT,
+    GT,
+    EQ,
+    DIV,
+};
+
+/**
+ * @brief Enum representing what a call site has seen so far.
+ */
+enum struct CacheState : std::uint8_t {
+    EMPTY,       // never run
+    MONOMORPHIC, // always the same callee on the same argument types
+    MEGAMORPHIC, // anything else, the generic path is taken for good
+};
+
+/**
+ * @brief Struct representing the inline cache of one call site. Sites bound
+ *        to an arithmetic built-in remember whether they have only seen
+ *        numbers, so they can skip the call. Sites whose head is computed at
+ *        runtime remember the last symbol they looked up by name and the
+ *        built-in it named, so they can skip the lookup.
+ */
+struct CallCache final {
+    CacheState state;
+    BinaryOp op;
+    SymbolId symbol;
+    BuiltinFn builtin;
 };
 
 /**
  * @brief Struct representing the next form of tokens in the internal
  *        representation of the language when it gets evaluated.
+ *        Nodes live inside of an Ast and never own anything themselves:
+ *        strings are indices into its string pool, symbols are ids in the
+ *        global symbol table and lists are a range of its children array.
+ *        Only lists have a callee, so number constants keep their 64-bit
+ *        value in the same word.
  */
 struct Node final {
     NodeType type;
-    std::variant<int, std::string, std::list<Node>> exp;
+    Form form;          // lists only
+    Binding binding;    // symbols only
+    std::uint32_t size; // number of children, lists only
+    union {
+        std::uint32_t string;
+        SymbolId symbol;
+        std::uint32_t first; // index of the first child in Ast::children
+    };
+    std::uint16_t depth; // local symbols only, bound by the resolver
+    std::uint16_t slot;  // local symbols, the index of a lambda in Ast::functions
+                         // or of the cache of a call site in Ast::caches
+    union {
+        BuiltinFn callee;    // lists whose head names a built-in, bound when parsed
+        std::int64_t number; // NUM_CONSTANT
+        double real;         // REAL_CONSTANT
+        BigInt *bignum;      // BIG_CONSTANT, one of Ast::bignums
+    };
 
     /**
      * @brief Construct a new Node object.
      *
      */
     Node();
-    inline Node(NodeType type, const auto &exp)
-        : type(type), exp(exp) {
-    }
 };
 
+static_assert(sizeof(Node) == 24, "Node is meant to stay three words");
+
 #endif // LISP_NODE_H
@@ -0,0 +1,127 @@
+#ifndef LISP_NUMBER_H
+#define LISP_NUMBER_H
+
+#include "data.h"
+#include "node.h"
+
+#include <compare>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Apply "op" to two numbers, storing the result in "result".
+ *        Returns false instead if the result does not fit in 64 bits,
+ *        in which case the caller has to start over with big integers.
+ *        Division is never passed here.
+ *
+ * @param op
+ * @param lhs
+ * @param rhs
+ * @param result
+ * @return bool
+ */
+inline auto int_binary(BinaryOp op, std::int64_t lhs, std::int64_t rhs, std::int64_t &result) -> bool {
+    switch (op) {
+        case BinaryOp::ADD:
+            return !__builtin_add_overflow(lhs, rhs, &result);
+
+        case BinaryOp::SUB:
+            return !__builtin_sub_overflow(lhs, rhs, &result);
+
+        case BinaryOp::MUL:
+            return !__builtin_mul_overflow(lhs, rhs, &result);
+
+        case BinaryOp::LT:
+            result = lhs < rhs;
+            return true;
+
+        case BinaryOp::GT:
+            result = lhs > rhs;
+            return true;
+
+        default:
+            result = lhs == rhs;
+            return true;
+    }
+}
+
+/**
+ * @brief Return the result of "op" on two reals. Comparisons give
+ *        the number 1 or 0, everything else gives a real.
+ *
+ * @param op
+ * @param lhs
+ * @param rhs
+ * @return Data
+ */
+inline auto real_binary(BinaryOp op, double lhs, double rhs) -> Data {
+    switch (op) {
+        case BinaryOp::ADD:
+            return Data::from_real(lhs + rhs);
+
+        case BinaryOp::SUB:
+            return Data::from_real(lhs - rhs);
+
+        case BinaryOp::MUL:
+            return Data::from_real(lhs * rhs);
+
+        case BinaryOp::DIV:
+            return Data::from_real(lhs / rhs);
+
+        case BinaryOp::LT:
+            return Data::from_number(lhs < rhs);
+
+        case BinaryOp::GT:
+            return Data::from_number(lhs > rhs);
+
+        default:
+            return Data::from_number(lhs == rhs);
+    }
+}
+
+/**
+ * @brief Return the result of "op" on two numbers of any kind, erroring
+ *        if either is not a number. Integers that overflow become big
+ *        integers, big integers that fit again become numbers, and as
+ *        soon as a real is involved the result is a real. Division of
+ *        integers rounds towards zero and errors on a zero divisor.
+ *
+ * @param op
+ * @param lhs
+ * @param rhs
+ * @return Data
+ */
+extern auto apply_numeric(BinaryOp op, const Data &lhs, const Data &rhs) -> Data;
+
+/**
+ * @brief Return "total" combined with each of "rest" in turn by "op",
+ *        for the built-ins taking any number of arguments once their
+ *        64 bit loop has run into something it cannot handle.
+ *
+ * @param op
+ * @param total
+ * @param rest
+ * @return Data
+ */
+extern auto fold_numeric(BinaryOp op, Data total, Args rest) -> Data;
+
+/**
+ * @brief Return how the numbers "lhs" and "rhs" are ordered,
+ *        unordered if either is a real that is not a number.
+ *
+ * @param lhs
+ * @param rhs
+ * @return std::partial_ordering
+ */
+extern auto compare_numbers(const Data &lhs, const Data &rhs) -> std::partial_ordering;
+
+/**
+ * @brief Return the shortest text that reads back as "real",
+ *        with a ".0" added to whole values so they still look like reals.
+ *
+ * @param real
+ * @return std::string
+ */
+extern auto format_real(double real) -> std::string;
+
+#endif // LISP_NUMBER_H
@@ -0,0 +1,347 @@
+#ifndef LISP_OBJECT_H
+#define LISP_OBJECT_H
+
+#include "refcount.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+struct Arena;
+struct Env;
+struct Function;
+
+/**
+ * @brief Struct representing an immutable, reference counted string.
+ *        The characters are stored right after the header in the same
+ *        allocation, so a string costs exactly one heap block and sharing
+ *        it only bumps a counter. Strings made in an arena are pinned:
+ *        they ignore reference counting and die when the arena is reset.
+ */
+struct String final {
+    static constexpr std::uint32_t PINNED = std::numeric_limits<std::uint32_t>::max();
+
+    std::uint32_t refs;
+    std::size_t size;
+
+    /**
+     * @brief Allocate a string holding a copy of "text" with one reference.
+     *
+     * @param text
+     * @return String*
+     */
+    static auto make(std::string_view text) -> String*;
+
+    /**
+     * @brief Allocate a string of "size" uninitialised characters with one
+     *        reference, for callers that fill it in place.
+     *
+     * @param size
+     * @return String*
+     */
+    static auto make(std::size_t size) -> String*;
+
+    /**
+     * @brief Allocate a pinned string of "size" uninitialised characters
+     *        inside of "arena", for temporaries that die with the form.
+     *
+     * @param size
+     * @param arena
+     * @return String*
+     */
+    static auto make(std::size_t size, Arena &arena) -> String*;
+
+    /**
+     * @brief Return the characters of the string.
+     *
+     * @return char*
+     */
+    inline auto chars() -> char* {
+        return reinterpret_cast<char*>(this + 1);
+    }
+
+    /**
+     * @brief Return a view of the characters of the string.
+     *
+     * @return std::string_view
+     */
+    inline auto view() const -> std::string_view {
+        return {reinterpret_cast<const char*>(this + 1), this->size};
+    }
+
+    /**
+     * @brief Return whether the string lives in an arena.
+     *
+     * @return bool
+     */
+    inline auto pinned() const -> bool {
+        return count_of(this->refs) == PINNED;
+    }
+
+    /**
+     * @brief Take another reference to the string.
+     */
+    inline auto retain() -> void {
+        if (!this->pinned()) {
+            count_up(this->refs);
+        }
+    }
+
+    /**
+     * @brief Drop a reference to the string, freeing it with the last one.
+     */
+    inline auto release() -> void {
+        if (!this->pinned() && count_down(this->refs)) {
+            String::destroy(this);
+        }
+    }
+
+private:
+    /**
+     * @brief Free "string" once nothing refers to it anymore.
+     *
+     * @param string
+     */
+    static auto destroy(String *string) -> void;
+};
+
+/**
+ * @brief Struct representing a function value: the code of a lambda
+ *        together with the frame of local variables it was created in.
+ *        Closures are reference counted like strings and keep both the
+ *        function and the frame alive.
+ */
+struct Closure final {
+    std::uint32_t refs;
+    Function *function;
+    Env *env;
+
+    /**
+     * @brief Allocate a closure over "function" and "env" with one
+     *        reference, taking a reference to both of them.
+     *
+     * @param function
+     * @param env
+     * @return Closure*
+     */
+    static auto make(Function *function, Env *env) -> Closure*;
+
+    /**
+     * @brief Take another reference to the closure.
+     */
+    inline auto retain() -> void {
+        count_up(this->refs);
+    }
+
+    /**
+     * @brief Drop a reference to the closure, freeing it with the last one.
+     */
+    inline auto release() -> void {
+        if (count_down(this->refs)) {
+            Closure::destroy(this);
+        }
+    }
+
+private:
+    /**
+     * @brief Free "closure" once nothing refers to it anymore.
+     *
+     * @param closure
+     */
+    static auto destroy(Closure *closure) -> void;
+};
+
+struct Rope;
+
+/**
+ * @brief Struct holding one part of a rope: either a flat string or
+ *        another rope, never both. Holds a reference to whichever it is.
+ */
+struct RopePart final {
+    String *string;
+    Rope *rope;
+};
+
+/**
+ * @brief Struct representing an immutable, reference counted string made
+ *        of other strings without copying them. concat builds one when its
+ *        result is large, so nesting concats costs time in the number of
+ *        parts rather than in their length. The text is only put together
+ *        when something needs to see it in one piece, and printing walks
+ *        the parts instead. Parts are never pinned, so ropes can be kept
+ *        past the end of the form.
+ */
+struct Rope final {
+    std::uint32_t refs;
+    std::size_t size;
+    mutable String *flat; // the whole text once it was asked for, then the only part
+                          // unless the rope may be shared between threads
+    mutable std::vector<RopePart> parts;
+
+    /**
+     * @brief Allocate a rope over "parts" with one reference, taking
+     *        over the references they hold.
+     *
+     * @param parts
+     * @return Rope*
+     */
+    static auto make(std::vector<RopePart> parts) -> Rope*;
+
+    /**
+     * @brief Return the text of the rope in one piece, copying the parts
+     *        together the first time and dropping them afterwards.
+     *
+     * @return std::string_view
+     */
+    auto view() const -> std::string_view;
+
+    /**
+     * @brief Call "visit" on each flat piece of the rope from left to
+     *        right. Walks the parts with a stack of its own, since ropes
+     *        grown by appending in a loop can nest very deeply.
+     *
+     * @param visit
+     */
+    template <typename Visit>
+    auto for_each_piece(Visit &&visit) const -> void {
+        std::vector<std::pair<const Rope*, std::size_t>> stack {{this, 0}};
+
+        while (!stack.empty()) {
+            auto &[rope, next] = stack.back();
+
+            // only looked at on the way in, since another thread may put
+            // the text together once some of the parts were already visited
+            if (const auto flat = next == 0 ? rope->flat_text() : nullptr; flat != nullptr) {
+                visit(flat->view());
+                stack.pop_back();
+                continue;
+            }
+            if (next == rope->parts.size()) {
+                stack.pop_back();
+                continue;
+            }
+
+            const auto &part = rope->parts[next++];
+            if (part.string != nullptr) {
+                visit(part.string->view());
+            }
+            else {
+                stack.emplace_back(part.rope, 0);
+            }
+        }
+    }
+
+    /**
+     * @brief Return the whole text if it was already put together, or null.
+     *        Another thread may be putting it together at the same time.
+     *
+     * @return String*
+     */
+    inline auto flat_text() const -> String* {
+        return std::atomic_ref<String*>(this->flat).load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Take another reference to the rope.
+     */
+    inline auto retain() -> void {
+        count_up(this->refs);
+    }
+
+    /**
+     * @brief Drop a reference to the rope, freeing it with the last one.
+     */
+    inline auto release() -> void {
+        if (count_down(this->refs)) {
+            Rope::destroy(this);
+        }
+    }
+
+private:
+    /**
+     * @brief Free "rope" once nothing refers to it anymore, along with
+     *        every part only it referred to. Runs without recursing.
+     *
+     * @param rope
+     */
+    static auto destroy(Rope *rope) -> void;
+};
+
+/**
+ * @brief Enum representing what the elements of a vector are.
+ */
+enum struct VectorKind : std::uint8_t {
+    INTS,  // std::int64_t
+    REALS, // double
+};
+
+/**
+ * @brief Struct representing an immutable, reference counted vector of
+ *        numbers, all of them integers or all of them reals. Like strings
+ *        the elements are packed right after the header in the same
+ *        allocation, which is aligned for the widest vector registers the
+ *        numeric kernels use.
+ */
+struct alignas(32) Vector final {
+    std::uint32_t refs;
+    VectorKind kind;
+    std::size_t size;
+
+    /**
+     * @brief Allocate a vector of "size" uninitialised elements of "kind"
+     *        with one reference, for callers that fill it in place.
+     *
+     * @param kind
+     * @param size
+     * @return Vector*
+     */
+    static auto make(VectorKind kind, std::size_t size) -> Vector*;
+
+    /**
+     * @brief Return the elements of a vector of integers.
+     *
+     * @return std::int64_t*
+     */
+    inline auto ints() const -> std::int64_t* {
+        return reinterpret_cast<std::int64_t*>(const_cast<Vector*>(this) + 1);
+    }
+
+    /**
+     * @brief Return the elements of a vector of reals.
+     *
+     * @return double*
+     */
+    inline auto reals() const -> double* {
+        return reinterpret_cast<double*>(const_cast<Vector*>(this) + 1);
+    }
+
+    /**
+     * @brief Take another reference to the vector.
+     */
+    inline auto retain() -> void {
+        count_up(this->refs);
+    }
+
+    /**
+     * @brief Drop a reference to the vector, freeing it with the last one.
+     */
+    inline auto release() -> void {
+        if (count_down(this->refs)) {
+            Vector::destroy(this);
+        }
+    }
+
+private:
+    /**
+     * @brief Free "vector" once nothing refers to it anymore.
+     *
+     * @param vector
+     */
+    static auto destroy(Vector *vector) -> void;
+};
+
+#endif // LISP_OBJECT_H
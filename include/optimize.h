@@ -0,0 +1,21 @@
+#ifndef LISP_OPTIMIZE_H
+#define LISP_OPTIMIZE_H
+
+#include "ast.h"
+#include "node.h"
+
+/**
+ * @brief Rewrite the tree under "root" so that calls to pure built-ins
+ *        whose arguments are all constants become the constant they
+ *        evaluate to. Constant subtrees are folded wherever they appear,
+ *        including inside calls that can't be folded themselves, and the
+ *        constant arguments of add, mul and concat are combined even when
+ *        other arguments are not constant. Calls that would fail are left
+ *        alone so the error still happens when the form runs.
+ *
+ * @param ast
+ * @param root
+ */
+extern auto fold_constants(Ast &ast, NodeId root) -> void;
+
+#endif // LISP_OPTIMIZE_H
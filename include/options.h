@@ -0,0 +1,43 @@
+#ifndef LISP_OPTIONS_H
+#define LISP_OPTIONS_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Enum representing the available ways of evaluating code.
+ */
+enum struct Engine : std::uint8_t {
+    TREE,
+    VM,
+};
+
+/**
+ * @brief Struct representing the parsed command line of the interpreter.
+ */
+struct Options final {
+    Engine engine;
+    const char *script;
+    const char *cache_dir; // where compiled images of scripts are kept, none if null
+    const char *profile;   // where collapsed stacks are written with --profile, none if null
+    bool alloc_stats;
+    bool dump_ast;
+    std::size_t jobs; // threads for pmap and friends, and for forms if above 1; 0 for one per core
+
+    /**
+     * @brief Construct a new Options object.
+     */
+    Options();
+};
+
+/**
+ * @brief Take the command line arguments from main and turn them into
+ *        Options. Prints the usage and exits on anything unrecognised.
+ *
+ * @param argc
+ * @param argv
+ * @return Options
+ */
+extern auto parse_options(int argc, char *argv[]) -> Options;
+
+#endif // LISP_OPTIONS_H
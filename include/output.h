@@ -0,0 +1,216 @@
+#ifndef LISP_OUTPUT_H
+#define LISP_OUTPUT_H
+
+#include "data.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Type of a function taking text that was flushed, for embedders
+ *        who want what an interpreter prints somewhere else than a file.
+ */
+using Sink = std::function<void(std::string_view text)>;
+
+/**
+ * @brief Struct representing where standard output and standard error
+ *        go. An empty sink leaves its stream going to its file descriptor.
+ */
+struct Sinks final {
+    Sink out;
+    Sink err;
+};
+
+/**
+ * @brief Struct representing output held back instead of being written:
+ *        what was flushed to standard output and standard error, in the
+ *        order it was flushed. Forms run on worker threads with --jobs
+ *        and the pieces of pmap and friends print into one of these, and
+ *        it is written out once everything before them has been, so the
+ *        output reads as if they had run one after another.
+ */
+struct Transcript final {
+    /**
+     * @brief Struct representing text flushed to one file descriptor.
+     */
+    struct Piece final {
+        int fd;
+        std::string text;
+    };
+
+    std::vector<Piece> pieces;
+
+    /**
+     * @brief Add "text" flushed to "fd" after everything recorded so far.
+     *
+     * @param fd
+     * @param text
+     */
+    auto append(int fd, std::string_view text) -> void;
+
+    /**
+     * @brief Flush everything recorded again, in order, from the calling
+     *        thread, so it goes wherever that thread's output goes now.
+     */
+    auto replay() const -> void;
+};
+
+/**
+ * @brief Struct representing a buffered writer to a file descriptor.
+ *        Everything printed is gathered in a large buffer of our own and
+ *        handed to the kernel in one write once it fills up or at one of
+ *        the flush points (end of the run, errors, eprint, REPL prompts,
+ *        a script read from a pipe waiting for more input),
+ *        bypassing iostreams and their synchronisation with stdio.
+ */
+struct Output final {
+    static constexpr std::size_t CAPACITY = 1 << 16;
+
+    /**
+     * @brief Construct a new Output object writing to "fd".
+     *
+     * @param fd
+     */
+    explicit Output(int fd);
+
+    Output(const Output&) = delete;
+    auto operator=(const Output&) -> Output& = delete;
+
+    /**
+     * @brief Destroy the Output object, flushing what is left.
+     */
+    ~Output();
+
+    /**
+     * @brief Append "text". Text larger than the buffer is written directly.
+     *
+     * @param text
+     */
+    auto write(std::string_view text) -> void;
+
+    /**
+     * @brief Append the character "c".
+     *
+     * @param c
+     */
+    inline auto write(char c) -> void {
+        if (this->used == CAPACITY) {
+            this->flush();
+        }
+        this->buffer[this->used++] = c;
+    }
+
+    /**
+     * @brief Append "number" in decimal.
+     *
+     * @param number
+     */
+    auto write(std::int64_t number) -> void;
+
+    /**
+     * @brief Append "data" the way print shows it.
+     *
+     * @param data
+     */
+    auto write(const Data &data) -> void;
+
+    /**
+     * @brief Hand everything buffered so far to the kernel.
+     */
+    auto flush() -> void;
+
+private:
+    int fd;
+    std::size_t used;
+    std::unique_ptr<char[]> buffer;
+};
+
+/**
+ * @brief Return the buffered writer for standard output. Each thread
+ *        has its own, so output is only ever split where it is flushed.
+ *
+ * @return Output&
+ */
+extern auto standard_output() -> Output&;
+
+/**
+ * @brief Return the buffered writer for standard error. Whoever writes
+ *        to it flushes it straight away, after flushing standard output
+ *        so the two streams stay in order on a terminal.
+ *
+ * @return Output&
+ */
+extern auto standard_error() -> Output&;
+
+/**
+ * @brief Struct recording everything the calling thread flushes in a
+ *        transcript for as long as it lives, or writing it straight out if
+ *        the transcript is null, then going back to what it did before.
+ *        Both buffers are flushed on the way in and out, so what was
+ *        printed before and after ends up where it belongs.
+ */
+struct Recording final {
+    /**
+     * @brief Construct a new Recording object recording
+     *        what the calling thread flushes in "transcript".
+     *
+     * @param transcript
+     */
+    explicit Recording(Transcript *transcript);
+
+    Recording(const Recording&) = delete;
+    auto operator=(const Recording&) -> Recording& = delete;
+
+    /**
+     * @brief Destroy the Recording object, flushing what is left
+     *        into it and going back to what the thread did before.
+     */
+    ~Recording();
+
+private:
+    Transcript *previous;
+};
+
+/**
+ * @brief Struct sending everything the calling thread flushes to "sinks"
+ *        for as long as it lives, then going back to what it did before.
+ *        Nothing is recorded in the meantime unless a Recording inside it
+ *        says so. Both buffers are flushed on the way in and out, so what
+ *        was printed before and after ends up where it belongs.
+ */
+struct Redirect final {
+    /**
+     * @brief Construct a new Redirect object sending what
+     *        the calling thread flushes to "sinks".
+     *
+     * @param sinks
+     */
+    explicit Redirect(const Sinks &sinks);
+
+    Redirect(const Redirect&) = delete;
+    auto operator=(const Redirect&) -> Redirect& = delete;
+
+    /**
+     * @brief Destroy the Redirect object, flushing what is left
+     *        into the sinks and going back to what the thread did before.
+     */
+    ~Redirect();
+
+private:
+    const Sinks *previous_sinks;
+    Transcript *previous_recording;
+};
+
+/**
+ * @brief Report "message" as an error on standard error.
+ *
+ * @param message
+ */
+extern auto write_error(std::string_view message) -> void;
+
+#endif // LISP_OUTPUT_H
@@ -0,0 +1,22 @@
+#ifndef LISP_PARSER_H
+#define LISP_PARSER_H
+
+#include "ast.h"
+#include "node.h"
+#include "result.h"
+#include "text.h"
+
+/**
+ * @brief Convert a series of tokens into an abstract syntax tree
+ *        stored inside of "ast" and return the index of its root,
+ *        or the first error in them. Every node records the offset
+ *        of its first token, which for a nested list is done by the
+ *        list holding it.
+ *
+ * @param text
+ * @param ast
+ * @return Result<NodeId>
+ */
+extern auto parse_ast(Text &text, Ast &ast, bool check_lparen = true) -> Result<NodeId>;
+
+#endif // LISP_PARSER_H
@@ -0,0 +1,163 @@
+#ifndef LISP_POOL_H
+#define LISP_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Struct counting the tasks of one batch that have not finished
+ *        yet, so that whoever started them can wait for all of them.
+ *        Tasks spawned by a task of the group may join it as well.
+ */
+struct TaskGroup final {
+    std::atomic<std::size_t> pending {0};
+};
+
+/**
+ * @brief Type of the work handed to a Pool. Tasks must not throw,
+ *        errors are theirs to catch and report.
+ */
+using Task = std::function<void()>;
+
+/**
+ * @brief Struct representing a fixed set of threads running tasks. Every
+ *        thread has a queue of its own: tasks spawned by a thread go on
+ *        the back of its queue and it takes them back from there, newest
+ *        first while they are still warm in its cache, and a thread with
+ *        nothing left steals the oldest task of another. The thread that
+ *        made the pool counts as one of its threads, and runs tasks too
+ *        whenever it waits for a group.
+ */
+struct Pool final {
+    /**
+     * @brief Construct a new Pool object of "threads" threads in total,
+     *        the calling one included, so "threads" - 1 are started.
+     *
+     * @param threads
+     */
+    explicit Pool(std::size_t threads);
+
+    Pool(const Pool&) = delete;
+    auto operator=(const Pool&) -> Pool& = delete;
+
+    /**
+     * @brief Destroy the Pool object once every thread has run out of
+     *        tasks, stopping and joining the ones it started.
+     */
+    ~Pool();
+
+    /**
+     * @brief Add "task" to "group" and queue it on the calling thread.
+     *
+     * @param group
+     * @param task
+     */
+    auto spawn(TaskGroup &group, Task task) -> void;
+
+    /**
+     * @brief Run queued tasks, stealing them if need be, until every task
+     *        of "group" has finished. Only sleeps when there are none.
+     *
+     * @param group
+     */
+    auto wait(TaskGroup &group) -> void;
+
+    /**
+     * @brief Return how many threads run tasks, the calling one included.
+     *
+     * @return std::size_t
+     */
+    auto size() const -> std::size_t;
+
+    /**
+     * @brief Return whether no task is queued anywhere, in which case any
+     *        thread that runs out of work will go to sleep. A task with
+     *        a lot left to do should hand some of it out then.
+     *
+     * @return bool
+     */
+    auto hungry() const -> bool;
+
+private:
+    /**
+     * @brief Struct representing a task along with the group it is part of.
+     */
+    struct Job final {
+        TaskGroup *group;
+        Task task;
+    };
+
+    /**
+     * @brief Struct representing the tasks queued by one thread.
+     */
+    struct Queue final {
+        std::mutex lock;
+        std::deque<Job> jobs;
+    };
+
+    /**
+     * @brief Take the newest job queued by thread "self", or else the
+     *        oldest job of another thread, into "job". Returns false if
+     *        every queue was empty.
+     *
+     * @param self
+     * @param job
+     * @return bool
+     */
+    auto take(std::size_t self, Job &job) -> bool;
+
+    /**
+     * @brief Run "job" and count it as finished in its group.
+     *
+     * @param job
+     */
+    auto run(Job &job) -> void;
+
+    /**
+     * @brief Run tasks on the started thread "self" until the pool stops.
+     *
+     * @param self
+     */
+    auto work(std::size_t self) -> void;
+
+    /**
+     * @brief Return the index of the calling thread in the pool, which
+     *        is 0 for the thread that made it or any thread outside of it.
+     *
+     * @return std::size_t
+     */
+    auto self() const -> std::size_t;
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+    std::atomic<std::size_t> queued; // jobs sitting in any queue
+    std::mutex idle_lock;
+    std::condition_variable idle; // queued went up, a group finished or the pool stops
+    bool stopping;
+};
+
+/**
+ * @brief Set how many threads the shared pool is made with. Only has an
+ *        effect before its first use. 0, the default, means one per core.
+ *
+ * @param threads
+ */
+extern auto set_task_threads(std::size_t threads) -> void;
+
+/**
+ * @brief Return the pool shared by everything in the process that runs in
+ *        parallel, making it on first use. Values are shared between
+ *        threads from then on if it has more than one.
+ *
+ * @return Pool&
+ */
+extern auto task_pool() -> Pool&;
+
+#endif // LISP_POOL_H
@@ -0,0 +1,224 @@
+#ifndef LISP_PROFILE_H
+#define LISP_PROFILE_H
+
+#include "ast.h"
+#include "data.h"
+#include "node.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+struct Function;
+
+/**
+ * @brief Set once the profiler is started with start_profiling and never
+ *        cleared, so every hook only costs a relaxed load while it is off.
+ */
+inline std::atomic<bool> profiling {false};
+
+/**
+ * @brief Enum representing what a frame of the profile stands for.
+ */
+enum struct FrameKind : std::uint8_t {
+    FORM,     // a top-level form, by the order it was first run in
+    FUNCTION, // a defun, by the symbol of its name
+    LAMBDA,   // any lambda, since they have no name
+    BUILTIN,  // a built-in, by its address
+};
+
+/**
+ * @brief Struct identifying a frame of the profile. Frames are kept by key
+ *        and only turned into names when the profile is written out.
+ */
+struct FrameKey final {
+    FrameKind kind;
+    std::uintptr_t id;
+
+    auto operator==(const FrameKey&) const -> bool = default;
+};
+
+/**
+ * @brief Start recording every top-level form, user function and builtin
+ *        run from now on, on any thread, until the process exits. Starts
+ *        counting allocations too, which the report breaks down by frame.
+ */
+extern auto start_profiling() -> void;
+
+/**
+ * @brief Return the frame of the top-level form "root" of "ast",
+ *        named after how it starts. Forms that start the same way share
+ *        a frame, so a REPL does not add one per line it evaluates. Only
+ *        called while profiling.
+ *
+ * @param ast
+ * @param root
+ * @return FrameKey
+ */
+extern auto form_frame(const Ast &ast, NodeId root) -> FrameKey;
+
+/**
+ * @brief Return the frame of the user function "function".
+ *
+ * @param function
+ * @return FrameKey
+ */
+extern auto function_frame(const Function &function) -> FrameKey;
+
+/**
+ * @brief Return the frame of the built-in function "fn".
+ *
+ * @param fn
+ * @return FrameKey
+ */
+inline auto builtin_frame(BuiltinFn fn) -> FrameKey {
+    return FrameKey {FrameKind::BUILTIN, reinterpret_cast<std::uintptr_t>(fn)};
+}
+
+/**
+ * @brief Enter the frame "key" on the calling thread, below the one it
+ *        is in. A function calling itself stays in the same node, so
+ *        deep recursion does not make the stacks any deeper. Only called
+ *        while profiling.
+ *
+ * @param key
+ */
+extern auto enter_frame(FrameKey key) -> void;
+
+/**
+ * @brief Leave the frame the calling thread is in, if any, and
+ *        count what was spent in it there and in the frame above.
+ */
+extern auto leave_frame() -> void;
+
+/**
+ * @brief Return the frames the calling thread is in, outermost first,
+ *        or nothing if the profiler is off.
+ *
+ * @return std::vector<FrameKey>
+ */
+extern auto profile_path() -> std::vector<FrameKey>;
+
+/**
+ * @brief Write every stack recorded so far to "os" in the collapsed format
+ *        flame graph tools read: one line per stack, frames separated by
+ *        ';', followed by the nanoseconds spent in its innermost frame.
+ *        Only called once nothing runs anymore.
+ *
+ * @param os
+ */
+extern auto write_collapsed_stacks(std::ostream &os) -> void;
+
+/**
+ * @brief Write a table of every frame recorded so far to "os": how often
+ *        it was entered, the time spent in it with and without what it
+ *        called, and the allocations it made itself, most self time first.
+ *        Time a frame spent inside of itself further up the stack is only
+ *        counted once. Only called once nothing runs anymore.
+ *
+ * @param os
+ */
+extern auto write_profile_summary(std::ostream &os) -> void;
+
+/**
+ * @brief Struct keeping the calling thread in a frame for as long as it
+ *        lives. Starts out in none, and entering another one leaves the
+ *        one it is in first, which is what a tail call does.
+ */
+struct ProfileFrame final {
+    /**
+     * @brief Construct a new ProfileFrame object in no frame.
+     */
+    ProfileFrame() = default;
+
+    /**
+     * @brief Construct a new ProfileFrame object in the frame "key",
+     *        if the profiler is on.
+     *
+     * @param key
+     */
+    explicit ProfileFrame(FrameKey key) {
+        this->enter(key);
+    }
+
+    ProfileFrame(const ProfileFrame&) = delete;
+    auto operator=(const ProfileFrame&) -> ProfileFrame& = delete;
+
+    /**
+     * @brief Destroy the ProfileFrame object, leaving its frame.
+     */
+    ~ProfileFrame() {
+        if (this->active) {
+            leave_frame();
+        }
+    }
+
+    /**
+     * @brief Leave the frame this is in, if any, and enter
+     *        the frame "key" instead, if the profiler is on.
+     *
+     * @param key
+     */
+    inline auto enter(FrameKey key) -> void {
+        if (profiling.load(std::memory_order_relaxed)) [[unlikely]] {
+            if (this->active) {
+                leave_frame();
+            }
+            enter_frame(key);
+            this->active = true;
+        }
+    }
+
+private:
+    bool active = false;
+};
+
+/**
+ * @brief Struct running a task handed to another thread, or run there in
+ *        the middle of something else, in the frames "path" instead of the
+ *        ones the thread is in. The time it takes is not counted in the
+ *        frame the thread was in, and putting it back restores that frame.
+ */
+struct ProfileTask final {
+    /**
+     * @brief Construct a new ProfileTask object running in
+     *        the frames "path", if the profiler is on.
+     *
+     * @param path
+     */
+    explicit ProfileTask(const std::vector<FrameKey> &path);
+
+    ProfileTask(const ProfileTask&) = delete;
+    auto operator=(const ProfileTask&) -> ProfileTask& = delete;
+
+    /**
+     * @brief Destroy the ProfileTask object, putting
+     *        back the frames the thread was in.
+     */
+    ~ProfileTask();
+
+private:
+    bool active;
+    std::size_t depth;     // how many frames the thread was in
+    std::uint64_t started; // in nanoseconds
+};
+
+/**
+ * @brief Call the built-in function "fn" with "args" in a frame of its own,
+ *        if the profiler is on, and return its result.
+ *
+ * @param fn
+ * @param args
+ * @return Data
+ */
+inline auto call_builtin(BuiltinFn fn, Args args) -> Data {
+    if (profiling.load(std::memory_order_relaxed)) [[unlikely]] {
+        const ProfileFrame frame(builtin_frame(fn));
+        return fn(args);
+    }
+    return fn(args);
+}
+
+#endif // LISP_PROFILE_H
@@ -0,0 +1,132 @@
+#ifndef LISP_READER_H
+#define LISP_READER_H
+
+#include "source.h"
+#include "text.h"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Struct splitting a script into its top-level forms as they arrive.
+ *        Regular files are mapped whole; pipes and stdin are pulled in fixed
+ *        size chunks, with a partially read form carried over to the next
+ *        chunk, so only the form being read has to fit in memory.
+ */
+struct Reader final {
+    static constexpr std::size_t CHUNK_SIZE = 64 * 1024;
+
+    /**
+     * @brief Construct a new Reader object for the file at "path",
+     *        or for stdin if "path" is "-". Errors if it can't be opened.
+     *
+     * @param path
+     */
+    explicit Reader(const char *path);
+
+    /**
+     * @brief Construct a new Reader object for the text [data, data + size),
+     *        which must outlive it.
+     *
+     * @param data
+     * @param size
+     */
+    Reader(const char *data, std::size_t size);
+
+    Reader(const Reader&) = delete;
+    auto operator=(const Reader&) -> Reader& = delete;
+
+    /**
+     * @brief Destroy the Reader object and close its file.
+     */
+    ~Reader();
+
+    /**
+     * @brief Store the text of the next complete top-level form in "form"
+     *        and return true, or return false once the input is exhausted.
+     *        "form" stays valid until the next call. An unterminated form
+     *        at the end of input is still returned so the parser can
+     *        report what is wrong with it.
+     *
+     * @param form
+     * @return bool
+     */
+    auto next(std::string_view &form) -> bool;
+
+    /**
+     * @brief Return how far into the input the form last handed out starts.
+     *
+     * @return std::size_t
+     */
+    auto offset() const -> std::size_t;
+
+    /**
+     * @brief Return the line and column of the byte at "offset" in the
+     *        input, or nothing if it is part of a form that was already
+     *        dropped. Only the text still held is counted through.
+     *
+     * @param offset
+     * @return std::optional<TextPosition>
+     */
+    auto position(std::size_t offset) const -> std::optional<TextPosition>;
+
+private:
+    enum struct State : std::uint8_t {
+        CODE,
+        STRING,
+        COMMENT,
+        ATOM,
+    };
+
+    std::unique_ptr<Source> source;
+    std::string name; // what "fd" reads, for errors
+    int fd;
+    bool eof;
+
+    std::string buffer;
+    std::string_view input;
+    std::size_t dropped;       // bytes dropped from the front of "buffer" so far
+    TextPosition dropped_end;  // where the first byte after them is
+    std::size_t form_offset;   // where the form last handed out starts
+
+    // scanning state of the form being read, kept across refills
+    std::size_t scanned, start;
+    std::size_t depth;
+    State state;
+
+    /**
+     * @brief Advance "p" through the form being read. Returns true with "p"
+     *        just past the form once it is complete, or false with "p" at
+     *        "end" if the rest of it has not been read yet.
+     *
+     * @param p
+     * @param end
+     * @return bool
+     */
+    auto scan(const char *&p, const char *end) -> bool;
+
+    /**
+     * @brief Hand out the form being read, which ends at "stop",
+     *        and get ready to read the one after it.
+     *
+     * @param form
+     * @param stop
+     * @return bool
+     */
+    auto take(std::string_view &form, std::size_t stop) -> bool;
+
+    /**
+     * @brief Read another chunk into the buffer, dropping the forms that
+     *        were already handed out. Returns false at the end of input and
+     *        errors if reading fails.
+     *        Standard output is flushed first if the read would have to
+     *        wait, so what the forms so far printed is not held back.
+     *
+     * @return bool
+     */
+    auto refill() -> bool;
+};
+
+#endif // LISP_READER_H
@@ -0,0 +1,88 @@
+#ifndef LISP_REF_H
+#define LISP_REF_H
+
+#include <utility>
+
+/**
+ * @brief Struct owning one reference to an intrusively reference counted
+ *        object, anything with retain() and release(), so that references
+ *        are dropped when an error unwinds past them.
+ */
+template <typename T>
+struct Ref final {
+    /**
+     * @brief Construct an empty Ref object.
+     */
+    inline Ref()
+        : ptr(nullptr) {
+    }
+
+    /**
+     * @brief Construct a new Ref object taking over the reference held on "ptr".
+     *
+     * @param ptr
+     */
+    inline explicit Ref(T *ptr)
+        : ptr(ptr) {
+    }
+
+    inline Ref(const Ref &other)
+        : ptr(other.ptr) {
+        if (this->ptr != nullptr) {
+            this->ptr->retain();
+        }
+    }
+
+    inline Ref(Ref &&other) noexcept
+        : ptr(std::exchange(other.ptr, nullptr)) {
+    }
+
+    inline auto operator=(Ref other) noexcept -> Ref& {
+        std::swap(this->ptr, other.ptr);
+        return *this;
+    }
+
+    /**
+     * @brief Destroy the Ref object, dropping its reference.
+     */
+    inline ~Ref() {
+        if (this->ptr != nullptr) {
+            this->ptr->release();
+        }
+    }
+
+    /**
+     * @brief Return a Ref object holding a new reference to "ptr".
+     *
+     * @param ptr
+     * @return Ref
+     */
+    static inline auto share(T *ptr) -> Ref {
+        if (ptr != nullptr) {
+            ptr->retain();
+        }
+        return Ref(ptr);
+    }
+
+    /**
+     * @brief Return the object referred to, or null.
+     *
+     * @return T*
+     */
+    inline auto get() const -> T* {
+        return this->ptr;
+    }
+
+    inline auto operator->() const -> T* {
+        return this->ptr;
+    }
+
+    inline auto operator*() const -> T& {
+        return *this->ptr;
+    }
+
+private:
+    T *ptr;
+};
+
+#endif // LISP_REF_H
@@ -0,0 +1,58 @@
+#ifndef LISP_REFCOUNT_H
+#define LISP_REFCOUNT_H
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief Set once values can be shared between threads, which only
+ *        happens once the task pool has started threads of its own. It is
+ *        switched on before the first worker starts and never switched
+ *        off, so a relaxed load is enough: it is atomic only because
+ *        interpreters on other threads may read it as it is set. Until then
+ *        every reference count is changed with plain increments and lazily
+ *        filled in state, like inline caches, is written without locks.
+ */
+inline std::atomic<bool> threads_share_values {false};
+
+/**
+ * @brief Return the count "refs", which other threads may be changing.
+ *
+ * @param refs
+ * @return std::uint32_t
+ */
+inline auto count_of(const std::uint32_t &refs) -> std::uint32_t {
+    return std::atomic_ref<std::uint32_t>(const_cast<std::uint32_t&>(refs)).load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Add a reference to the count "refs".
+ *
+ * @param refs
+ */
+inline auto count_up(std::uint32_t &refs) -> void {
+    if (threads_share_values.load(std::memory_order_relaxed)) {
+        std::atomic_ref<std::uint32_t>(refs).fetch_add(1, std::memory_order_relaxed);
+    }
+    else {
+        ++refs;
+    }
+}
+
+/**
+ * @brief Drop a reference from the count "refs" and return whether it
+ *        was the last one. Dropping it orders every use of the object
+ *        made through it before the object is freed by whichever thread
+ *        drops the last one.
+ *
+ * @param refs
+ * @return bool
+ */
+inline auto count_down(std::uint32_t &refs) -> bool {
+    if (threads_share_values.load(std::memory_order_relaxed)) {
+        return std::atomic_ref<std::uint32_t>(refs).fetch_sub(1, std::memory_order_acq_rel) == 1;
+    }
+    return --refs == 0;
+}
+
+#endif // LISP_REFCOUNT_H
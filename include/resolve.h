@@ -0,0 +1,22 @@
+#ifndef LISP_RESOLVE_H
+#define LISP_RESOLVE_H
+
+#include "ast.h"
+#include "node.h"
+#include "result.h"
+
+/**
+ * @brief Mark the special forms under "root" and bind every symbol to where
+ *        its value lives: a (depth, slot) pair into the enclosing frames,
+ *        or the global slot of the symbol. Calls whose head names a local
+ *        lose the built-in the parser bound them to. Returns an error for
+ *        malformed special forms. Must run before anything else rewrites
+ *        the tree.
+ *
+ * @param ast
+ * @param root
+ * @return Result<void>
+ */
+extern auto resolve(Ast &ast, NodeId root) -> Result<void>;
+
+#endif // LISP_RESOLVE_H
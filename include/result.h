@@ -0,0 +1,138 @@
+#ifndef LISP_RESULT_H
+#define LISP_RESULT_H
+
+#include "error.h"
+
+#include <memory>
+#include <utility>
+
+/**
+ * @brief Struct holding either a value or the Error that kept it from being
+ *        made. The parser, the resolver and the VM hand errors back up through
+ *        it instead of throwing them, since bad input is common enough at a
+ *        REPL that unwinding once per frame adds up. Builtins and the
+ *        tree-walker don't return results, as checking after every node
+ *        slowed it down: they raise errors on the calling thread instead,
+ *        which are looked at where calls are made and made into a result
+ *        once per form. Only the API boundary throws after that. The error
+ *        is kept on the heap, so on the hot path a result is just its
+ *        value and a null pointer.
+ */
+template <typename T>
+struct [[nodiscard]] Result final {
+    /**
+     * @brief Construct a new Result object holding "value".
+     *
+     * @param value
+     */
+    inline Result(T value)
+        : held(std::move(value)) {
+    }
+
+    /**
+     * @brief Construct a new Result object holding "error".
+     *
+     * @param error
+     */
+    inline Result(Error error)
+        : held(), failure(std::make_unique<Error>(std::move(error))) {
+    }
+
+    /**
+     * @brief Return whether this holds a value rather than an error.
+     *
+     * @return bool
+     */
+    inline auto ok() const -> bool {
+        return this->failure == nullptr;
+    }
+
+    /**
+     * @brief Return the value held. Only called once ok() said there is one.
+     *
+     * @return T&
+     */
+    inline auto value() -> T& {
+        return this->held;
+    }
+
+    /**
+     * @brief Return the error held. Only called once ok() said there is one.
+     *
+     * @return Error&
+     */
+    inline auto error() -> Error& {
+        return *this->failure;
+    }
+
+    /**
+     * @brief Return the value held, or throw the error held, where
+     *        the result leaves for code that expects errors thrown.
+     *
+     * @return T
+     */
+    inline auto take() -> T {
+        if (!this->ok()) [[unlikely]] {
+            throw std::move(*this->failure);
+        }
+        return std::move(this->held);
+    }
+
+private:
+    T held;                         // left as made by default on an error
+    std::unique_ptr<Error> failure; // null unless there is an error
+};
+
+/**
+ * @brief Struct holding nothing, or the Error that kept whatever
+ *        it stands for from being done.
+ */
+template <>
+struct [[nodiscard]] Result<void> final {
+    /**
+     * @brief Construct a new Result object for something that went fine.
+     */
+    inline Result() = default;
+
+    /**
+     * @brief Construct a new Result object holding "error".
+     *
+     * @param error
+     */
+    inline Result(Error error)
+        : failure(std::make_unique<Error>(std::move(error))) {
+    }
+
+    /**
+     * @brief Return whether this holds no error.
+     *
+     * @return bool
+     */
+    inline auto ok() const -> bool {
+        return this->failure == nullptr;
+    }
+
+    /**
+     * @brief Return the error held. Only called once ok() said there is one.
+     *
+     * @return Error&
+     */
+    inline auto error() -> Error& {
+        return *this->failure;
+    }
+
+    /**
+     * @brief Throw the error held, if any, where the result
+     *        leaves for code that expects errors thrown.
+     */
+    inline auto take() -> void {
+        if (!this->ok()) [[unlikely]] {
+            throw std::move(*this->failure);
+        }
+    }
+
+private:
+    std::unique_ptr<Error> failure;
+};
+
+#endif // LISP_RESULT_H
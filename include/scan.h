@@ -0,0 +1,53 @@
+#ifndef LISP_SCAN_H
+#define LISP_SCAN_H
+
+#include <cstdint>
+
+/**
+ * @brief Enum representing the instruction sets the scanners can use.
+ */
+enum struct ScanLevel : std::uint8_t {
+    SCALAR,
+    SSE2,
+    AVX2,
+};
+
+/**
+ * @brief Return the first byte in [begin, end) that is not a space,
+ *        tab or newline, or "end" if there is none.
+ *
+ * @param begin
+ * @param end
+ * @return const char*
+ */
+extern auto skip_space(const char *begin, const char *end) -> const char*;
+
+/**
+ * @brief Return the first "c" in [begin, end), or "end" if there is none.
+ *        Used to find the end of comments and string constants.
+ *
+ * @param begin
+ * @param end
+ * @param c
+ * @return const char*
+ */
+extern auto find_byte(const char *begin, const char *end, char c) -> const char*;
+
+/**
+ * @brief Return the instruction set the scanners are currently using.
+ *
+ * @return ScanLevel
+ */
+extern auto scan_level() -> ScanLevel;
+
+/**
+ * @brief Force the scanners to "level", clamped to what the CPU
+ *        supports, and return the level actually picked. Only
+ *        meant for benchmarks comparing implementations.
+ *
+ * @param level
+ * @return ScanLevel
+ */
+extern auto set_scan_level(ScanLevel level) -> ScanLevel;
+
+#endif // LISP_SCAN_H
@@ -0,0 +1,61 @@
+#ifndef LISP_SCHEDULE_H
+#define LISP_SCHEDULE_H
+
+#include "ast.h"
+#include "node.h"
+#include "symbol.h"
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Struct representing the global variables a top-level form may
+ *        read or write, found by looking at its resolved tree. Reads made
+ *        by the bodies of the functions it calls are not in here, since
+ *        which functions those are is only known from the forms before it.
+ */
+struct Effects final {
+    std::vector<SymbolId> reads;
+    std::vector<SymbolId> writes;
+    std::vector<SymbolId> call_writes; // written by the bodies of its functions
+    bool sets_locals;                  // a function body assigns to a local, which calls may share
+};
+
+/**
+ * @brief Struct representing the order top-level forms have to run in:
+ *        a form may only start once every form it waits for is done.
+ *        Forms not linked to each other in any way can run at the same time.
+ */
+struct FormGraph final {
+    std::vector<std::vector<std::uint32_t>> successors; // the forms waiting for each form
+    std::vector<std::uint32_t> predecessors;            // how many forms each form waits for
+};
+
+/**
+ * @brief Return the globals the resolved top-level form "root" of "ast"
+ *        may read or write. Built-in names are left out since they can't
+ *        be defined, and so are the names special forms bind locally.
+ *
+ * @param ast
+ * @param root
+ * @return Effects
+ */
+extern auto collect_effects(const Ast &ast, NodeId root) -> Effects;
+
+/**
+ * @brief Work out which of the top-level forms with "effects", given in
+ *        source order, have to wait for which earlier ones. A form waits
+ *        for the last form before it that wrote a global it reads or
+ *        writes, and for every form since then that read a global it
+ *        writes. Using a global counts as doing what the bodies of the
+ *        functions in it do: reading whatever the forms that wrote it
+ *        read and writing whatever those bodies write. Functions whose
+ *        bodies assign to locals may share that state between calls,
+ *        so using one counts as writing it too.
+ *
+ * @param effects
+ * @return FormGraph
+ */
+extern auto order_forms(const std::vector<Effects> &effects) -> FormGraph;
+
+#endif // LISP_SCHEDULE_H
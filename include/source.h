@@ -0,0 +1,43 @@
+#ifndef LISP_SOURCE_H
+#define LISP_SOURCE_H
+
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Struct owning the bytes of a script file. Regular files are
+ *        memory-mapped so reading them never copies; anything that can't
+ *        be mapped is read into a buffer instead.
+ */
+struct Source final {
+    /**
+     * @brief Construct a new Source object from the file at "path".
+     *        Errors if the file can't be opened or read.
+     *
+     * @param path
+     */
+    explicit Source(const char *path);
+
+    Source(const Source&) = delete;
+    auto operator=(const Source&) -> Source& = delete;
+
+    /**
+     * @brief Destroy the Source object and unmap the file.
+     */
+    ~Source();
+
+    /**
+     * @brief Return the contents of the file.
+     *
+     * @return std::string_view
+     */
+    auto view() const -> std::string_view;
+
+private:
+    const char *data;
+    std::size_t size;
+    bool mapped;
+    std::string buffer;
+};
+
+#endif // LISP_SOURCE_H
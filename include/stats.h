@@ -0,0 +1,48 @@
+#ifndef LISP_STATS_H
+#define LISP_STATS_H
+
+#include <atomic>
+#include <cstddef>
+
+// Counts are taken by the global operator new of src/alloc.cc, which only
+// the lisp executable and the benchmarks link in. liblisp.a leaves the
+// allocator of its host alone, so counts stay at zero there unless the
+// host calls count_allocation from an operator new of its own.
+
+/**
+ * @brief Set once counting is started with start_counting_allocations and
+ *        never cleared, so an allocation only costs a relaxed load while
+ *        it is off.
+ */
+inline std::atomic<bool> counting_allocations {false};
+
+/**
+ * @brief Start counting allocations. Counts only cover what was
+ *        allocated from then on.
+ */
+extern auto start_counting_allocations() -> void;
+
+/**
+ * @brief Return how many times operator new has been called so far
+ *        on all threads together.
+ *
+ * @return std::size_t
+ */
+extern auto allocation_count() -> std::size_t;
+
+/**
+ * @brief Return how many times operator new has been called so far
+ *        on the calling thread.
+ *
+ * @return std::size_t
+ */
+extern auto thread_allocation_count() -> std::size_t;
+
+/**
+ * @brief Count an allocation on the calling thread, putting its counter
+ *        on the list the first time. Allocations made while the thread
+ *        exits, after its counter is gone, are not counted.
+ */
+extern auto count_allocation() -> void;
+
+#endif // LISP_STATS_H
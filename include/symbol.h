@@ -0,0 +1,50 @@
+#ifndef LISP_SYMBOL_H
+#define LISP_SYMBOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <optional>
+
+/**
+ * @brief Index of a symbol inside of the global symbol table, which every
+ *        interpreter in the process shares, so ids mean the same to all.
+ *        Two symbols are the same name exactly when their ids match.
+ */
+using SymbolId = std::uint32_t;
+
+/**
+ * @brief Return the id of the symbol "name", adding it to the
+ *        global symbol table the first time it is seen.
+ *
+ * @param name
+ * @return SymbolId
+ */
+extern auto intern_symbol(std::string_view name) -> SymbolId;
+
+/**
+ * @brief Return the id of the symbol "name" without adding it
+ *        to the global symbol table.
+ *
+ * @param name
+ * @return std::optional<SymbolId>
+ */
+extern auto find_symbol(std::string_view name) -> std::optional<SymbolId>;
+
+/**
+ * @brief Return the name of the symbol "id".
+ *
+ * @param id
+ * @return std::string_view
+ */
+extern auto symbol_name(SymbolId id) -> std::string_view;
+
+/**
+ * @brief Return how many symbols have been interned so far,
+ *        which is one more than the largest id given out.
+ *
+ * @return std::size_t
+ */
+extern auto symbol_count() -> std::size_t;
+
+#endif // LISP_SYMBOL_H
@@ -1,32 +1,106 @@
 #ifndef LISP_TEXT_H
 #define LISP_TEXT_H
 
-#include <string>
-#include <functional>
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * @brief Bit flags describing what a byte can be part of.
+ *        Scanning tests a flag in a 256 entry table instead
+ *        of calling through a predicate for every character.
+ */
+enum CharClass : std::uint8_t {
+    CHAR_SPACE        = 1 << 0,
+    CHAR_DIGIT        = 1 << 1,
+    CHAR_SYMBOL_START = 1 << 2,
+    CHAR_SYMBOL       = 1 << 3,
+};
+
+/**
+ * @brief Table mapping every byte to its CharClass flags.
+ */
+inline constexpr std::array<std::uint8_t, 256> char_classes = [] {
+    std::array<std::uint8_t, 256> table {};
+
+    for (int c = 0; c < 256; ++c) {
+        const bool digit = c >= '0' && c <= '9';
+        const bool alpha = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+
+        if (c == ' ' || c == '\n' || c == '\t') {
+            table[c] |= CHAR_SPACE;
+        }
+        if (digit) {
+            table[c] |= CHAR_DIGIT;
+        }
+        if (alpha || c == '_') {
+            table[c] |= CHAR_SYMBOL_START;
+        }
+        // a '-' can't start a symbol since it starts negative numbers
+        if (alpha || digit || c == '_' || c == '-') {
+            table[c] |= CHAR_SYMBOL;
+        }
+    }
+    return table;
+}();
+
+/**
+ * @brief Return whether "c" has any of the flags in "mask".
+ *
+ * @param c
+ * @param mask
+ * @return bool
+ */
+inline auto is_class(char c, std::uint8_t mask) -> bool {
+    return (char_classes[static_cast<unsigned char>(c)] & mask) != 0;
+}
+
+/**
+ * @brief Struct representing a place in a source as people count it.
+ */
+struct TextPosition final {
+    std::size_t line;   // counting from 1
+    std::size_t column; // counting bytes from 1
+};
+
+/**
+ * @brief Return the line and column of the byte at "offset" in "text".
+ *        Lines are counted here rather than while lexing, since this is
+ *        only ever needed to report an error.
+ *
+ * @param text
+ * @param offset
+ * @return TextPosition
+ */
+extern auto position_of(std::string_view text, std::size_t offset) -> TextPosition;
 
 /**
  * @brief Struct used to represent an easily
- *        tokenizable piece of text.
+ *        tokenizable piece of text. It only views
+ *        the source, which has to outlive it.
  */
 struct Text final {
-    std::string contents;
+    std::string_view contents;
     std::size_t position, size;
+    std::size_t origin; // where "contents" starts in the whole source
 
     /**
-     * @brief Construct a new Text object.
+     * @brief Construct a new Text object for "contents", which
+     *        starts "origin" bytes into the source it is part of.
      *
      * @param contents
+     * @param origin
      */
-    Text(const std::string &contents = {});
+    Text(std::string_view contents = {}, std::size_t origin = 0);
 
     /**
      * @brief Operator overloading just to type less when accessing an index.
-     *        Throws std::out_of_range exception if the index is out of bounds.
+     *        Aborts if the index is out of bounds.
      *
      * @param index
-     * @return char&
+     * @return char
      */
-    auto operator[](const std::size_t index) -> char&;
+    auto operator[](const std::size_t index) const -> char;
 
     /**
      * @brief Return the current character in the string.
@@ -37,23 +111,40 @@ struct Text final {
     auto curr() const -> char;
 
     /**
-     * @brief Begin from "this->position" and stop
-     *        once the lambda "check" returns false.
+     * @brief Begin from "this->position" and stop at the first
+     *        character that has none of the flags in "mask".
      *        Great for discovering where specific
      *        portions of text end.
      *
-     * @param check
+     * @param mask
+     * @return std::size_t
+     */
+    auto find(std::uint8_t mask) const -> std::size_t;
+
+    /**
+     * @brief Begin from "this->position" and return the index of the
+     *        first non-whitespace character, or "this->size" if there is none.
+     *
+     * @return std::size_t
+     */
+    auto skip_space() const -> std::size_t;
+
+    /**
+     * @brief Begin from "this->position" and return the index
+     *        of the first "c", or "this->size" if there is none.
+     *
+     * @param c
      * @return std::size_t
      */
-    auto find(std::function<bool(char)> check)  -> std::size_t;
+    auto find_char(char c) const -> std::size_t;
 
     /**
-     * @brief Return a substring from "this->position" up until "end".
+     * @brief Return a view from "this->position" up until "end".
      *
      * @param end
-     * @return std::string
+     * @return std::string_view
      */
-    auto substr(std::size_t end) const  -> std::string;
+    auto substr(std::size_t end) const -> std::string_view;
 };
 
 #endif // LISP_TEXT_H
@@ -1,9 +1,11 @@
 #ifndef LISP_TOKEN_H
 #define LISP_TOKEN_H
 
+#include <cstddef>
 #include <cstdint>
 #include <variant>
 #include <string>
+#include <string_view>
 
 /**
  * @brief Enum used to represent the types of tokens within the language.
@@ -19,17 +21,23 @@ enum struct TokenType : std::uint8_t {
 
 /**
  * @brief Struct used to represent the constructs that make up the language.
+ *        Strings and symbols view the source text instead of copying it.
+ *        Number constants hold a 64 bit integer, a real, or the digits of
+ *        an integer too large for either of those to hold exactly. Tokens
+ *        know where they start in the source, which fits in the padding
+ *        after their type.
  */
 struct Token final {
     TokenType type;
-    std::variant<int, std::string> value;
+    std::uint32_t offset; // scripts are taken to be under 4 GiB
+    std::variant<std::int64_t, double, std::string_view> value;
 
     /**
      * @brief Construct a new Token object.
      */
     Token();
-    inline Token(TokenType type, const auto &value)
-        : type(type), value(value) {
+    inline Token(TokenType type, const auto &value, std::size_t offset = 0)
+        : type(type), offset(static_cast<std::uint32_t>(offset)), value(value) {
     }
 
     /**
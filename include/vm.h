@@ -0,0 +1,68 @@
+#ifndef LISP_VM_H
+#define LISP_VM_H
+
+#include "bytecode.h"
+#include "data.h"
+#include "env.h"
+#include "function.h"
+#include "ref.h"
+#include "result.h"
+
+#include <vector>
+
+/**
+ * @brief Struct representing a function call the VM will return to.
+ *        Calls between user functions push one of these instead of
+ *        recursing on the native stack.
+ */
+struct Frame final {
+    const Chunk *chunk;
+    const std::uint8_t *ip;
+    Ref<Env> scope;
+    Ref<Function> function; // keeps "chunk" alive, null for a top-level form
+};
+
+/**
+ * @brief Struct representing the stack machine that executes compiled chunks.
+ *        The value stack and the chunk forms are compiled into are kept
+ *        between runs so their storage is reused. Global variables
+ *        live in a table shared with the tree-walking evaluator.
+ */
+struct Vm final {
+    std::vector<Data> stack;
+    std::vector<Frame> frames;
+    Chunk chunk;
+    Globals &globals;
+
+    /**
+     * @brief Construct a new Vm object reading and
+     *        writing global variables in "globals".
+     *
+     * @param globals
+     */
+    explicit Vm(Globals &globals);
+
+    /**
+     * @brief Execute "chunk" from its first instruction in the frame
+     *        "scope", null at the top level, and return the value left
+     *        on top of the stack, or the error that stopped it.
+     *
+     * @param chunk
+     * @param scope
+     * @return Result<Data>
+     */
+    auto run(const Chunk &chunk, Ref<Env> scope = Ref<Env>()) -> Result<Data>;
+
+    /**
+     * @brief Call "closure" with "args" and return its result. Used by
+     *        builtins that take a function, from inside of a run or not,
+     *        so errors are raised the way builtins raise their own.
+     *
+     * @param closure
+     * @param args
+     * @return Data
+     */
+    auto call(const Closure &closure, Args args) -> Data;
+};
+
+#endif // LISP_VM_H
@@ -0,0 +1,59 @@
+#include "../include/stats.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Every allocation made by the standard library and by the interpreter
+// itself goes through the replaceable global operator new, so counting
+// here sees all of them. Only the executable links this in, since a
+// library must not replace the allocator of the program it is part of.
+
+/**
+ * @brief Allocate "size" bytes, counting the allocation if counting
+ *        was started.
+ *
+ * @param size
+ * @return void*
+ */
+static auto counted_malloc(std::size_t size) -> void* {
+    if (counting_allocations.load(std::memory_order_relaxed)) [[unlikely]] {
+        count_allocation();
+    }
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+auto operator new(std::size_t size) -> void* {
+    if (auto p = counted_malloc(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+auto operator new[](std::size_t size) -> void* {
+    return ::operator new(size);
+}
+
+auto operator new(std::size_t size, const std::nothrow_t&) noexcept -> void* {
+    return counted_malloc(size);
+}
+
+auto operator new[](std::size_t size, const std::nothrow_t&) noexcept -> void* {
+    return counted_malloc(size);
+}
+
+auto operator delete(void *p) noexcept -> void {
+    std::free(p);
+}
+
+auto operator delete[](void *p) noexcept -> void {
+    std::free(p);
+}
+
+auto operator delete(void *p, std::size_t) noexcept -> void {
+    std::free(p);
+}
+
+auto operator delete[](void *p, std::size_t) noexcept -> void {
+    std::free(p);
+}
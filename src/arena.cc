@@ -0,0 +1,154 @@
+#include "../include/arena.h"
+
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+/**
+ * @brief The arena put in place by the innermost ArenaScope or TaskArena
+ *        of the calling thread, if any, and every arena the thread has
+ *        lent, the first "lent_arenas" of which are in use.
+ */
+static thread_local Arena *current_arena = nullptr;
+static thread_local std::vector<std::unique_ptr<Arena>> task_arenas;
+static thread_local std::size_t lent_arenas = 0;
+
+/**
+ * @brief Construct a new Arena object. No memory is taken until
+ *        the first allocation.
+ */
+Arena::Arena()
+    : first(nullptr), current(nullptr), cursor(nullptr), limit(nullptr) {
+}
+
+/**
+ * @brief Destroy the Arena object and give every block back.
+ */
+Arena::~Arena() {
+    while (this->first != nullptr) {
+        const auto next = this->first->next;
+        ::operator delete(this->first);
+        this->first = next;
+    }
+}
+
+/**
+ * @brief Forget everything allocated so far. Anything still pointing
+ *        into the arena must be dead before this is called.
+ */
+auto Arena::reset() -> void {
+    this->current = this->first;
+    if (this->first != nullptr) {
+        this->cursor = reinterpret_cast<std::byte*>(this->first + 1);
+        this->limit = this->cursor + this->first->size;
+    }
+}
+
+auto Arena::do_allocate(std::size_t bytes, std::size_t alignment) -> void* {
+    auto address = reinterpret_cast<std::uintptr_t>(this->cursor);
+    auto aligned = (address + alignment - 1) & ~(alignment - 1);
+
+    if (this->cursor == nullptr
+        || aligned + bytes > reinterpret_cast<std::uintptr_t>(this->limit)) {
+        this->next_block(bytes + alignment);
+
+        address = reinterpret_cast<std::uintptr_t>(this->cursor);
+        aligned = (address + alignment - 1) & ~(alignment - 1);
+    }
+
+    this->cursor = reinterpret_cast<std::byte*>(aligned + bytes);
+    return reinterpret_cast<void*>(aligned);
+}
+
+auto Arena::do_deallocate(void*, std::size_t, std::size_t) -> void {
+    // memory is only ever given back all at once by reset
+}
+
+auto Arena::do_is_equal(const std::pmr::memory_resource &other) const noexcept -> bool {
+    return this == &other;
+}
+
+/**
+ * @brief Move on to a block with room for "bytes" bytes, reusing
+ *        the next block if it is big enough and allocating otherwise.
+ *
+ * @param bytes
+ */
+auto Arena::next_block(std::size_t bytes) -> void {
+    const auto next = this->current != nullptr ? this->current->next : this->first;
+
+    if (next != nullptr && next->size >= bytes) {
+        this->current = next;
+    }
+    else {
+        const auto size = bytes > BLOCK_SIZE ? bytes : BLOCK_SIZE;
+        auto block = static_cast<Block*>(::operator new(sizeof(Block) + size));
+
+        block->size = size;
+        block->next = next;
+
+        if (this->current != nullptr) {
+            this->current->next = block;
+        }
+        else {
+            this->first = block;
+        }
+        this->current = block;
+    }
+
+    this->cursor = reinterpret_cast<std::byte*>(this->current + 1);
+    this->limit = this->cursor + this->current->size;
+}
+
+/**
+ * @brief Construct a new ArenaScope object making "arena"
+ *        the form arena of the calling thread.
+ *
+ * @param arena
+ */
+ArenaScope::ArenaScope(Arena &arena)
+    : previous(current_arena) {
+    current_arena = &arena;
+}
+
+/**
+ * @brief Destroy the ArenaScope object, putting back the arena before it.
+ */
+ArenaScope::~ArenaScope() {
+    current_arena = this->previous;
+}
+
+/**
+ * @brief Construct a new TaskArena object making an empty
+ *        arena the form arena of the calling thread.
+ */
+TaskArena::TaskArena()
+    : previous(current_arena) {
+    if (lent_arenas == task_arenas.size()) {
+        task_arenas.push_back(std::make_unique<Arena>());
+    }
+    current_arena = task_arenas[lent_arenas++].get();
+    current_arena->reset();
+}
+
+/**
+ * @brief Destroy the TaskArena object, putting back the arena before it.
+ */
+TaskArena::~TaskArena() {
+    --lent_arenas;
+    current_arena = this->previous;
+}
+
+/**
+ * @brief Return the arena holding the temporaries of the top-level form
+ *        being evaluated. It is reset before every form and REPL line.
+ *        Each thread has its own, as each one runs its own forms,
+ *        unless an ArenaScope or a TaskArena put another one in its place.
+ *
+ * @return Arena&
+ */
+auto form_arena() -> Arena& {
+    static thread_local Arena arena;
+    return current_arena != nullptr ? *current_arena : arena;
+}
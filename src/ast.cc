@@ -0,0 +1,272 @@
+#include "../include/ast.h"
+#include "../include/bignum.h"
+#include "../include/function.h"
+#include "../include/number.h"
+
+/**
+ * @brief Destroy the Ast object, dropping its references to functions
+ *        and big integers.
+ */
+Ast::~Ast() {
+    for (const auto function : this->functions) {
+        function->release();
+    }
+    for (const auto bignum : this->bignums) {
+        bignum->release();
+    }
+}
+
+/**
+ * @brief Append a number node and return its index.
+ *
+ * @param number
+ * @return NodeId
+ */
+auto Ast::add_number(std::int64_t number) -> NodeId {
+    Node node;
+    node.type = NodeType::NUM_CONSTANT;
+    node.number = number;
+
+    return this->append(node);
+}
+
+/**
+ * @brief Append a real node and return its index.
+ *
+ * @param real
+ * @return NodeId
+ */
+auto Ast::add_real(double real) -> NodeId {
+    Node node;
+    node.type = NodeType::REAL_CONSTANT;
+    node.real = real;
+
+    return this->append(node);
+}
+
+/**
+ * @brief Append a node for an integer literal too large for a number,
+ *        interning its digits and keeping "value", which must be what
+ *        they spell, and return its index. Takes a reference to "value".
+ *
+ * @param digits
+ * @param value
+ * @return NodeId
+ */
+auto Ast::add_bignum(std::string_view digits, BigInt *value) -> NodeId {
+    Node node;
+    node.type = NodeType::BIG_CONSTANT;
+    node.string = this->strings.intern(digits);
+    node.bignum = value;
+
+    value->retain();
+    this->bignums.push_back(value);
+    return this->append(node);
+}
+
+/**
+ * @brief Append a string node, interning its text, and return its index.
+ *
+ * @param text
+ * @return NodeId
+ */
+auto Ast::add_string(std::string_view text) -> NodeId {
+    Node node;
+    node.type = NodeType::STR_CONSTANT;
+    node.string = this->strings.intern(text);
+
+    return this->append(node);
+}
+
+/**
+ * @brief Append a symbol node, interning its name in the
+ *        global symbol table, and return its index.
+ *
+ * @param name
+ * @return NodeId
+ */
+auto Ast::add_symbol(std::string_view name) -> NodeId {
+    Node node;
+    node.type = NodeType::SYM_CONSTANT;
+    node.symbol = intern_symbol(name);
+
+    return this->append(node);
+}
+
+/**
+ * @brief Append a list node whose children are the last "count"
+ *        entries pushed onto the scratch stack, and return its index.
+ *
+ * @param count
+ * @return NodeId
+ */
+auto Ast::add_list(std::size_t count) -> NodeId {
+    Node node;
+    node.type = NodeType::LIST_CONSTANT;
+    node.size = static_cast<std::uint32_t>(count);
+    node.first = static_cast<std::uint32_t>(this->children.size());
+
+    const auto begin = this->scratch.end() - static_cast<std::ptrdiff_t>(count);
+    this->children.insert(this->children.end(), begin, this->scratch.end());
+    this->scratch.erase(begin, this->scratch.end());
+
+    return this->append(node);
+}
+
+/**
+ * @brief Push a finished child onto the scratch stack
+ *        until the list containing it is closed.
+ *
+ * @param id
+ */
+auto Ast::push_child(NodeId id) -> void {
+    this->scratch.push_back(id);
+}
+
+/**
+ * @brief Append a copy of the tree under "id" in "from", including what
+ *        the resolver bound it to and where it is in the source, and
+ *        return the index of its root.
+ *
+ * @param from
+ * @param id
+ * @return NodeId
+ */
+auto Ast::copy_tree(const Ast &from, NodeId id) -> NodeId {
+    const auto &node = from.nodes[id];
+    NodeId copy;
+
+    switch (node.type) {
+        case NodeType::STR_CONSTANT:
+            copy = this->add_string(from.text_of(id));
+            break;
+
+        case NodeType::BIG_CONSTANT:
+            copy = this->add_bignum(from.text_of(id), node.bignum);
+            break;
+
+        case NodeType::LIST_CONSTANT: {
+            for (const auto child : from.children_of(id)) {
+                this->push_child(this->copy_tree(from, child));
+            }
+            copy = this->add_list(node.size);
+
+            auto &list = this->nodes[copy];
+            list.form = node.form;
+            list.callee = node.callee;
+            break;
+        }
+
+        default:
+            copy = this->append(node);
+            break;
+    }
+
+    this->offsets[copy] = from.offsets[id];
+    return copy;
+}
+
+/**
+ * @brief Return the children of the list node "id".
+ *
+ * @param id
+ * @return std::span<const NodeId>
+ */
+auto Ast::children_of(NodeId id) const -> std::span<const NodeId> {
+    const auto &node = this->nodes[id];
+    return {this->children.data() + node.first, node.size};
+}
+
+/**
+ * @brief Return the text of the string, symbol or big integer node "id".
+ *
+ * @param id
+ * @return std::string_view
+ */
+auto Ast::text_of(NodeId id) const -> std::string_view {
+    const auto &node = this->nodes[id];
+    if (node.type == NodeType::SYM_CONSTANT) {
+        return symbol_name(node.symbol);
+    }
+    return this->strings.get(node.string)->view();
+}
+
+/**
+ * @brief Write the tree under "id" to "os" as an s-expression.
+ *
+ * @param id
+ * @param os
+ */
+auto Ast::print(NodeId id, std::ostream &os) const -> void {
+    const auto &node = this->nodes[id];
+
+    switch (node.type) {
+        case NodeType::NUM_CONSTANT:
+            os << node.number;
+            break;
+
+        case NodeType::STR_CONSTANT:
+            os << '"' << this->text_of(id) << '"';
+            break;
+
+        case NodeType::REAL_CONSTANT:
+            os << format_real(node.real);
+            break;
+
+        case NodeType::SYM_CONSTANT:
+        case NodeType::BIG_CONSTANT:
+            os << this->text_of(id);
+            break;
+
+        case NodeType::LIST_CONSTANT: {
+            const char *separator = "";
+
+            os << '(';
+            for (const auto child : this->children_of(id)) {
+                os << separator;
+                this->print(child, os);
+                separator = " ";
+            }
+            os << ')';
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Drop every node while keeping the allocated storage around
+ *        for the next form. Interned strings are kept too, so literals
+ *        repeated across forms are not allocated again, unless the pool
+ *        has outgrown STRING_POOL_LIMIT. Strings, big integers and
+ *        functions still referenced by values outlive the reset.
+ */
+auto Ast::reset() -> void {
+    for (const auto function : this->functions) {
+        function->release();
+    }
+    this->functions.clear();
+    for (const auto bignum : this->bignums) {
+        bignum->release();
+    }
+    this->bignums.clear();
+    this->caches.clear();
+    if (this->strings.size() > STRING_POOL_LIMIT) {
+        this->strings.clear();
+    }
+    this->nodes.clear();
+    this->offsets.clear();
+    this->children.clear();
+    this->scratch.clear();
+}
+
+/**
+ * @brief Append "node", with no offset yet, and return its index.
+ *
+ * @param node
+ * @return NodeId
+ */
+auto Ast::append(const Node &node) -> NodeId {
+    this->nodes.push_back(node);
+    this->offsets.push_back(0);
+    return static_cast<NodeId>(this->nodes.size() - 1);
+}
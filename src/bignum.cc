@@ -0,0 +1,391 @@
+#include "../include/bignum.h"
+
+#include <algorithm>
+#include <limits>
+
+/**
+ * @brief Magnitude of an integer, least significant limb first.
+ */
+using Limbs = std::vector<std::uint32_t>;
+
+/**
+ * @brief Drop the zero limbs at the top of "limbs".
+ *
+ * @param limbs
+ */
+static auto trim(Limbs &limbs) -> void {
+    while (!limbs.empty() && limbs.back() == 0) {
+        limbs.pop_back();
+    }
+}
+
+/**
+ * @brief Allocate an integer with one reference out of a sign and a magnitude.
+ *
+ * @param negative
+ * @param limbs
+ * @return BigInt*
+ */
+static auto make(bool negative, Limbs limbs) -> BigInt* {
+    trim(limbs);
+
+    auto big = new BigInt;
+    big->refs = 1;
+    big->negative = negative && !limbs.empty();
+    big->limbs = std::move(limbs);
+    return big;
+}
+
+/**
+ * @brief Return a negative number, zero or a positive number as the
+ *        magnitude "lhs" is less than, equal to or greater than "rhs".
+ *
+ * @param lhs
+ * @param rhs
+ * @return int
+ */
+static auto compare_magnitude(const Limbs &lhs, const Limbs &rhs) -> int {
+    if (lhs.size() != rhs.size()) {
+        return lhs.size() < rhs.size() ? -1 : 1;
+    }
+    for (auto i = lhs.size(); i-- != 0;) {
+        if (lhs[i] != rhs[i]) {
+            return lhs[i] < rhs[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Return the magnitude "lhs" + "rhs".
+ *
+ * @param lhs
+ * @param rhs
+ * @return Limbs
+ */
+static auto add_magnitude(const Limbs &lhs, const Limbs &rhs) -> Limbs {
+    const auto &longer = lhs.size() >= rhs.size() ? lhs : rhs;
+    const auto &shorter = lhs.size() >= rhs.size() ? rhs : lhs;
+
+    Limbs sum(longer.size() + 1);
+    std::uint64_t carry = 0;
+
+    for (std::size_t i = 0; i < longer.size(); ++i) {
+        carry += longer[i];
+        if (i < shorter.size()) {
+            carry += shorter[i];
+        }
+        sum[i] = static_cast<std::uint32_t>(carry);
+        carry >>= 32;
+    }
+    sum[longer.size()] = static_cast<std::uint32_t>(carry);
+    return sum;
+}
+
+/**
+ * @brief Return the magnitude "lhs" - "rhs", where "lhs" is the larger one.
+ *
+ * @param lhs
+ * @param rhs
+ * @return Limbs
+ */
+static auto sub_magnitude(const Limbs &lhs, const Limbs &rhs) -> Limbs {
+    Limbs difference(lhs.size());
+    std::int64_t borrow = 0;
+
+    for (std::size_t i = 0; i < lhs.size(); ++i) {
+        std::int64_t limb = static_cast<std::int64_t>(lhs[i]) - borrow;
+        if (i < rhs.size()) {
+            limb -= rhs[i];
+        }
+
+        borrow = limb < 0;
+        difference[i] = static_cast<std::uint32_t>(limb + (borrow << 32));
+    }
+    trim(difference);
+    return difference;
+}
+
+/**
+ * @brief Return the magnitude "lhs" * "rhs".
+ *
+ * @param lhs
+ * @param rhs
+ * @return Limbs
+ */
+static auto mul_magnitude(const Limbs &lhs, const Limbs &rhs) -> Limbs {
+    Limbs product(lhs.size() + rhs.size());
+
+    for (std::size_t i = 0; i < lhs.size(); ++i) {
+        std::uint64_t carry = 0;
+
+        for (std::size_t j = 0; j < rhs.size(); ++j) {
+            carry += static_cast<std::uint64_t>(lhs[i]) * rhs[j] + product[i + j];
+            product[i + j] = static_cast<std::uint32_t>(carry);
+            carry >>= 32;
+        }
+        product[i + rhs.size()] = static_cast<std::uint32_t>(carry);
+    }
+    trim(product);
+    return product;
+}
+
+/**
+ * @brief Divide the magnitude "limbs" by "divisor" in place and return the remainder.
+ *
+ * @param limbs
+ * @param divisor
+ * @return std::uint32_t
+ */
+static auto div_small(Limbs &limbs, std::uint32_t divisor) -> std::uint32_t {
+    std::uint64_t remainder = 0;
+
+    for (auto i = limbs.size(); i-- != 0;) {
+        const auto current = (remainder << 32) | limbs[i];
+        limbs[i] = static_cast<std::uint32_t>(current / divisor);
+        remainder = current % divisor;
+    }
+    trim(limbs);
+    return static_cast<std::uint32_t>(remainder);
+}
+
+/**
+ * @brief Return the magnitude "lhs" / "rhs" rounded down, "rhs" not being zero.
+ *        Divisors of one limb take a single pass, larger ones are divided a bit
+ *        at a time, which is quadratic but only ever runs on huge numbers.
+ *
+ * @param lhs
+ * @param rhs
+ * @return Limbs
+ */
+static auto div_magnitude(const Limbs &lhs, const Limbs &rhs) -> Limbs {
+    if (rhs.size() == 1) {
+        auto quotient = lhs;
+        div_small(quotient, rhs[0]);
+        return quotient;
+    }
+
+    Limbs quotient(lhs.size());
+    Limbs remainder;
+
+    for (auto bit = lhs.size() * 32; bit-- != 0;) {
+        // remainder = remainder * 2 + the next bit of lhs
+        std::uint32_t carry = (lhs[bit / 32] >> (bit % 32)) & 1;
+        for (auto &limb : remainder) {
+            const auto next = limb >> 31;
+            limb = (limb << 1) | carry;
+            carry = next;
+        }
+        if (carry != 0) {
+            remainder.push_back(carry);
+        }
+
+        if (compare_magnitude(remainder, rhs) >= 0) {
+            remainder = sub_magnitude(remainder, rhs);
+            quotient[bit / 32] |= std::uint32_t(1) << (bit % 32);
+        }
+    }
+    trim(quotient);
+    return quotient;
+}
+
+/**
+ * @brief Allocate an integer holding "value" with one reference.
+ *
+ * @param value
+ * @return BigInt*
+ */
+auto BigInt::from_int(std::int64_t value) -> BigInt* {
+    // negate in unsigned arithmetic so the smallest value does not overflow
+    const auto magnitude = value < 0 ? 0 - static_cast<std::uint64_t>(value)
+                                     : static_cast<std::uint64_t>(value);
+
+    return make(value < 0, {static_cast<std::uint32_t>(magnitude),
+                            static_cast<std::uint32_t>(magnitude >> 32)});
+}
+
+/**
+ * @brief Allocate an integer holding the decimal "text", which may start
+ *        with a '-', with one reference. Returns null if "text" is not
+ *        a decimal integer.
+ *
+ * @param text
+ * @return BigInt*
+ */
+auto BigInt::parse(std::string_view text) -> BigInt* {
+    const bool negative = !text.empty() && text.front() == '-';
+    if (negative) {
+        text.remove_prefix(1);
+    }
+    if (text.empty()) {
+        return nullptr;
+    }
+
+    Limbs limbs;
+
+    // feed the digits nine at a time, the most that fit in a limb
+    while (!text.empty()) {
+        const auto count = std::min<std::size_t>(9, text.size());
+        std::uint64_t chunk = 0;
+        std::uint64_t scale = 1;
+
+        for (const auto c : text.substr(0, count)) {
+            if (c < '0' || c > '9') {
+                return nullptr;
+            }
+            chunk = chunk * 10 + static_cast<std::uint64_t>(c - '0');
+            scale *= 10;
+        }
+        text.remove_prefix(count);
+
+        for (auto &limb : limbs) {
+            chunk += limb * scale;
+            limb = static_cast<std::uint32_t>(chunk);
+            chunk >>= 32;
+        }
+        if (chunk != 0) {
+            limbs.push_back(static_cast<std::uint32_t>(chunk));
+        }
+    }
+    return make(negative, std::move(limbs));
+}
+
+/**
+ * @brief Return the integer if it fits in 64 bits.
+ *
+ * @return std::optional<std::int64_t>
+ */
+auto BigInt::to_int() const -> std::optional<std::int64_t> {
+    if (this->limbs.size() > 2) {
+        return std::nullopt;
+    }
+
+    std::uint64_t magnitude = 0;
+    for (auto i = this->limbs.size(); i-- != 0;) {
+        magnitude = (magnitude << 32) | this->limbs[i];
+    }
+
+    constexpr auto max = static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max());
+    if (!this->negative && magnitude <= max) {
+        return static_cast<std::int64_t>(magnitude);
+    }
+    if (this->negative && magnitude <= max + 1) {
+        return static_cast<std::int64_t>(0 - magnitude);
+    }
+    return std::nullopt;
+}
+
+/**
+ * @brief Return the closest double to the integer.
+ *
+ * @return double
+ */
+auto BigInt::to_double() const -> double {
+    double value = 0.0;
+    for (auto i = this->limbs.size(); i-- != 0;) {
+        value = value * 4294967296.0 + this->limbs[i];
+    }
+    return this->negative ? -value : value;
+}
+
+/**
+ * @brief Return the integer written in decimal.
+ *
+ * @return std::string
+ */
+auto BigInt::to_string() const -> std::string {
+    if (this->limbs.empty()) {
+        return "0";
+    }
+
+    // peel off nine digits at a time from the bottom
+    auto limbs = this->limbs;
+    std::string digits;
+
+    while (!limbs.empty()) {
+        auto chunk = div_small(limbs, 1000000000);
+        for (int i = 0; i < 9 && (chunk != 0 || !limbs.empty()); ++i) {
+            digits += static_cast<char>('0' + chunk % 10);
+            chunk /= 10;
+        }
+    }
+    if (this->negative) {
+        digits += '-';
+    }
+    std::reverse(digits.begin(), digits.end());
+    return digits;
+}
+
+/**
+ * @brief Return a new integer holding "lhs" + "rhs" with one reference.
+ *
+ * @param lhs
+ * @param rhs
+ * @return BigInt*
+ */
+auto big_add(const BigInt &lhs, const BigInt &rhs) -> BigInt* {
+    if (lhs.negative == rhs.negative) {
+        return make(lhs.negative, add_magnitude(lhs.limbs, rhs.limbs));
+    }
+    if (compare_magnitude(lhs.limbs, rhs.limbs) >= 0) {
+        return make(lhs.negative, sub_magnitude(lhs.limbs, rhs.limbs));
+    }
+    return make(rhs.negative, sub_magnitude(rhs.limbs, lhs.limbs));
+}
+
+/**
+ * @brief Return a new integer holding "lhs" - "rhs" with one reference.
+ *
+ * @param lhs
+ * @param rhs
+ * @return BigInt*
+ */
+auto big_sub(const BigInt &lhs, const BigInt &rhs) -> BigInt* {
+    if (lhs.negative != rhs.negative) {
+        return make(lhs.negative, add_magnitude(lhs.limbs, rhs.limbs));
+    }
+    if (compare_magnitude(lhs.limbs, rhs.limbs) >= 0) {
+        return make(lhs.negative, sub_magnitude(lhs.limbs, rhs.limbs));
+    }
+    return make(!lhs.negative, sub_magnitude(rhs.limbs, lhs.limbs));
+}
+
+/**
+ * @brief Return a new integer holding "lhs" * "rhs" with one reference.
+ *
+ * @param lhs
+ * @param rhs
+ * @return BigInt*
+ */
+auto big_mul(const BigInt &lhs, const BigInt &rhs) -> BigInt* {
+    return make(lhs.negative != rhs.negative, mul_magnitude(lhs.limbs, rhs.limbs));
+}
+
+/**
+ * @brief Return a new integer holding "lhs" / "rhs" rounded towards zero,
+ *        like the division of built-in integers, with one reference.
+ *        "rhs" must not be zero.
+ *
+ * @param lhs
+ * @param rhs
+ * @return BigInt*
+ */
+auto big_div(const BigInt &lhs, const BigInt &rhs) -> BigInt* {
+    return make(lhs.negative != rhs.negative, div_magnitude(lhs.limbs, rhs.limbs));
+}
+
+/**
+ * @brief Return a negative number, zero or a positive number
+ *        as "lhs" is less than, equal to or greater than "rhs".
+ *
+ * @param lhs
+ * @param rhs
+ * @return int
+ */
+auto big_compare(const BigInt &lhs, const BigInt &rhs) -> int {
+    if (lhs.negative != rhs.negative) {
+        return lhs.negative ? -1 : 1;
+    }
+    const auto order = compare_magnitude(lhs.limbs, rhs.limbs);
+    return lhs.negative ? -order : order;
+}
@@ -1,119 +1,964 @@
 #include "../include/builtin.h"
 #include "../include/error.h"
+#include "../include/text.h"
+#include "../include/arena.h"
+#include "../include/number.h"
+#include "../include/kernel.h"
+#include "../include/ref.h"
+#include "../include/output.h"
+#include "../include/env.h"
+#include "../include/pool.h"
+#include "../include/profile.h"
+#include "../include/interpreter.h"
 
-#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
 
-auto builtin_println(std::deque<Data> &args) -> Node {
+/**
+ * @brief Struct pairing a built-in function with the name it is called by
+ *        and whether it is free of side effects.
+ */
+struct Builtin final {
+    const char *name;
+    BuiltinFn fn;
+    bool pure;
+};
+
+/**
+ * @brief Global table containing all the built-in functions of the language.
+ */
+static const Builtin built_in_functions[] {
+    {"println", builtin_println, false},
+    {"print", builtin_print, false},
+    {"eprintln", builtin_eprintln, false},
+    {"eprint", builtin_eprint, false},
+    {"concat", builtin_concat, true},
+    {"to_string", builtin_to_string, true},
+    {"to_number", builtin_to_number, true},
+    {"add", builtin_add, true},
+    {"sub", builtin_sub, true},
+    {"mul", builtin_mul, true},
+    {"div", builtin_div, true},
+    {"eq", builtin_eq, true},
+    {"lt", builtin_lt, true},
+    {"gt", builtin_gt, true},
+    // vectors are never constants, so building one ahead of time is wasted
+    {"vec", builtin_vec, false},
+    {"range", builtin_range, false},
+    {"vec-add", builtin_vec_add, false},
+    {"vec-mul", builtin_vec_mul, false},
+    {"vec-sum", builtin_vec_sum, true},
+    {"vec-dot", builtin_vec_dot, true},
+    {"pmap", builtin_pmap, false},
+    {"pfor-each", builtin_pfor_each, false},
+    {"preduce", builtin_preduce, false},
+};
+
+/**
+ * @brief Results of concat at least this long are built as ropes,
+ *        shorter ones are copied into a flat string.
+ */
+static constexpr std::size_t ROPE_THRESHOLD = 256;
+
+/**
+ * @brief Elements pmap, pfor-each and preduce run in a row before looking
+ *        for idle threads to hand work to, and the fewest they hand out.
+ *        Inputs of fewer than twice as many elements are never split.
+ */
+static constexpr std::size_t PIECE_SIZE = 32;
+
+/**
+ * @brief Return the built-in functions indexed by the symbol id of their
+ *        name, so resolving a symbol never hashes a string. Built on first
+ *        use, which also interns every built-in name.
+ *
+ * @return const std::vector<BuiltinFn>&
+ */
+static auto builtins_by_symbol() -> const std::vector<BuiltinFn>& {
+    static const auto table = [] {
+        std::vector<BuiltinFn> table;
+        for (const auto &builtin : built_in_functions) {
+            const auto symbol = intern_symbol(builtin.name);
+            if (symbol >= table.size()) {
+                table.resize(symbol + 1, nullptr);
+            }
+            table[symbol] = builtin.fn;
+        }
+        return table;
+    }();
+
+    return table;
+}
+
+/**
+ * @brief Return the built-in function named by the symbol "id",
+ *        or nullptr if there is none.
+ *
+ * @param id
+ * @return BuiltinFn
+ */
+auto find_builtin(SymbolId id) -> BuiltinFn {
+    const auto &table = builtins_by_symbol();
+    return id < table.size() ? table[id] : nullptr;
+}
+
+/**
+ * @brief Return the built-in function called "name",
+ *        or nullptr if there is none.
+ *
+ * @param name
+ * @return BuiltinFn
+ */
+auto find_builtin(std::string_view name) -> BuiltinFn {
+    builtins_by_symbol();
+
+    const auto symbol = find_symbol(name);
+    return symbol ? find_builtin(*symbol) : nullptr;
+}
+
+/**
+ * @brief Return whether "fn" is a built-in whose result depends only on
+ *        its arguments and which has no side effects, so calls to it with
+ *        constant arguments can be evaluated ahead of time.
+ *
+ * @param fn
+ * @return bool
+ */
+auto is_pure_builtin(BuiltinFn fn) -> bool {
+    for (const auto &builtin : built_in_functions) {
+        if (builtin.fn == fn) {
+            return builtin.pure;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Return the name "fn" is called by, or "?" if it is not a built-in.
+ *
+ * @param fn
+ * @return std::string_view
+ */
+auto builtin_name(BuiltinFn fn) -> std::string_view {
+    for (const auto &builtin : built_in_functions) {
+        if (builtin.fn == fn) {
+            return builtin.name;
+        }
+    }
+    return "?";
+}
+
+/**
+ * @brief Write "args" to standard error, followed by a newline if
+ *        "newline" is set, and flush it along with standard output.
+ *
+ * @param args
+ * @param newline
+ */
+static auto write_error_line(Args args, bool newline) -> void {
+    auto &error = standard_error();
+
+    standard_output().flush();
+    for (const auto &arg : args) {
+        error.write(arg);
+    }
+    if (newline) {
+        error.write('\n');
+    }
+    error.flush();
+}
+
+auto builtin_println(Args args) -> Data {
     if (args.empty()) {
-        quit("Invalid amount of arguments passed to (println x y ...)");
+        return fail(ErrorCode::ARITY, "Invalid amount of arguments passed to (println x y ...)");
     }
     builtin_print(args);
-    std::cout << '\n';
-    return Node();
+    standard_output().write('\n');
+    return Data();
 }
 
-auto builtin_print(std::deque<Data> &args) -> Node {
+auto builtin_print(Args args) -> Data {
     if (args.empty()) {
-        quit("Invalid amount of arguments passed to (print x y ...)");
+        return fail(ErrorCode::ARITY, "Invalid amount of arguments passed to (print x y ...)");
     }
+    auto &output = standard_output();
     for (const auto &arg : args) {
-        std::visit([](const auto &v){ std::cout << v; }, arg.value);
+        output.write(arg);
     }
-    return Node();
+    return Data();
 }
 
-auto builtin_eprintln(std::deque<Data> &args) -> Node {
+auto builtin_eprintln(Args args) -> Data {
     if (args.empty()) {
-        quit("Invalid amount of arguments passed to (eprintln x y ...)");
+        return fail(ErrorCode::ARITY, "Invalid amount of arguments passed to (eprintln x y ...)");
     }
-    builtin_eprint(args);
-    std::cerr << '\n';
-    return Node();
+    write_error_line(args, true);
+    return Data();
 }
 
-auto builtin_eprint(std::deque<Data> &args) -> Node {
+auto builtin_eprint(Args args) -> Data {
     if (args.empty()) {
-        quit("Invalid amount of arguments passed to (eprint x y ...)");
-    }
-    for (const auto &arg : args) {
-        std::visit([](const auto &v){ std::cerr << v; }, arg.value);
+        return fail(ErrorCode::ARITY, "Invalid amount of arguments passed to (eprint x y ...)");
     }
-    return Node();
+    write_error_line(args, false);
+    return Data();
 }
 
-auto builtin_concat(std::deque<Data> &args) -> Node {
+auto builtin_concat(Args args) -> Data {
     if (args.size() < 2) {
-        quit("Invalid amount of arguments passed to (concat x y ...)");
+        return fail(ErrorCode::ARITY, "Invalid amount of arguments passed to (concat x y ...)");
+    }
+    std::size_t size = 0;
+    for (const auto &arg : args) {
+        if (!arg.is_string()) {
+            return arg.reject("string");
+        }
+        size += arg.type == DataType::ROPE ? arg.rope->size : arg.string->size;
     }
-    std::string whole;
+
+    // large results share their arguments instead of copying them, which
+    // keeps nested concats linear in the length of the final text
+    if (size >= ROPE_THRESHOLD) {
+        std::vector<RopePart> parts;
+        parts.reserve(args.size());
+
+        for (const auto &arg : args) {
+            if (arg.type == DataType::ROPE) {
+                arg.rope->retain();
+                parts.push_back({nullptr, arg.rope});
+            }
+            else if (arg.string->size != 0) {
+                auto string = arg.string;
+                if (string->pinned()) {
+                    string = String::make(string->view());
+                }
+                else {
+                    string->retain();
+                }
+                parts.push_back({string, nullptr});
+            }
+        }
+        return Data::from_rope(Rope::make(std::move(parts)));
+    }
+
+    // size the result up front so every argument is copied exactly once
+    auto whole = String::make(size, form_arena());
+    auto out = whole->chars();
     for (const auto &arg : args) {
-        whole += std::get<std::string>(arg.value);
+        const auto part = arg.as_string();
+        out = std::copy(part.begin(), part.end(), out);
     }
-    return Node(NodeType::STR_CONSTANT, whole);
+    return Data::from_string(whole);
 }
 
-auto builtin_to_string(std::deque<Data> &args) -> Node {
+auto builtin_to_string(Args args) -> Data {
     if (args.size() != 1) {
-        quit("Invalid amount of arguments passed to (to_number x)");
+        return fail(ErrorCode::ARITY, "Invalid amount of arguments passed to (to_number x)");
     }
-    return Node(NodeType::STR_CONSTANT,
-                std::to_string(std::get<int>(args[0].value)));
+    const auto &arg = args[0];
+    if (!arg.is_numeric()) {
+        return arg.reject("number");
+    }
+
+    char digits[24];
+    std::string_view text;
+    std::string spelled; // reals and big integers are spelled out by their own printers
+
+    if (arg.type == DataType::NUMBER) {
+        const auto [end, ec] = std::to_chars(std::begin(digits), std::end(digits), arg.number);
+        text = std::string_view(digits, static_cast<std::size_t>(end - digits));
+    }
+    else {
+        spelled = arg.type == DataType::REAL ? format_real(arg.real) : arg.bignum->to_string();
+        text = spelled;
+    }
+
+    auto string = String::make(text.size(), form_arena());
+    std::copy(text.begin(), text.end(), string->chars());
+    return Data::from_string(string);
 }
 
-auto builtin_to_number(std::deque<Data> &args) -> Node {
+auto builtin_to_number(Args args) -> Data {
     if (args.size() != 1) {
-        quit("Invalid amount of arguments passed to (to_number x)");
+        return fail(ErrorCode::ARITY, "Invalid amount of arguments passed to (to_number x)");
     }
-    return Node(NodeType::NUM_CONSTANT,
-                std::stoi(std::get<std::string>(args[0].value)));
+    if (!args[0].is_string()) {
+        return args[0].reject("string");
+    }
+    auto text = args[0].as_string();
+    while (!text.empty() && is_class(text.front(), CHAR_SPACE)) {
+        text.remove_prefix(1);
+    }
+    // from_chars only takes a minus, one plus in front is skipped like stoi did
+    auto spelled = text;
+    if (spelled.size() > 1 && spelled.front() == '+' && spelled[1] != '-') {
+        spelled.remove_prefix(1);
+    }
+    const auto first = spelled.data();
+    const auto last = spelled.data() + spelled.size();
+
+    // the longest prefix that reads as a number decides what it becomes
+    std::int64_t number = 0;
+    const auto integer = std::from_chars(first, last, number);
+    double real = 0.0;
+    const auto floating = std::from_chars(first, last, real, std::chars_format::general);
+
+    if (floating.ec == std::errc() && floating.ptr > integer.ptr) {
+        return Data::from_real(real);
+    }
+    if (integer.ec == std::errc()) {
+        return Data::from_number(number);
+    }
+    if (integer.ec == std::errc::result_out_of_range) {
+        const auto digits = std::string_view(first, static_cast<std::size_t>(integer.ptr - first));
+        return Data::from_bignum(BigInt::parse(digits));
+    }
+    return fail(ErrorCode::VALUE, "Could not convert \"", std::string(text), "\" to a number");
 }
 
-auto builtin_add(std::deque<Data> &args) -> Node {
+auto builtin_add(Args args) -> Data {
     if (args.size() < 2) {
-        quit("Invalid amount of arguments passed to (add x y ...)");
+        return fail(ErrorCode::ARITY, "Invalid amount of arguments passed to (add x y ...)");
     }
-    int total = 0;
-    for (const auto &arg : args) {
-        total += std::get<int>(arg.value);
+    std::int64_t total = 0;
+
+    for (std::size_t i = 0; i < args.size(); ++i) {
+        std::int64_t next;
+        if (args[i].type != DataType::NUMBER || __builtin_add_overflow(total, args[i].number, &next)) {
+            return fold_numeric(BinaryOp::ADD, Data::from_number(total), args.subspan(i));
+        }
+        total = next;
     }
-    return Node(NodeType::NUM_CONSTANT, total);
+    return Data::from_number(total);
 }
 
-auto builtin_sub(std::deque<Data> &args) -> Node {
+auto builtin_sub(Args args) -> Data {
     if (args.size() < 2) {
-        quit("Invalid amount of arguments passed to (sub x y ...)");
+        return fail(ErrorCode::ARITY, "Invalid amount of arguments passed to (sub x y ...)");
+    }
+    if (args[0].type != DataType::NUMBER) {
+        return fold_numeric(BinaryOp::SUB, args[0], args.subspan(1));
     }
-    int total = std::get<int>(args[0].value);
-    args.pop_front();
+    std::int64_t total = args[0].number;
 
-    for (const auto &arg : args) {
-        total -= std::get<int>(arg.value);
+    for (std::size_t i = 1; i < args.size(); ++i) {
+        std::int64_t next;
+        if (args[i].type != DataType::NUMBER || __builtin_sub_overflow(total, args[i].number, &next)) {
+            return fold_numeric(BinaryOp::SUB, Data::from_number(total), args.subspan(i));
+        }
+        total = next;
     }
-    return Node(NodeType::NUM_CONSTANT, total);
+    return Data::from_number(total);
 }
 
-auto builtin_mul(std::deque<Data> &args) -> Node {
+auto builtin_mul(Args args) -> Data {
     if (args.size() < 2) {
-        quit("Invalid amount of arguments passed to (mul x y ...)");
+        return fail(ErrorCode::ARITY, "Invalid amount of arguments passed to (mul x y ...)");
     }
-    int total = std::get<int>(args[0].value);
-    args.pop_front();
+    if (args[0].type != DataType::NUMBER) {
+        return fold_numeric(BinaryOp::MUL, args[0], args.subspan(1));
+    }
+    std::int64_t total = args[0].number;
 
-    for (const auto &arg : args) {
-        total *= std::get<int>(arg.value);
+    for (std::size_t i = 1; i < args.size(); ++i) {
+        std::int64_t next;
+        if (args[i].type != DataType::NUMBER || __builtin_mul_overflow(total, args[i].number, &next)) {
+            return fold_numeric(BinaryOp::MUL, Data::from_number(total), args.subspan(i));
+        }
+        total = next;
     }
-    return Node(NodeType::NUM_CONSTANT, total);
+    return Data::from_number(total);
 }
 
-auto builtin_div(std::deque<Data> &args) -> Node {
+auto builtin_div(Args args) -> Data {
     if (args.size() < 2) {
-        quit("Invalid amount of arguments passed to (div x y ...)");
+        return fail(ErrorCode::ARITY, "Invalid amount of arguments passed to (div x y ...)");
+    }
+    // every case a plain quotient cannot handle is left to apply_numeric
+    return fold_numeric(BinaryOp::DIV, args[0], args.subspan(1));
+}
+
+auto builtin_eq(Args args) -> Data {
+    if (args.size() != 2) {
+        return fail(ErrorCode::ARITY, "Invalid amount of arguments passed to (eq x y)");
+    }
+    const auto &lhs = args[0];
+    const auto &rhs = args[1];
+
+    // numbers of different kinds compare by value, strings by their text
+    if (lhs.is_numeric() && rhs.is_numeric()) {
+        return Data::from_number(compare_numbers(lhs, rhs) == 0);
     }
-    int total = std::get<int>(args[0].value);
-    args.pop_front();
+    if (lhs.is_string() && rhs.is_string()) {
+        return Data::from_number(lhs.as_string() == rhs.as_string());
+    }
+    if (lhs.type != rhs.type) {
+        return Data::from_number(0);
+    }
+    switch (lhs.type) {
+        case DataType::SYMBOL:
+            return Data::from_number(lhs.symbol == rhs.symbol);
+
+        case DataType::CLOSURE:
+            return Data::from_number(lhs.closure == rhs.closure);
+
+        case DataType::VECTOR: {
+            const auto &left = *lhs.vector;
+            const auto &right = *rhs.vector;
+
+            if (left.kind != right.kind || left.size != right.size) {
+                return Data::from_number(0);
+            }
+            if (left.kind == VectorKind::INTS) {
+                return Data::from_number(std::equal(left.ints(), left.ints() + left.size, right.ints()));
+            }
+            return Data::from_number(std::equal(left.reals(), left.reals() + left.size, right.reals()));
+        }
+
+        default:
+            break;
+    }
+    return Data::from_number(0);
+}
+
+auto builtin_lt(Args args) -> Data {
+    if (args.size() != 2) {
+        return fail(ErrorCode::ARITY, "Invalid amount of arguments passed to (lt x y)");
+    }
+    return apply_numeric(BinaryOp::LT, args[0], args[1]);
+}
+
+auto builtin_gt(Args args) -> Data {
+    if (args.size() != 2) {
+        return fail(ErrorCode::ARITY, "Invalid amount of arguments passed to (gt x y)");
+    }
+    return apply_numeric(BinaryOp::GT, args[0], args[1]);
+}
+
+/**
+ * @brief Return whether "data" is a number that fits in a vector
+ *        element, raising an error if it is not.
+ *
+ * @param data
+ * @return bool
+ */
+static auto expect_element(const Data &data) -> bool {
+    if (data.type == DataType::BIGNUM) {
+        fail(ErrorCode::VALUE, "Vectors only hold numbers that fit in 64 bits!");
+        return false;
+    }
+    if (data.type != DataType::NUMBER && data.type != DataType::REAL) {
+        data.reject("number");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Return "vector" as a vector of reals, converting a copy
+ *        of it if it holds integers.
+ *
+ * @param vector
+ * @return Ref<Vector>
+ */
+static auto to_reals(const Vector &vector) -> Ref<Vector> {
+    if (vector.kind == VectorKind::REALS) {
+        return Ref<Vector>::share(const_cast<Vector*>(&vector));
+    }
+
+    Ref<Vector> reals(Vector::make(VectorKind::REALS, vector.size));
+    std::copy(vector.ints(), vector.ints() + vector.size, reals->reals());
+    return reals;
+}
+
+/**
+ * @brief Shared body of vec-add and vec-mul: apply "op" to the elements of
+ *        two vectors of the same size pairwise, or to every element of one
+ *        vector and a number. Integers stay integers unless a real shows up.
+ *
+ * @param args
+ * @param op
+ * @return Data
+ */
+static auto vector_binary(Args args, BinaryOp op) -> Data {
+    const auto usage = op == BinaryOp::ADD ? "(vec-add x y)" : "(vec-mul x y)";
+    if (args.size() != 2) {
+        return fail(ErrorCode::ARITY, "Invalid amount of arguments passed to ", usage);
+    }
+
+    // both operations commute, so keep the vector on the left
+    const auto *lhs = &args[0];
+    const auto *rhs = &args[1];
+    if (lhs->type != DataType::VECTOR) {
+        std::swap(lhs, rhs);
+    }
+    if (lhs->type != DataType::VECTOR) {
+        return lhs->reject("vector");
+    }
+
+    const auto &vector = lhs->as_vector();
+    const bool broadcast = rhs->type != DataType::VECTOR;
+    if (broadcast && !expect_element(*rhs)) {
+        return Data();
+    }
+    if (!broadcast && rhs->vector->size != vector.size) {
+        return fail(ErrorCode::VALUE, "Vectors of different sizes passed to ", usage);
+    }
+
+    const auto rhs_kind = broadcast ? (rhs->type == DataType::REAL ? VectorKind::REALS : VectorKind::INTS)
+                                    : rhs->vector->kind;
+
+    if (vector.kind == VectorKind::INTS && rhs_kind == VectorKind::INTS) {
+        const auto right = broadcast ? &rhs->number : rhs->vector->ints();
+        auto out = Vector::make(VectorKind::INTS, vector.size);
+
+        const bool fits = op == BinaryOp::ADD
+                        ? add_ints(vector.ints(), right, out->ints(), vector.size, broadcast)
+                        : mul_ints(vector.ints(), right, out->ints(), vector.size, broadcast);
+        if (!fits) {
+            out->release();
+            return fail(ErrorCode::VALUE, "Integer overflow in ", usage);
+        }
+        return Data::from_vector(out);
+    }
+
+    const auto left = to_reals(vector);
+    Ref<Vector> right_vector;
+    double scalar = 0.0;
+
+    if (broadcast) {
+        scalar = rhs->type == DataType::REAL ? rhs->real : static_cast<double>(rhs->number);
+    }
+    else {
+        right_vector = to_reals(*rhs->vector);
+    }
+    const auto right = broadcast ? &scalar : right_vector->reals();
+
+    auto out = Vector::make(VectorKind::REALS, vector.size);
+    if (op == BinaryOp::ADD) {
+        add_reals(left->reals(), right, out->reals(), vector.size, broadcast);
+    }
+    else {
+        mul_reals(left->reals(), right, out->reals(), vector.size, broadcast);
+    }
+    return Data::from_vector(out);
+}
 
+auto builtin_vec(Args args) -> Data {
+    bool reals = false;
     for (const auto &arg : args) {
-        total /= std::get<int>(arg.value);
+        if (!expect_element(arg)) {
+            return Data();
+        }
+        reals |= arg.type == DataType::REAL;
+    }
+
+    const auto vector = Vector::make(reals ? VectorKind::REALS : VectorKind::INTS, args.size());
+    for (std::size_t i = 0; i < args.size(); ++i) {
+        if (!reals) {
+            vector->ints()[i] = args[i].number;
+        }
+        else {
+            vector->reals()[i] = args[i].type == DataType::REAL ? args[i].real
+                                                                : static_cast<double>(args[i].number);
+        }
+    }
+    return Data::from_vector(vector);
+}
+
+auto builtin_range(Args args) -> Data {
+    if (args.empty() || args.size() > 3) {
+        return fail(ErrorCode::ARITY, "Invalid amount of arguments passed to (range start end step)");
+    }
+    for (const auto &arg : args) {
+        if (arg.type != DataType::NUMBER) {
+            return arg.reject("number");
+        }
+    }
+    const std::int64_t start = args.size() == 1 ? 0 : args[0].as_number();
+    const std::int64_t end = args.size() == 1 ? args[0].as_number() : args[1].as_number();
+    const std::int64_t step = args.size() == 3 ? args[2].as_number() : 1;
+
+    if (step == 0) {
+        return fail(ErrorCode::VALUE, "Step of zero passed to (range start end step)");
+    }
+
+    // count in 128 bits so ranges spanning most of the 64 bit line do not overflow
+    const auto span = step > 0 ? static_cast<__int128>(end) - start : static_cast<__int128>(start) - end;
+    const auto stride = step > 0 ? static_cast<__int128>(step) : -static_cast<__int128>(step);
+    const auto count = span > 0 ? (span + stride - 1) / stride : 0;
+
+    if (count > std::numeric_limits<std::ptrdiff_t>::max() / static_cast<std::ptrdiff_t>(sizeof(std::int64_t))) {
+        return fail(ErrorCode::LIMIT, "Range passed to (range start end step) is too large!");
+    }
+
+    const auto vector = Vector::make(VectorKind::INTS, static_cast<std::size_t>(count));
+    auto value = start;
+    for (std::size_t i = 0; i < vector->size; ++i) {
+        vector->ints()[i] = value;
+        value += i + 1 < vector->size ? step : 0;
+    }
+    return Data::from_vector(vector);
+}
+
+auto builtin_vec_add(Args args) -> Data {
+    return vector_binary(args, BinaryOp::ADD);
+}
+
+auto builtin_vec_mul(Args args) -> Data {
+    return vector_binary(args, BinaryOp::MUL);
+}
+
+auto builtin_vec_sum(Args args) -> Data {
+    if (args.size() != 1) {
+        return fail(ErrorCode::ARITY, "Invalid amount of arguments passed to (vec-sum x)");
+    }
+    if (args[0].type != DataType::VECTOR) {
+        return args[0].reject("vector");
+    }
+    const auto &vector = args[0].as_vector();
+
+    if (vector.kind == VectorKind::REALS) {
+        return Data::from_real(sum_reals(vector.reals(), vector.size));
+    }
+
+    std::int64_t total;
+    if (sum_ints(vector.ints(), vector.size, total)) {
+        return Data::from_number(total);
+    }
+
+    // too large for 64 bits, so add it up exactly into a big integer
+    auto sum = Data::from_number(0);
+    for (std::size_t i = 0; i < vector.size; ++i) {
+        sum = apply_numeric(BinaryOp::ADD, sum, Data::from_number(vector.ints()[i]));
+    }
+    return sum;
+}
+
+auto builtin_vec_dot(Args args) -> Data {
+    if (args.size() != 2) {
+        return fail(ErrorCode::ARITY, "Invalid amount of arguments passed to (vec-dot x y)");
+    }
+    for (const auto &arg : args) {
+        if (arg.type != DataType::VECTOR) {
+            return arg.reject("vector");
+        }
+    }
+    const auto &lhs = args[0].as_vector();
+    const auto &rhs = args[1].as_vector();
+
+    if (lhs.size != rhs.size) {
+        return fail(ErrorCode::VALUE, "Vectors of different sizes passed to (vec-dot x y)");
+    }
+
+    if (lhs.kind == VectorKind::REALS || rhs.kind == VectorKind::REALS) {
+        const auto left = to_reals(lhs);
+        const auto right = to_reals(rhs);
+        return Data::from_real(dot_reals(left->reals(), right->reals(), lhs.size));
+    }
+
+    // there is no vector multiply for 64 bit integers, so these go one by one
+    std::int64_t total = 0;
+    for (std::size_t i = 0; i < lhs.size; ++i) {
+        std::int64_t product;
+        if (__builtin_mul_overflow(lhs.ints()[i], rhs.ints()[i], &product)
+            || __builtin_add_overflow(total, product, &total)) {
+            auto sum = Data::from_number(0);
+            for (std::size_t j = 0; j < lhs.size; ++j) {
+                const auto exact = apply_numeric(BinaryOp::MUL, Data::from_number(lhs.ints()[j]),
+                                                 Data::from_number(rhs.ints()[j]));
+                sum = apply_numeric(BinaryOp::ADD, sum, exact);
+            }
+            return sum;
+        }
+    }
+    return Data::from_number(total);
+}
+
+/**
+ * @brief Return element "index" of "vector" as a number.
+ *
+ * @param vector
+ * @param index
+ * @return Data
+ */
+static auto element_at(const Vector &vector, std::size_t index) -> Data {
+    return vector.kind == VectorKind::INTS ? Data::from_number(vector.ints()[index])
+                                           : Data::from_real(vector.reals()[index]);
+}
+
+/**
+ * @brief Struct representing a run of elements of a split call, done by one
+ *        task from "start" on, along with what it printed and, for preduce,
+ *        what its elements reduced to.
+ */
+struct Piece final {
+    std::size_t start = 0;
+    Transcript transcript;
+    Error error; // what stopped it, if "failed"
+    bool failed = false;
+    Data value;
+    bool seeded = false; // "value" holds something to reduce into
+};
+
+/**
+ * @brief Struct representing a call of pmap, pfor-each or preduce whose
+ *        elements are being split over the task pool. Splitting is lazy:
+ *        a task runs its elements a few at a time and only hands the upper
+ *        half of what it has left to the pool when nothing else is queued,
+ *        so inputs split as finely as idle threads ask for and no further.
+ */
+struct Split final {
+    Interpreter &interpreter; // the one the call was made in
+    std::function<void(Piece&, std::size_t)> body; // runs one element for a piece
+    std::uint16_t level; // the task level of the pieces
+    TaskGroup group;
+    std::mutex lock;
+    std::deque<Piece> pieces;      // guarded by "lock"
+    std::atomic<std::size_t> stop; // the first element that failed, or "count"
+    std::vector<FrameKey> path;    // the frames of the call, for the profiler
+};
+
+static auto run_piece(Split &split, Piece &piece, std::size_t end) -> void;
+
+/**
+ * @brief Return the interpreter running on the calling thread, which
+ *        builtins that take a function run it with, or raise an error
+ *        and return null if there is none.
+ *
+ * @return Interpreter*
+ */
+static auto calling_interpreter() -> Interpreter* {
+    const auto interpreter = Interpreter::current();
+    if (interpreter == nullptr) {
+        fail(ErrorCode::RUNTIME, "Tried to call a function from a builtin without an interpreter!");
+    }
+    return interpreter;
+}
+
+/**
+ * @brief Add a piece running the elements of "split" from "start" up
+ *        to "end" and queue it on the task pool.
+ *
+ * @param split
+ * @param start
+ * @param end
+ */
+static auto spawn_piece(Split &split, std::size_t start, std::size_t end) -> void {
+    Piece *piece;
+    {
+        const std::lock_guard guard(split.lock);
+        piece = &split.pieces.emplace_back();
+        piece->start = start;
+    }
+    task_pool().spawn(split.group, [&split, piece, end] {
+        const Interpreter::Scope scope(split.interpreter);
+        const ProfileTask task(split.path);
+        run_piece(split, *piece, end);
+    });
+}
+
+/**
+ * @brief Run the elements of "piece" up to "end" on the calling thread with
+ *        an arena, a transcript and a task level of its own, handing the
+ *        upper half of what is left to the pool whenever it is hungry.
+ *        Elements after one that failed anywhere are skipped.
+ *
+ * @param split
+ * @param piece
+ * @param end
+ */
+static auto run_piece(Split &split, Piece &piece, std::size_t end) -> void {
+    auto &pool = task_pool();
+    const TaskArena arena;
+    const TaskLevel level(split.level);
+    const Recording recording(&piece.transcript);
+    auto index = piece.start;
+
+    while (index < end) {
+        if (end - index >= 2 * PIECE_SIZE && pool.size() > 1 && pool.hungry()) {
+            const auto middle = index + (end - index) / 2;
+            spawn_piece(split, middle, end);
+            end = middle;
+        }
+
+        const auto last = std::min(end, index + PIECE_SIZE);
+        for (; index < last; ++index) {
+            if (index > split.stop.load(std::memory_order_relaxed)) {
+                return;
+            }
+            split.body(piece, index);
+            form_arena().reset();
+
+            // the element raised its error on this thread
+            if (raised_error != nullptr) [[unlikely]] {
+                piece.error = take_raised_error();
+                piece.failed = true;
+
+                auto stop = split.stop.load(std::memory_order_relaxed);
+                while (index < stop && !split.stop.compare_exchange_weak(stop, index)) {
+                }
+                return;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Run "body" on every one of "count" elements, split over the task
+ *        pool, and return what the value of each piece ended up as, in
+ *        element order. What they printed is written out in that order too,
+ *        up to the first element that failed, whose error is then raised
+ *        here instead of any values being returned. The first piece runs on
+ *        the calling thread and starts out seeded with "seed" unless it is null.
+ *
+ * @param interpreter
+ * @param body
+ * @param count
+ * @param seed
+ * @return std::vector<Data>
+ */
+static auto run_split(Interpreter &interpreter, std::function<void(Piece&, std::size_t)> body,
+                      std::size_t count, const Data *seed) -> std::vector<Data> {
+    Split split {interpreter, std::move(body), static_cast<std::uint16_t>(task_level + 1), {}, {}, {}, count, profile_path()};
+    Piece first;
+
+    if (seed != nullptr) {
+        first.value = *seed;
+        first.seeded = true;
+    }
+    run_piece(split, first, count);
+    task_pool().wait(split.group);
+
+    std::vector<const Piece*> pieces {&first};
+    for (const auto &piece : split.pieces) {
+        pieces.push_back(&piece);
+    }
+    std::sort(pieces.begin(), pieces.end(), [](const Piece *lhs, const Piece *rhs) {
+        return lhs->start < rhs->start;
+    });
+
+    std::vector<Data> values;
+    for (const auto piece : pieces) {
+        piece->transcript.replay();
+        if (piece->failed) {
+            raise_error(piece->error);
+            return {};
+        }
+        values.push_back(piece->value);
+    }
+    return values;
+}
+
+auto builtin_pmap(Args args) -> Data {
+    if (args.size() != 2) {
+        return fail(ErrorCode::ARITY, "Invalid amount of arguments passed to (pmap f x)");
+    }
+
+    const auto interpreter = calling_interpreter();
+    if (interpreter == nullptr) {
+        return Data();
+    }
+
+    // the arguments may live on the stack of a VM the callbacks run on
+    const Data function = args[0];
+    const Data input = args[1];
+    if (input.type != DataType::VECTOR) {
+        return input.reject("vector");
+    }
+    const auto &vector = input.as_vector();
+
+    std::vector<Data> results(vector.size);
+    run_split(*interpreter, [&](Piece&, std::size_t index) {
+        const auto element = element_at(vector, index);
+        auto result = interpreter->apply(function, Args(&element, 1));
+
+        if (expect_element(result)) {
+            results[index] = std::move(result);
+        }
+    }, vector.size, nullptr);
+
+    if (raised_error != nullptr) {
+        return Data();
+    }
+    return builtin_vec(Args(results.data(), results.size()));
+}
+
+auto builtin_pfor_each(Args args) -> Data {
+    if (args.size() != 2) {
+        return fail(ErrorCode::ARITY, "Invalid amount of arguments passed to (pfor-each f x)");
+    }
+
+    const auto interpreter = calling_interpreter();
+    if (interpreter == nullptr) {
+        return Data();
+    }
+
+    const Data function = args[0];
+    const Data input = args[1];
+    if (input.type != DataType::VECTOR) {
+        return input.reject("vector");
+    }
+    const auto &vector = input.as_vector();
+
+    run_split(*interpreter, [&](Piece&, std::size_t index) {
+        const auto element = element_at(vector, index);
+        interpreter->apply(function, Args(&element, 1));
+    }, vector.size, nullptr);
+
+    return Data();
+}
+
+auto builtin_preduce(Args args) -> Data {
+    if (args.size() != 3) {
+        return fail(ErrorCode::ARITY, "Invalid amount of arguments passed to (preduce f init x)");
+    }
+
+    const auto interpreter = calling_interpreter();
+    if (interpreter == nullptr) {
+        return Data();
+    }
+
+    const Data function = args[0];
+    const Data input = args[2];
+    if (input.type != DataType::VECTOR) {
+        return input.reject("vector");
+    }
+    const auto &vector = input.as_vector();
+
+    // every piece reduces its own elements, starting from the first of them
+    // or from "init" for the first piece, then the pieces are reduced in
+    // order, so the result only matches a left fold if "f" is associative
+    const auto init = args[1].persist();
+    const auto values = run_split(*interpreter, [&](Piece &piece, std::size_t index) {
+        const Data pair[2] {piece.value, element_at(vector, index)};
+
+        if (!piece.seeded) {
+            piece.value = pair[1];
+            piece.seeded = true;
+            return;
+        }
+        piece.value = interpreter->apply(function, Args(pair, 2)).persist();
+    }, vector.size, &init);
+
+    if (raised_error != nullptr) {
+        return Data();
+    }
+    auto result = values.front();
+    for (const auto &value : std::span(values).subspan(1)) {
+        const Data pair[2] {result, value};
+        result = interpreter->apply(function, Args(pair, 2)).persist();
     }
-    return Node(NodeType::NUM_CONSTANT, total);
+    return result;
 }
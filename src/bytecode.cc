@@ -0,0 +1,123 @@
+#include "../include/bytecode.h"
+#include "../include/error.h"
+
+#include <algorithm>
+#include <limits>
+
+/**
+ * @brief Construct a new empty Chunk object.
+ */
+Chunk::Chunk()
+    : caches(nullptr) {
+}
+
+/**
+ * @brief Empty the chunk while keeping its storage for the next form.
+ */
+auto Chunk::clear() -> void {
+    this->code.clear();
+    this->constants.clear();
+    this->functions.clear();
+    this->lambdas.clear();
+    this->caches = nullptr;
+    this->marks.clear();
+}
+
+/**
+ * @brief Append an opcode to the instruction stream.
+ *
+ * @param op
+ */
+auto Chunk::emit(OpCode op) -> void {
+    this->code.push_back(static_cast<std::uint8_t>(op));
+}
+
+/**
+ * @brief Append a 16-bit operand to the instruction stream.
+ *        Errors if the operand does not fit.
+ *
+ * @param operand
+ */
+auto Chunk::emit_u16(std::size_t operand) -> void {
+    if (operand > std::numeric_limits<std::uint16_t>::max()) {
+        quit(ErrorCode::LIMIT, "Form is too large to compile!");
+    }
+    this->code.push_back(static_cast<std::uint8_t>(operand & 0xff));
+    this->code.push_back(static_cast<std::uint8_t>(operand >> 8));
+}
+
+/**
+ * @brief Append a 32-bit operand to the instruction stream.
+ *
+ * @param operand
+ */
+auto Chunk::emit_u32(std::uint32_t operand) -> void {
+    for (int shift = 0; shift < 32; shift += 8) {
+        this->code.push_back(static_cast<std::uint8_t>(operand >> shift));
+    }
+}
+
+/**
+ * @brief Append a jump whose target is not known yet and
+ *        return where its operand is, for patch_jump.
+ *
+ * @param op
+ * @return std::size_t
+ */
+auto Chunk::emit_jump(OpCode op) -> std::size_t {
+    this->emit(op);
+    this->emit_u32(0);
+    return this->code.size() - 4;
+}
+
+/**
+ * @brief Point the jump operand at "at" to the end of the instruction stream.
+ *
+ * @param at
+ */
+auto Chunk::patch_jump(std::size_t at) -> void {
+    const auto target = static_cast<std::uint32_t>(this->code.size());
+    for (int i = 0; i < 4; ++i) {
+        this->code[at + i] = static_cast<std::uint8_t>(target >> (8 * i));
+    }
+}
+
+/**
+ * @brief Add a value to the constant pool and return its index.
+ *
+ * @param value
+ * @return std::size_t
+ */
+auto Chunk::add_constant(const Data &value) -> std::size_t {
+    this->constants.push_back(value);
+    return this->constants.size() - 1;
+}
+
+/**
+ * @brief Record that the next instruction appended was
+ *        compiled from the node at "offset" in the source.
+ *
+ * @param offset
+ */
+auto Chunk::mark(std::uint32_t offset) -> void {
+    this->marks.push_back(SourceMark {static_cast<std::uint32_t>(this->code.size()), offset});
+}
+
+/**
+ * @brief Return the offset in the source of the last marked instruction
+ *        starting before "at" in the instruction stream, if there is one.
+ *        Handlers have read their operands by the time they fail, so "at"
+ *        is anywhere past the opcode of the instruction that did.
+ *
+ * @param at
+ * @return std::optional<std::uint32_t>
+ */
+auto Chunk::source_of(std::size_t at) const -> std::optional<std::uint32_t> {
+    const auto after = std::partition_point(this->marks.begin(), this->marks.end(), [at](const SourceMark &mark) {
+        return mark.code < at;
+    });
+    if (after == this->marks.begin()) {
+        return std::nullopt;
+    }
+    return std::prev(after)->offset;
+}
@@ -0,0 +1,103 @@
+#include "../include/cache.h"
+#include "../include/builtin.h"
+
+/**
+ * @brief Return the fast path of "fn", if it has one.
+ *
+ * @param fn
+ * @return BinaryOp
+ */
+static auto binary_op_of(BuiltinFn fn) -> BinaryOp {
+    static const struct {
+        BuiltinFn fn;
+        BinaryOp op;
+    } ops[] {
+        {builtin_add, BinaryOp::ADD},
+        {builtin_sub, BinaryOp::SUB},
+        {builtin_mul, BinaryOp::MUL},
+        {builtin_lt, BinaryOp::LT},
+        {builtin_gt, BinaryOp::GT},
+        {builtin_eq, BinaryOp::EQ},
+    };
+
+    for (const auto &entry : ops) {
+        if (entry.fn == fn) {
+            return entry.op;
+        }
+    }
+    return BinaryOp::NONE;
+}
+
+/**
+ * @brief Give a cache to every call site under "root" that can make use
+ *        of one, outside of lambdas since they have their own Ast, and
+ *        point Node::slot of each site at it or at NO_CACHE.
+ *
+ * @param ast
+ * @param root
+ */
+auto attach_caches(Ast &ast, NodeId root) -> void {
+    auto &node = ast.nodes[root];
+
+    if (node.type != NodeType::LIST_CONSTANT
+        || node.form == Form::LAMBDA || node.form == Form::DEFUN) {
+        return;
+    }
+
+    if (node.form == Form::CALL) {
+        CallCache cache {CacheState::EMPTY, BinaryOp::NONE, 0, nullptr};
+        bool cached = node.callee == nullptr && node.size != 0;
+
+        if (node.callee != nullptr && node.size == 3) {
+            cache.op = binary_op_of(node.callee);
+            cached = cache.op != BinaryOp::NONE;
+        }
+
+        node.slot = NO_CACHE;
+        if (cached && ast.caches.size() < NO_CACHE) {
+            node.slot = static_cast<std::uint16_t>(ast.caches.size());
+            ast.caches.push_back(cache);
+        }
+    }
+
+    for (const auto child : ast.children_of(root)) {
+        attach_caches(ast, child);
+    }
+}
+
+/**
+ * @brief Return the built-in named by "head" at the dynamic call site cached
+ *        by "cache", or null if it names none, raising an error first if it
+ *        is not a name at all. Symbols are looked up by name once per site
+ *        and only again when the site sees another symbol. Once threads
+ *        share values the cache is left alone, since the symbol and the
+ *        built-in it names could not be updated together.
+ *
+ * @param cache
+ * @param head
+ * @return BuiltinFn
+ */
+auto lookup_cached(CallCache &cache, const Data &head) -> BuiltinFn {
+    if (head.type != DataType::SYMBOL && !head.is_string()) {
+        head.reject("string");
+        return nullptr;
+    }
+    if (threads_share_values.load(std::memory_order_relaxed)) {
+        return head.type == DataType::SYMBOL ? find_builtin(head.symbol)
+                                             : find_builtin(head.as_name());
+    }
+    if (head.type != DataType::SYMBOL) {
+        cache.state = CacheState::MEGAMORPHIC;
+        return find_builtin(head.as_name());
+    }
+    if (cache.state == CacheState::MONOMORPHIC && cache.symbol == head.symbol) {
+        return cache.builtin;
+    }
+
+    const auto fn = find_builtin(head.symbol);
+    cache.state = cache.state == CacheState::EMPTY ? CacheState::MONOMORPHIC
+                                                   : CacheState::MEGAMORPHIC;
+    cache.symbol = head.symbol;
+    cache.builtin = fn;
+    return fn;
+}
@@ -0,0 +1,307 @@
+#include "../include/compiler.h"
+#include "../include/data.h"
+#include "../include/error.h"
+#include "../include/function.h"
+#include "../include/refcount.h"
+
+#include <mutex>
+#include <string>
+
+static auto compile_node(Chunk &chunk, const Ast &ast, NodeId id, bool tail = false) -> void;
+static auto compile_body(Chunk &chunk, const Ast &ast, std::span<const NodeId> exprs, bool tail) -> void;
+
+/**
+ * @brief Lower the abstract syntax tree of a top-level form
+ *        into bytecode that can be executed by the VM. The
+ *        previous contents of "chunk" are replaced. Calls and
+ *        assignments are marked with where they are in the source.
+ *
+ * @param ast
+ * @param root
+ * @param chunk
+ */
+auto compile(const Ast &ast, NodeId root, Chunk &chunk) -> void {
+    chunk.clear();
+    chunk.caches = ast.caches.data();
+    compile_node(chunk, ast, root);
+    chunk.emit(OpCode::RETURN);
+}
+
+/**
+ * @brief Lower the body of "function" into its own chunk. Calls in
+ *        tail position reuse the frame of the function instead of
+ *        pushing a new one, so tail recursion runs in constant space.
+ *
+ * @param function
+ */
+auto compile_function(Function &function) -> void {
+    auto &chunk = function.chunk;
+
+    chunk.clear();
+    chunk.caches = function.ast.caches.data();
+    compile_body(chunk, function.ast, function.ast.children_of(function.body), true);
+    chunk.emit(OpCode::RETURN);
+}
+
+/**
+ * @brief Return the chunk of "function", compiling its body the first
+ *        time. Threads sharing the function compile it once between them,
+ *        and a body that fails to compile is tried again on the next call.
+ *
+ * @param function
+ * @return const Chunk&
+ */
+auto function_chunk(Function &function) -> const Chunk& {
+    if (!function.compiled.load(std::memory_order_acquire)) {
+        static std::mutex lock;
+        std::unique_lock guard(lock, std::defer_lock);
+
+        if (threads_share_values.load(std::memory_order_relaxed)) {
+            guard.lock();
+        }
+        if (!function.compiled.load(std::memory_order_relaxed)) {
+            try {
+                compile_function(function);
+            }
+            catch (const Error&) {
+                function.chunk.clear();
+                throw;
+            }
+            function.compiled.store(true, std::memory_order_release);
+        }
+    }
+    return function.chunk;
+}
+
+/**
+ * @brief Emit a sequence of expressions that leaves only the value of the
+ *        last one on the stack. Only the last one can be in tail position.
+ *
+ * @param chunk
+ * @param ast
+ * @param exprs
+ * @param tail
+ */
+static auto compile_body(Chunk &chunk, const Ast &ast, std::span<const NodeId> exprs, bool tail) -> void {
+    for (std::size_t i = 0; i < exprs.size(); ++i) {
+        if (i != 0) {
+            chunk.emit(OpCode::POP);
+        }
+        compile_node(chunk, ast, exprs[i], tail && i + 1 == exprs.size());
+    }
+}
+
+/**
+ * @brief Emit the instructions that leave the value of the symbol "id" on the stack.
+ *
+ * @param chunk
+ * @param ast
+ * @param id
+ */
+static auto compile_symbol(Chunk &chunk, const Ast &ast, NodeId id) -> void {
+    const auto &node = ast.nodes[id];
+
+    if (node.binding == Binding::LOCAL) {
+        chunk.emit(OpCode::LOAD_LOCAL);
+        chunk.emit_u16(node.depth);
+        chunk.emit_u16(node.slot);
+        return;
+    }
+    chunk.emit(OpCode::LOAD_GLOBAL);
+    chunk.emit_u32(node.symbol);
+}
+
+/**
+ * @brief Emit the instructions of a define or set form, which leave
+ *        the value assigned on the stack.
+ *
+ * @param chunk
+ * @param ast
+ * @param id
+ */
+static auto compile_assignment(Chunk &chunk, const Ast &ast, NodeId id) -> void {
+    const auto body = ast.children_of(id);
+    const auto &name = ast.nodes[body[1]];
+
+    compile_node(chunk, ast, body[2]);
+    chunk.mark(ast.offsets[id]);
+
+    if (ast.nodes[id].form == Form::DEFINE) {
+        chunk.emit(OpCode::DEFINE_GLOBAL);
+        chunk.emit_u32(name.symbol);
+    }
+    else if (name.binding == Binding::LOCAL) {
+        chunk.emit(OpCode::SET_LOCAL);
+        chunk.emit_u16(name.depth);
+        chunk.emit_u16(name.slot);
+    }
+    else {
+        chunk.emit(OpCode::SET_GLOBAL);
+        chunk.emit_u32(name.symbol);
+    }
+}
+
+/**
+ * @brief Emit the instructions of a let form: its values are pushed in the
+ *        enclosing scope, moved into a new frame and the body runs inside it,
+ *        keeping only the value of its last expression.
+ *
+ * @param chunk
+ * @param ast
+ * @param id
+ * @param tail
+ */
+static auto compile_let(Chunk &chunk, const Ast &ast, NodeId id, bool tail) -> void {
+    const auto body = ast.children_of(id);
+    const auto bindings = ast.children_of(body[1]);
+
+    for (const auto binding : bindings) {
+        compile_node(chunk, ast, ast.children_of(binding)[1]);
+    }
+    chunk.emit(OpCode::ENTER_SCOPE);
+    chunk.emit_u16(bindings.size());
+
+    // a tail call leaves the frame behind on its own, so the scope is
+    // only left here when the last expression returns normally
+    compile_body(chunk, ast, body.subspan(2), tail);
+    chunk.emit(OpCode::LEAVE_SCOPE);
+}
+
+/**
+ * @brief Emit the instructions of an if form. A missing else gives 0.
+ *
+ * @param chunk
+ * @param ast
+ * @param id
+ * @param tail
+ */
+static auto compile_if(Chunk &chunk, const Ast &ast, NodeId id, bool tail) -> void {
+    const auto body = ast.children_of(id);
+
+    compile_node(chunk, ast, body[1]);
+    const auto otherwise = chunk.emit_jump(OpCode::JUMP_IF_FALSE);
+
+    compile_node(chunk, ast, body[2], tail);
+    const auto end = chunk.emit_jump(OpCode::JUMP);
+
+    chunk.patch_jump(otherwise);
+    if (body.size() == 4) {
+        compile_node(chunk, ast, body[3], tail);
+    }
+    else {
+        chunk.emit(OpCode::PUSH_CONST);
+        chunk.emit_u16(chunk.add_constant(Data()));
+    }
+    chunk.patch_jump(end);
+}
+
+/**
+ * @brief Emit the instructions that make a closure out of the lifted lambda
+ *        or defun "id", binding it to its name in the case of a defun.
+ *
+ * @param chunk
+ * @param ast
+ * @param id
+ */
+static auto compile_function_value(Chunk &chunk, const Ast &ast, NodeId id) -> void {
+    const auto &node = ast.nodes[id];
+
+    chunk.lambdas.push_back(ast.functions[node.slot]);
+    chunk.emit(OpCode::MAKE_CLOSURE);
+    chunk.emit_u16(chunk.lambdas.size() - 1);
+
+    if (node.form == Form::DEFUN) {
+        chunk.emit(OpCode::DEFINE_GLOBAL);
+        chunk.emit_u32(ast.nodes[ast.children_of(id)[1]].symbol);
+    }
+}
+
+/**
+ * @brief Emit the instructions that leave the value of "node" on the stack.
+ *        Calls the parser bound to a built-in are emitted as direct calls;
+ *        anything else is resolved at runtime exactly like the tree-walking
+ *        evaluator does. "tail" is set when the value is returned from a
+ *        function right away.
+ *
+ * @param chunk
+ * @param ast
+ * @param id
+ * @param tail
+ */
+static auto compile_node(Chunk &chunk, const Ast &ast, NodeId id, bool tail) -> void {
+    switch (ast.nodes[id].type) {
+        case NodeType::SYM_CONSTANT:
+            compile_symbol(chunk, ast, id);
+            return;
+
+        case NodeType::LIST_CONSTANT:
+            break;
+
+        default:
+            chunk.emit(OpCode::PUSH_CONST);
+            chunk.emit_u16(chunk.add_constant(convert_to_data(ast, id)));
+            return;
+    }
+
+    switch (ast.nodes[id].form) {
+        case Form::DEFINE:
+        case Form::SET:
+            compile_assignment(chunk, ast, id);
+            return;
+
+        case Form::LET:
+            compile_let(chunk, ast, id, tail);
+            return;
+
+        case Form::IF:
+            compile_if(chunk, ast, id, tail);
+            return;
+
+        case Form::LAMBDA:
+        case Form::DEFUN:
+            compile_function_value(chunk, ast, id);
+            return;
+
+        default:
+            break;
+    }
+
+    const auto body = ast.children_of(id);
+    if (body.empty()) {
+        quit_at(ast.offsets[id], ErrorCode::SYNTAX, "Tried to call an empty list!");
+    }
+
+    const auto argc = body.size() - 1;
+    const auto cache = ast.nodes[id].slot;
+
+    if (const auto callee = ast.nodes[id].callee) {
+        for (const auto param : body.subspan(1)) {
+            compile_node(chunk, ast, param);
+        }
+        chunk.functions.push_back(callee);
+        chunk.mark(ast.offsets[id]);
+
+        // sites with a fast path for numbers carry their cache
+        if (cache != NO_CACHE) {
+            chunk.emit(OpCode::CALL_BINARY);
+            chunk.emit_u16(chunk.functions.size() - 1);
+            chunk.emit_u16(cache);
+            return;
+        }
+        chunk.emit(OpCode::CALL_BUILTIN);
+        chunk.emit_u16(chunk.functions.size() - 1);
+        chunk.emit_u16(argc);
+        return;
+    }
+
+    if (cache == NO_CACHE) {
+        quit_at(ast.offsets[id], ErrorCode::LIMIT, "Form is too large to compile!");
+    }
+    for (const auto param : body) {
+        compile_node(chunk, ast, param);
+    }
+    chunk.mark(ast.offsets[id]);
+    chunk.emit(tail ? OpCode::TAIL_CALL : OpCode::CALL_DYNAMIC);
+    chunk.emit_u16(argc);
+    chunk.emit_u16(cache);
+}
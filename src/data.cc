@@ -1,33 +1,290 @@
 #include "../include/data.h"
 #include "../include/node.h"
+#include "../include/ast.h"
+#include "../include/error.h"
+#include "../include/function.h"
+#include "../include/number.h"
 
 /**
- * @brief Construct a new Data object.
+ * @brief Return a number value.
+ *
+ * @param number
+ * @return Data
+ */
+auto Data::from_number(std::int64_t number) -> Data {
+    Data data;
+    data.number = number;
+    return data;
+}
+
+/**
+ * @brief Return a real value.
+ *
+ * @param real
+ * @return Data
+ */
+auto Data::from_real(double real) -> Data {
+    Data data;
+    data.type = DataType::REAL;
+    data.real = real;
+    return data;
+}
+
+/**
+ * @brief Return an integer value taking over the reference held on
+ *        "bignum", or a plain number if it fits in one, in which case
+ *        the reference is dropped.
+ *
+ * @param bignum
+ * @return Data
+ */
+auto Data::from_bignum(BigInt *bignum) -> Data {
+    if (const auto number = bignum->to_int()) {
+        bignum->release();
+        return Data::from_number(*number);
+    }
+
+    Data data;
+    data.type = DataType::BIGNUM;
+    data.bignum = bignum;
+    return data;
+}
+
+/**
+ * @brief Return a string value taking over the reference held on "string".
+ *
+ * @param string
+ * @return Data
+ */
+auto Data::from_string(String *string) -> Data {
+    Data data;
+    data.type = DataType::STRING;
+    data.string = string;
+    return data;
+}
+
+/**
+ * @brief Return a string value holding a new copy of "text".
+ *
+ * @param text
+ * @return Data
+ */
+auto Data::from_text(std::string_view text) -> Data {
+    return Data::from_string(String::make(text));
+}
+
+/**
+ * @brief Return a symbol value.
+ *
+ * @param symbol
+ * @return Data
+ */
+auto Data::from_symbol(SymbolId symbol) -> Data {
+    Data data;
+    data.type = DataType::SYMBOL;
+    data.symbol = symbol;
+    return data;
+}
+
+/**
+ * @brief Return a function value taking over the reference held on "closure".
+ *
+ * @param closure
+ * @return Data
+ */
+auto Data::from_closure(Closure *closure) -> Data {
+    Data data;
+    data.type = DataType::CLOSURE;
+    data.closure = closure;
+    return data;
+}
+
+/**
+ * @brief Return a string value taking over the reference held on "rope".
+ *
+ * @param rope
+ * @return Data
+ */
+auto Data::from_rope(Rope *rope) -> Data {
+    Data data;
+    data.type = DataType::ROPE;
+    data.rope = rope;
+    return data;
+}
+
+/**
+ * @brief Return a vector value taking over the reference held on "vector".
+ *
+ * @param vector
+ * @return Data
+ */
+auto Data::from_vector(Vector *vector) -> Data {
+    Data data;
+    data.type = DataType::VECTOR;
+    data.vector = vector;
+    return data;
+}
+
+/**
+ * @brief Return the name of the string or symbol held,
+ *        erroring if this is neither.
+ *
+ * @return std::string_view
+ */
+auto Data::as_name() const -> std::string_view {
+    if (this->type == DataType::SYMBOL) {
+        return symbol_name(this->symbol);
+    }
+    return this->as_string();
+}
+
+/**
+ * @brief Return a copy of the value that is safe to keep once the
+ *        current form is over: pinned strings living in the form
+ *        arena are copied to the heap, everything else is shared,
+ *        ropes included since their parts are never pinned.
+ *
+ * @return Data
+ */
+auto Data::persist() const -> Data {
+    if (this->type == DataType::STRING && this->string->pinned()) {
+        return Data::from_text(this->string->view());
+    }
+    return *this;
+}
+
+/**
+ * @brief Return the error saying a value of type "expected" was
+ *        needed instead of "data".
+ *
+ * @param data
+ * @param expected
+ * @return Error
+ */
+static auto type_error(const Data &data, const char *expected) -> Error {
+    static const char *const repr[] {
+        "number",
+        "symbol",
+        "number",
+        "string",
+        "function",
+        "number",
+        "vector",
+        "string",
+    };
+    return Error(ErrorCode::TYPE, "Expected a ", expected, " but got a ", repr[static_cast<int>(data.type)]);
+}
+
+/**
+ * @brief Error because a value of type "expected" was needed instead.
+ *
+ * @param expected
+ */
+auto Data::mismatch(const char *expected) const -> void {
+    throw type_error(*this, expected);
+}
+
+/**
+ * @brief Raise the error mismatch throws instead of throwing it,
+ *        and return what a builtin that failed returns.
+ *
+ * @param expected
+ * @return Data
  */
-Data::Data()
-    : type(DataType::NUMBER), value(0) {
+auto Data::reject(const char *expected) const -> Data {
+    raise_error(type_error(*this, expected));
+    return Data();
 }
 
-Data::Data(DataType type, const auto &value)
-    : type(type), value(value) {
+/**
+ * @brief Write "data" the way print shows it.
+ *
+ * @param os
+ * @param data
+ * @return std::ostream&
+ */
+auto operator<<(std::ostream &os, const Data &data) -> std::ostream& {
+    switch (data.type) {
+        case DataType::NUMBER:
+            return os << data.number;
+
+        case DataType::STRING:
+            return os << data.string->view();
+
+        case DataType::ROPE:
+            data.rope->for_each_piece([&](std::string_view piece) {
+                os << piece;
+            });
+            return os;
+
+        case DataType::SYMBOL:
+            return os << symbol_name(data.symbol);
+
+        case DataType::REAL:
+            return os << format_real(data.real);
+
+        case DataType::BIGNUM:
+            return os << data.bignum->to_string();
+
+        case DataType::VECTOR: {
+            const auto &vector = *data.vector;
+            const char *separator = "";
+
+            os << '[';
+            for (std::size_t i = 0; i < vector.size; ++i) {
+                os << separator;
+                if (vector.kind == VectorKind::INTS) {
+                    os << vector.ints()[i];
+                }
+                else {
+                    os << format_real(vector.reals()[i]);
+                }
+                separator = " ";
+            }
+            return os << ']';
+        }
+
+        case DataType::CLOSURE: {
+            const auto &name = data.closure->function->name;
+            if (name.has_value()) {
+                return os << "<function " << symbol_name(*name) << '>';
+            }
+            return os << "<lambda>";
+        }
+    }
+    return os;
 }
 
 /**
- * @brief Take a node and return its Data equivalent.
+ * @brief Take a node of "ast" and return its Data equivalent.
+ *        Strings share the copy interned by the Ast.
  *
- * @param node
+ * @param ast
+ * @param id
  * @return Data
  */
-auto convert_to_data(const Node &node)  -> Data {
+auto convert_to_data(const Ast &ast, NodeId id)  -> Data {
+    const auto &node = ast.nodes[id];
+
     switch (node.type) {
         case NodeType::NUM_CONSTANT:
-            return Data(DataType::NUMBER, std::get<int>(node.exp));
+            return Data::from_number(node.number);
 
-        case NodeType::STR_CONSTANT:
-            return Data(DataType::STRING, std::get<std::string>(node.exp));
+        case NodeType::STR_CONSTANT: {
+            const auto string = ast.strings.get(node.string);
+            string->retain();
+            return Data::from_string(string);
+        }
 
         case NodeType::SYM_CONSTANT:
-            return Data(DataType::SYMBOL, std::get<std::string>(node.exp));
+            return Data::from_symbol(node.symbol);
+
+        case NodeType::REAL_CONSTANT:
+            return Data::from_real(node.real);
+
+        case NodeType::BIG_CONSTANT:
+            node.bignum->retain();
+            return Data::from_bignum(node.bignum);
 
         default:
             return Data(); // NUM_CONSTANT, 0
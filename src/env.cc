@@ -0,0 +1,148 @@
+#include "../include/env.h"
+#include "../include/error.h"
+
+#include <new>
+#include <string>
+
+/**
+ * @brief Construct a new TaskLevel object setting the
+ *        task level of the calling thread to "level".
+ *
+ * @param level
+ */
+TaskLevel::TaskLevel(std::uint16_t level)
+    : previous(task_level) {
+    task_level = level;
+}
+
+/**
+ * @brief Destroy the TaskLevel object, putting back the level before it.
+ */
+TaskLevel::~TaskLevel() {
+    task_level = this->previous;
+}
+
+/**
+ * @brief Allocate a frame of "size" slots holding numbers with one
+ *        reference, taking a reference to "parent" if it is not null.
+ *
+ * @param size
+ * @param parent
+ * @return Env*
+ */
+auto Env::make(std::size_t size, Env *parent) -> Env* {
+    auto memory = ::operator new(sizeof(Env) + size * sizeof(Data));
+    auto env = new (memory) Env;
+
+    env->refs = 1;
+    env->size = static_cast<std::uint16_t>(size);
+    env->level = task_level;
+    env->parent = parent;
+    if (parent != nullptr) {
+        parent->retain();
+    }
+
+    for (std::size_t i = 0; i < size; ++i) {
+        new (env->slots() + i) Data;
+    }
+    return env;
+}
+
+/**
+ * @brief Free "env" once nothing refers to it anymore.
+ *
+ * @param env
+ */
+auto Env::destroy(Env *env) -> void {
+    // release the chain of parents iteratively, a long chain
+    // of frames must not recurse once per frame
+    while (env != nullptr) {
+        const auto parent = env->parent;
+
+        for (std::size_t i = 0; i < env->size; ++i) {
+            env->slots()[i].~Data();
+        }
+        env->~Env();
+        ::operator delete(env);
+
+        if (parent == nullptr || !count_down(parent->refs)) {
+            return;
+        }
+        env = parent;
+    }
+}
+
+/**
+ * @brief Raise an error about assigning to a variable
+ *        that other tasks may share.
+ */
+auto Env::refuse_assign() -> void {
+    fail(ErrorCode::RUNTIME, "Tried to set a variable from outside of the function run by pmap, pfor-each or preduce!");
+}
+
+/**
+ * @brief Return whether globals can be changed at the task level of
+ *        the calling thread, raising an error if they can't.
+ *
+ * @param symbol
+ * @return bool
+ */
+static auto expect_level_zero(SymbolId symbol) -> bool {
+    if (task_level != 0) [[unlikely]] {
+        fail(ErrorCode::NAME, "Tried to change the global ", std::string(symbol_name(symbol)),
+             " inside of pmap, pfor-each or preduce!");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Bind "symbol" to "value", replacing any previous value.
+ *        Only allowed at task level 0, raising an error elsewhere.
+ *
+ * @param symbol
+ * @param value
+ */
+auto Globals::define(SymbolId symbol, Data value) -> void {
+    if (!expect_level_zero(symbol)) {
+        return;
+    }
+    if (symbol >= this->bound.size()) {
+        this->values.resize(symbol + 1);
+        this->bound.resize(symbol + 1, 0);
+    }
+    this->values[symbol] = std::move(value);
+    this->bound[symbol] = 1;
+}
+
+/**
+ * @brief Replace the value of "symbol", raising an error if it was never
+ *        defined. Only allowed at task level 0, raising an error elsewhere.
+ *
+ * @param symbol
+ * @param value
+ */
+auto Globals::assign(SymbolId symbol, Data value) -> void {
+    if (!expect_level_zero(symbol)) {
+        return;
+    }
+    if (symbol >= this->bound.size() || !this->bound[symbol]) {
+        fail(ErrorCode::NAME, "Tried to set ", std::string(symbol_name(symbol)), " before defining it!");
+        return;
+    }
+    this->values[symbol] = std::move(value);
+}
+
+/**
+ * @brief Make room for the symbols with ids below "count" up front, so
+ *        defining them never moves the table. Threads running forms
+ *        that touch different globals can then share it without a lock.
+ *
+ * @param count
+ */
+auto Globals::reserve(std::size_t count) -> void {
+    if (count > this->bound.size()) {
+        this->values.resize(count);
+        this->bound.resize(count, 0);
+    }
+}
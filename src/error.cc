@@ -8,3 +8,69 @@
 auto Error::what() const noexcept(true) -> const char* {
     return desc.c_str();
 }
+
+/**
+ * @brief Return what kind of failure the error reports.
+ *
+ * @return ErrorCode
+ */
+auto Error::code() const -> ErrorCode {
+    return this->error_code;
+}
+
+/**
+ * @brief Return the offset in the source of the code that failed,
+ *        if it is known.
+ *
+ * @return std::optional<std::size_t>
+ */
+auto Error::offset() const -> std::optional<std::size_t> {
+    if (this->source_offset == NO_OFFSET) {
+        return std::nullopt;
+    }
+    return this->source_offset;
+}
+
+/**
+ * @brief Record that the error happened at "offset" in the source,
+ *        unless code closer to where it happened already did.
+ *
+ * @param offset
+ */
+auto Error::locate(std::size_t offset) -> void {
+    if (this->source_offset == NO_OFFSET) {
+        this->source_offset = offset;
+    }
+}
+
+/**
+ * @brief Return the line the error happened on, counting from 1,
+ *        or 0 if it has not been placed.
+ *
+ * @return std::size_t
+ */
+auto Error::line() const -> std::size_t {
+    return this->source_line;
+}
+
+/**
+ * @brief Return the column the error happened at, counting from 1,
+ *        or 0 if it has not been placed.
+ *
+ * @return std::size_t
+ */
+auto Error::column() const -> std::size_t {
+    return this->source_column;
+}
+
+/**
+ * @brief Record the line and column the offset of the error is at,
+ *        worked out by whoever holds the source it refers to.
+ *
+ * @param line
+ * @param column
+ */
+auto Error::place(std::size_t line, std::size_t column) -> void {
+    this->source_line = line;
+    this->source_column = column;
+}
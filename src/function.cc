@@ -0,0 +1,70 @@
+#include "../include/function.h"
+#include "../include/error.h"
+#include "../include/cache.h"
+
+#include <limits>
+
+/**
+ * @brief Allocate a function with one reference holding a copy of
+ *        the lambda or defun "id" of "from", which must be resolved.
+ *        Lambdas nested inside of it are lifted into its own Ast
+ *        and its call sites get caches of their own.
+ *
+ * @param from
+ * @param id
+ * @return Function*
+ */
+auto Function::make(const Ast &from, NodeId id) -> Function* {
+    const auto &node = from.nodes[id];
+    const auto body = from.children_of(id);
+
+    // (lambda (params) body ...) or (defun name (params) body ...)
+    const std::size_t params = node.form == Form::DEFUN ? 2 : 1;
+    const auto exprs = body.subspan(params + 1);
+
+    auto function = new Function;
+    function->refs = 1;
+    function->arity = static_cast<std::uint16_t>(from.nodes[body[params]].size);
+
+    if (node.form == Form::DEFUN) {
+        function->name = from.nodes[body[1]].symbol;
+    }
+
+    for (const auto expr : exprs) {
+        function->ast.push_child(function->ast.copy_tree(from, expr));
+    }
+    function->body = function->ast.add_list(exprs.size());
+    function->ast.nodes[function->body].form = Form::SYNTAX;
+
+    lift_functions(function->ast, function->body);
+    attach_caches(function->ast, function->body);
+    return function;
+}
+
+/**
+ * @brief Make a Function out of every outermost lambda and defun under
+ *        "root", add it to the functions of "ast" and point the node at it.
+ *        Runs after the tree has been resolved and folded.
+ *
+ * @param ast
+ * @param root
+ */
+auto lift_functions(Ast &ast, NodeId root) -> void {
+    if (ast.nodes[root].type != NodeType::LIST_CONSTANT) {
+        return;
+    }
+
+    const auto form = ast.nodes[root].form;
+    if (form != Form::LAMBDA && form != Form::DEFUN) {
+        for (const auto child : ast.children_of(root)) {
+            lift_functions(ast, child);
+        }
+        return;
+    }
+
+    if (ast.functions.size() > std::numeric_limits<std::uint16_t>::max()) {
+        quit(ErrorCode::LIMIT, "Too many functions in one form!");
+    }
+    ast.functions.push_back(Function::make(ast, root));
+    ast.nodes[root].slot = static_cast<std::uint16_t>(ast.functions.size() - 1);
+}
@@ -0,0 +1,991 @@
+#include "../include/image.h"
+#include "../include/bignum.h"
+#include "../include/builtin.h"
+#include "../include/function.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <optional>
+
+/**
+ * @brief Bumped whenever the layout of images, or what the resolver and
+ *        the folder leave in a tree, changes, so older images are redone.
+ */
+static constexpr std::uint32_t IMAGE_VERSION = 3;
+
+/**
+ * @brief Marks a symbol or string that has no index in the image yet.
+ */
+static constexpr std::uint32_t NO_INDEX = std::numeric_limits<std::uint32_t>::max();
+
+/**
+ * @brief Struct representing the start of an image. Images are only ever
+ *        read by the machine that wrote them, so everything is stored the
+ *        way it is in memory, "order" catching a mismatch all the same.
+ *        The checksum catches damage that still looks like a valid tree,
+ *        such as a changed number.
+ */
+struct ImageHeader final {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t order;     // 0x01020304 as written
+    std::uint64_t hash;      // of the source
+    std::uint64_t size;      // of the source, in bytes
+    std::uint32_t symbols;   // how many symbol names follow
+    std::uint32_t forms;     // how many forms follow the symbols
+    std::uint64_t checksum;  // hash_source of everything after the header
+};
+
+/**
+ * @brief Struct representing the start of a tree in an image, a top-level
+ *        form or the body of a function lifted out of one, followed by its
+ *        strings, numbers, children, nodes, the source offsets of the nodes,
+ *        caches and then its functions.
+ */
+struct ImageAst final {
+    std::uint32_t strings;
+    std::uint32_t numbers;
+    std::uint32_t children;
+    std::uint32_t nodes;
+    std::uint32_t caches;
+    std::uint32_t functions;
+};
+
+/**
+ * @brief Struct representing a lifted function in an image, followed by its tree.
+ */
+struct ImageFunction final {
+    std::uint16_t arity;
+    std::uint16_t named;
+    std::uint32_t name; // the symbol of a defun
+    NodeId body;
+};
+
+/**
+ * @brief Struct representing a node in an image. Strings, numbers and
+ *        symbols are numbered within the image, and a call to a built-in
+ *        only records that its head names one, which is looked up again
+ *        when loaded.
+ */
+struct ImageNode final {
+    NodeType type;
+    Form form;
+    Binding binding;
+    std::uint8_t builtin; // a list whose head names the built-in it calls
+    std::uint32_t size;
+    std::uint32_t value;  // the string, the number, the symbol or the first child
+    std::uint16_t depth;
+    std::uint16_t slot;
+};
+
+static_assert(sizeof(ImageNode) == 16, "ImageNode is meant to stay two words");
+
+static constexpr char IMAGE_MAGIC[8] = {'L', 'I', 'S', 'P', 'I', 'M', 'G', '\0'};
+static constexpr std::uint32_t IMAGE_ORDER = 0x01020304;
+
+/**
+ * @brief Struct reading the parts of an image one after another, failing
+ *        instead of reading past its end.
+ */
+struct Cursor final {
+    std::string_view data;
+    std::size_t offset;
+
+    /**
+     * @brief Copy the next sizeof(T) bytes into "value" and return true,
+     *        or return false if there are not that many left.
+     *
+     * @param value
+     * @return bool
+     */
+    template <typename T>
+    auto take(T &value) -> bool {
+        if (this->data.size() - this->offset < sizeof(T)) {
+            return false;
+        }
+        std::memcpy(&value, this->data.data() + this->offset, sizeof(T));
+        this->offset += sizeof(T);
+        return true;
+    }
+
+    /**
+     * @brief Store the next string, stored as its length and then its
+     *        bytes, in "text" and return true, or return false if it
+     *        goes past the end.
+     *
+     * @param text
+     * @return bool
+     */
+    auto take_text(std::string_view &text) -> bool {
+        std::uint32_t length;
+        if (!this->take(length) || this->data.size() - this->offset < length) {
+            return false;
+        }
+        text = this->data.substr(this->offset, length);
+        this->offset += length;
+        return true;
+    }
+
+    /**
+     * @brief Skip the next "count" items of "size" bytes and return true,
+     *        or return false if there are not that many left.
+     *
+     * @param count
+     * @param size
+     * @return bool
+     */
+    auto skip(std::size_t count, std::size_t size) -> bool {
+        if ((this->data.size() - this->offset) / size < count) {
+            return false;
+        }
+        this->offset += count * size;
+        return true;
+    }
+};
+
+/**
+ * @brief Append the bytes of "value" to "out".
+ *
+ * @param out
+ * @param value
+ */
+template <typename T>
+static auto put(std::string &out, const T &value) -> void {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+/**
+ * @brief Append "text" to "out" as its length and then its bytes.
+ *
+ * @param out
+ * @param text
+ */
+static auto put_text(std::string &out, std::string_view text) -> void {
+    put(out, static_cast<std::uint32_t>(text.size()));
+    out.append(text);
+}
+
+/**
+ * @brief Return where the image of a source hashing to "hash" is kept in "dir".
+ *
+ * @param dir
+ * @param hash
+ * @return std::string
+ */
+static auto image_path(const std::string &dir, std::uint64_t hash) -> std::string {
+    char name[32];
+    std::snprintf(name, sizeof(name), "/%016llx.image", static_cast<unsigned long long>(hash));
+    return dir + name;
+}
+
+/**
+ * @brief Return the hash compiled images of "text" are keyed on.
+ *
+ * @param text
+ * @return std::uint64_t
+ */
+auto hash_source(std::string_view text) -> std::uint64_t {
+    constexpr std::uint64_t multiplier = 0x9fb21c651e98df25;
+
+    // eight bytes at a time, so hashing a large script costs next to nothing
+    auto hash = 0x9e3779b97f4a7c15 ^ text.size();
+    const auto mix = [&](std::uint64_t word) {
+        hash = (hash ^ word) * multiplier;
+        hash ^= hash >> 29;
+    };
+
+    std::size_t i = 0;
+    for (; i + 8 <= text.size(); i += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, text.data() + i, 8);
+        mix(word);
+    }
+    if (i < text.size()) {
+        std::uint64_t word = 0;
+        std::memcpy(&word, text.data() + i, text.size() - i);
+        mix(word);
+    }
+    mix(hash >> 32);
+    return hash;
+}
+
+/**
+ * @brief Construct a new ImageWriter object with no forms.
+ */
+ImageWriter::ImageWriter()
+    : count(0) {
+}
+
+
+/**
+ * @brief Add the prepared top-level form "root", the only form
+ *        in "ast", after the ones added so far.
+ *
+ * @param ast
+ * @param root
+ */
+auto ImageWriter::add(const Ast &ast, NodeId root) -> void {
+    put(this->forms, root);
+    this->write_ast(ast);
+    ++this->count;
+}
+
+/**
+ * @brief Save the forms added so far as the image of a source of
+ *        "size" bytes hashing to "hash" in the directory "dir", made
+ *        if need be. Returns false if it could not be written, which
+ *        only means the next run parses the script again.
+ *
+ * @param dir
+ * @param hash
+ * @param size
+ * @return bool
+ */
+auto ImageWriter::save(const std::string &dir, std::uint64_t hash, std::size_t size) const -> bool {
+    std::string image;
+    ImageHeader header {};
+    std::memcpy(header.magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC));
+    header.version = IMAGE_VERSION;
+    header.order = IMAGE_ORDER;
+    header.hash = hash;
+    header.size = size;
+    header.symbols = static_cast<std::uint32_t>(this->symbols.size());
+    header.forms = this->count;
+
+    put(image, header);
+    for (const auto symbol : this->symbols) {
+        put_text(image, symbol_name(symbol));
+    }
+    image.append(this->forms);
+
+    header.checksum = hash_source(std::string_view(image).substr(sizeof(ImageHeader)));
+    std::memcpy(image.data(), &header, sizeof(ImageHeader));
+
+    if (::mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        return false;
+    }
+
+    // written next to where it goes and renamed into place, so a run
+    // never sees half an image however many are writing it at once
+    const auto path = image_path(dir, hash);
+    const auto temporary = path + "." + std::to_string(::getpid());
+    const int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    std::size_t written = 0;
+    while (written < image.size()) {
+        const auto count = ::write(fd, image.data() + written, image.size() - written);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            break;
+        }
+        written += static_cast<std::size_t>(count);
+    }
+
+    const bool saved = ::close(fd) == 0 && written == image.size()
+                    && ::rename(temporary.c_str(), path.c_str()) == 0;
+    if (!saved) {
+        ::unlink(temporary.c_str());
+    }
+    return saved;
+}
+
+/**
+ * @brief Append "ast" to the forms, along with the functions lifted into it.
+ *
+ * @param ast
+ */
+auto ImageWriter::write_ast(const Ast &ast) -> void {
+    std::vector<std::uint32_t> string_index(ast.strings.size(), NO_INDEX);
+    std::vector<std::uint32_t> strings;
+    std::vector<std::int64_t> numbers;
+    std::vector<ImageNode> nodes;
+    nodes.reserve(ast.nodes.size());
+
+    for (const auto &node : ast.nodes) {
+        ImageNode image {};
+        image.type = node.type;
+        image.form = node.form;
+        image.binding = node.binding;
+        image.size = node.size;
+        image.depth = node.depth;
+        image.slot = node.slot;
+
+        switch (node.type) {
+            case NodeType::NUM_CONSTANT:
+            case NodeType::REAL_CONSTANT:
+                // the bits of a real go through as they are
+                image.value = static_cast<std::uint32_t>(numbers.size());
+                numbers.push_back(node.number);
+                break;
+
+            case NodeType::STR_CONSTANT:
+            case NodeType::BIG_CONSTANT: {
+                auto &index = string_index[node.string];
+                if (index == NO_INDEX) {
+                    index = static_cast<std::uint32_t>(strings.size());
+                    strings.push_back(node.string);
+                }
+                image.value = index;
+                break;
+            }
+
+            case NodeType::SYM_CONSTANT:
+                image.value = this->symbol_of(node.symbol);
+                break;
+
+            case NodeType::LIST_CONSTANT:
+                image.value = node.first;
+                image.builtin = node.callee != nullptr;
+
+                // calls inside of lambdas were never given a cache here
+                if (node.form == Form::CALL && node.slot >= ast.caches.size()) {
+                    image.slot = NO_CACHE;
+                }
+                break;
+        }
+        nodes.push_back(image);
+    }
+
+    put(this->forms, ImageAst {
+        static_cast<std::uint32_t>(strings.size()),
+        static_cast<std::uint32_t>(numbers.size()),
+        static_cast<std::uint32_t>(ast.children.size()),
+        static_cast<std::uint32_t>(nodes.size()),
+        static_cast<std::uint32_t>(ast.caches.size()),
+        static_cast<std::uint32_t>(ast.functions.size()),
+    });
+    for (const auto string : strings) {
+        put_text(this->forms, ast.strings.get(string)->view());
+    }
+    this->forms.append(reinterpret_cast<const char*>(numbers.data()), numbers.size() * sizeof(std::int64_t));
+    this->forms.append(reinterpret_cast<const char*>(ast.children.data()), ast.children.size() * sizeof(NodeId));
+    this->forms.append(reinterpret_cast<const char*>(nodes.data()), nodes.size() * sizeof(ImageNode));
+    this->forms.append(reinterpret_cast<const char*>(ast.offsets.data()), ast.offsets.size() * sizeof(std::uint32_t));
+
+    // only the fast path of a cache is known before it runs
+    for (const auto &cache : ast.caches) {
+        put(this->forms, cache.op);
+    }
+
+    for (const auto function : ast.functions) {
+        put(this->forms, ImageFunction {
+            function->arity,
+            function->name.has_value(),
+            function->name.has_value() ? this->symbol_of(*function->name) : 0,
+            function->body,
+        });
+        this->write_ast(function->ast);
+    }
+}
+
+/**
+ * @brief Return the index of "symbol" in the image, giving it one if need be.
+ *
+ * @param symbol
+ * @return std::uint32_t
+ */
+auto ImageWriter::symbol_of(SymbolId symbol) -> std::uint32_t {
+    if (symbol >= this->symbol_index.size()) {
+        this->symbol_index.resize(symbol + 1, NO_INDEX);
+    }
+
+    auto &index = this->symbol_index[symbol];
+    if (index == NO_INDEX) {
+        index = static_cast<std::uint32_t>(this->symbols.size());
+        this->symbols.push_back(symbol);
+    }
+    return index;
+}
+
+/**
+ * @brief Return whether "text" is what the lexer hands out for an integer
+ *        literal: digits, with a '-' in front or not.
+ *
+ * @param text
+ * @return bool
+ */
+static auto is_integer_text(std::string_view text) -> bool {
+    if (!text.empty() && text.front() == '-') {
+        text.remove_prefix(1);
+    }
+    return !text.empty() && std::all_of(text.begin(), text.end(), [](char c) { return c >= '0' && c <= '9'; });
+}
+
+/**
+ * @brief Struct walking a tree of an image from its root the way the
+ *        resolver left it, so that loading it cannot give either engine
+ *        a special form with the wrong number of parts or a local that
+ *        is not in any frame. Every node is reached at most once, which
+ *        also keeps a damaged image from sending the walk in circles.
+ */
+struct TreeCheck final {
+    const char *children;
+    const char *nodes;
+    const std::vector<std::string_view> &strings;
+    std::vector<bool> seen;
+    std::vector<std::size_t> scopes;                 // slots of each enclosing frame, innermost last
+    std::vector<std::vector<std::size_t>> functions; // the frames each lifted function runs in
+
+    /**
+     * @brief Return the index of the child "index" in the children array.
+     *
+     * @param index
+     * @return NodeId
+     */
+    auto child_at(std::size_t index) const -> NodeId {
+        NodeId child;
+        std::memcpy(&child, this->children + index * sizeof(NodeId), sizeof(NodeId));
+        return child;
+    }
+
+    /**
+     * @brief Return the node "index".
+     *
+     * @param index
+     * @return ImageNode
+     */
+    auto node_at(std::size_t index) const -> ImageNode {
+        ImageNode node;
+        std::memcpy(&node, this->nodes + index * sizeof(ImageNode), sizeof(ImageNode));
+        return node;
+    }
+
+    /**
+     * @brief Mark the node "id" as reached and return it, or nothing if it
+     *        was reached before.
+     *
+     * @param id
+     * @return std::optional<ImageNode>
+     */
+    auto reach(NodeId id) -> std::optional<ImageNode> {
+        if (this->seen[id]) {
+            return std::nullopt;
+        }
+        this->seen[id] = true;
+        return this->node_at(id);
+    }
+
+    /**
+     * @brief Reach the symbol "id" and return whether it is bound to the
+     *        global slot, or to a slot of one of the enclosing frames.
+     *
+     * @param id
+     * @return bool
+     */
+    auto symbol(NodeId id) -> bool {
+        const auto node = this->reach(id);
+        if (!node.has_value() || node->type != NodeType::SYM_CONSTANT) {
+            return false;
+        }
+        return node->binding == Binding::GLOBAL
+            || (node->depth < this->scopes.size() && node->slot < this->scopes[this->scopes.size() - 1 - node->depth]);
+    }
+
+    /**
+     * @brief Reach the list "id" of variable names, which must only
+     *        hold symbols and be marked as syntax, and return its size.
+     *
+     * @param id
+     * @return std::optional<std::size_t>
+     */
+    auto names(NodeId id) -> std::optional<std::size_t> {
+        const auto node = this->reach(id);
+        if (!node.has_value() || node->type != NodeType::LIST_CONSTANT || node->form != Form::SYNTAX) {
+            return std::nullopt;
+        }
+        for (std::uint32_t i = 0; i < node->size; ++i) {
+            const auto name = this->reach(this->child_at(node->value + i));
+            if (!name.has_value() || name->type != NodeType::SYM_CONSTANT) {
+                return std::nullopt;
+            }
+        }
+        return node->size;
+    }
+
+    /**
+     * @brief Walk the expressions "first" to "last" of the list whose
+     *        children start at "start".
+     *
+     * @param start
+     * @param first
+     * @param last
+     * @return bool
+     */
+    auto all(std::uint32_t start, std::uint32_t first, std::uint32_t last) -> bool {
+        for (auto i = first; i < last; ++i) {
+            if (!this->walk(this->child_at(start + i))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Walk the expression "id" and everything it evaluates.
+     *
+     * @param id
+     * @return bool
+     */
+    auto walk(NodeId id) -> bool {
+        if (this->node_at(id).type == NodeType::SYM_CONSTANT) {
+            return this->symbol(id);
+        }
+
+        const auto node = this->reach(id);
+        if (!node.has_value()) {
+            return false;
+        }
+        if (node->type == NodeType::BIG_CONSTANT) {
+            return is_integer_text(this->strings[node->value]);
+        }
+        if (node->type != NodeType::LIST_CONSTANT) {
+            return true;
+        }
+
+        const auto start = node->value;
+        const auto size = node->size;
+        const auto part = [&](std::uint32_t i) { return this->child_at(start + i); };
+
+        switch (node->form) {
+            case Form::CALL:
+                return this->all(start, 0, size);
+
+            case Form::DEFINE:
+                return size == 3 && this->walk(part(0)) && this->node_at(part(1)).binding == Binding::GLOBAL
+                    && this->symbol(part(1)) && this->walk(part(2));
+
+            case Form::SET:
+                return size == 3 && this->all(start, 0, 1) && this->symbol(part(1)) && this->walk(part(2));
+
+            case Form::IF:
+                return (size == 3 || size == 4) && this->all(start, 0, size);
+
+            case Form::LET: {
+                if (size < 3 || !this->walk(part(0))) {
+                    return false;
+                }
+                const auto bindings = this->reach(part(1));
+                if (!bindings.has_value() || bindings->type != NodeType::LIST_CONSTANT || bindings->form != Form::SYNTAX) {
+                    return false;
+                }
+                for (std::uint32_t i = 0; i < bindings->size; ++i) {
+                    const auto pair = this->reach(this->child_at(bindings->value + i));
+                    if (!pair.has_value() || pair->type != NodeType::LIST_CONSTANT || pair->form != Form::SYNTAX
+                        || pair->size != 2) {
+                        return false;
+                    }
+                    const auto name = this->reach(this->child_at(pair->value));
+                    if (!name.has_value() || name->type != NodeType::SYM_CONSTANT
+                        || !this->walk(this->child_at(pair->value + 1))) {
+                        return false;
+                    }
+                }
+
+                this->scopes.push_back(bindings->size);
+                const auto valid = this->all(start, 2, size);
+                this->scopes.pop_back();
+                return valid;
+            }
+
+            case Form::LAMBDA:
+            case Form::DEFUN: {
+                // the body only runs from the lifted function, checked on its own
+                const std::uint32_t params = node->form == Form::DEFUN ? 2 : 1;
+                if (size < params + 2 || !this->walk(part(0))) {
+                    return false;
+                }
+                if (node->form == Form::DEFUN && (this->node_at(part(1)).binding != Binding::GLOBAL || !this->symbol(part(1)))) {
+                    return false;
+                }
+                const auto arity = this->names(part(params));
+                auto &frames = this->functions[node->slot];
+                if (!arity.has_value() || !frames.empty()) {
+                    return false;
+                }
+                frames = this->scopes;
+                frames.push_back(*arity);
+                return true;
+            }
+
+            default:
+                return false;
+        }
+    }
+};
+
+/**
+ * @brief Check the tree starting at "cursor", functions included, and
+ *        move past it. Returns false if loading it would go out of
+ *        bounds or call a built-in that does not exist under its name,
+ *        or if running it would find a form or a local the resolver
+ *        would never have left. "scopes" are the slots of each frame
+ *        the tree runs in, innermost last.
+ *
+ * @param cursor
+ * @param symbols
+ * @param root
+ * @param scopes
+ * @return bool
+ */
+static auto check_ast(Cursor &cursor, const std::vector<SymbolId> &symbols, NodeId root,
+                      const std::vector<std::size_t> &scopes) -> bool {
+    ImageAst ast;
+    if (!cursor.take(ast) || root >= ast.nodes) {
+        return false;
+    }
+
+    // every string and function takes up bytes of its own, so a count
+    // larger than what is left is damage, not something to allocate for
+    const auto left = cursor.data.size() - cursor.offset;
+    if (ast.strings > left / sizeof(std::uint32_t) || ast.functions > left / (sizeof(ImageFunction) + sizeof(ImageAst))) {
+        return false;
+    }
+    std::vector<std::string_view> strings(ast.strings);
+    for (auto &text : strings) {
+        if (!cursor.take_text(text)) {
+            return false;
+        }
+    }
+    if (!cursor.skip(ast.numbers, sizeof(std::int64_t))) {
+        return false;
+    }
+
+    const auto children = cursor.offset;
+    if (!cursor.skip(ast.children, sizeof(NodeId))) {
+        return false;
+    }
+    const auto nodes = cursor.offset;
+    if (!cursor.skip(ast.nodes, sizeof(ImageNode)) || !cursor.skip(ast.nodes, sizeof(std::uint32_t))) {
+        return false;
+    }
+
+    TreeCheck tree {
+        cursor.data.data() + children,
+        cursor.data.data() + nodes,
+        strings,
+        std::vector<bool>(ast.nodes),
+        scopes,
+        std::vector<std::vector<std::size_t>>(ast.functions),
+    };
+
+    for (std::uint32_t i = 0; i < ast.children; ++i) {
+        if (tree.child_at(i) >= ast.nodes) {
+            return false;
+        }
+    }
+    for (std::uint32_t i = 0; i < ast.nodes; ++i) {
+        const auto node = tree.node_at(i);
+        bool valid = node.binding <= Binding::LOCAL;
+
+        switch (node.type) {
+            case NodeType::NUM_CONSTANT:
+            case NodeType::REAL_CONSTANT:
+                valid = valid && node.value < ast.numbers;
+                break;
+
+            case NodeType::STR_CONSTANT:
+                valid = valid && node.value < ast.strings;
+                break;
+
+            case NodeType::BIG_CONSTANT:
+                valid = valid && node.value < ast.strings && is_integer_text(strings[node.value]);
+                break;
+
+            case NodeType::SYM_CONSTANT:
+                valid = valid && node.value < symbols.size();
+                break;
+
+            case NodeType::LIST_CONSTANT: {
+                valid = valid && node.value <= ast.children && node.size <= ast.children - node.value;
+
+                if (node.form == Form::LAMBDA || node.form == Form::DEFUN) {
+                    valid = valid && node.slot < ast.functions;
+                }
+                else if (node.form == Form::CALL) {
+                    valid = valid && (node.slot == NO_CACHE || node.slot < ast.caches);
+                }
+                else {
+                    valid = valid && node.form <= Form::SYNTAX;
+                }
+
+                // the built-in has to still exist under the same name
+                if (valid && node.builtin) {
+                    const auto head = node.size != 0 ? tree.node_at(tree.child_at(node.value)) : ImageNode {};
+                    valid = node.size != 0 && head.type == NodeType::SYM_CONSTANT
+                         && head.value < symbols.size() && find_builtin(symbols[head.value]) != nullptr;
+                }
+                break;
+            }
+
+            default:
+                valid = false;
+                break;
+        }
+        if (!valid) {
+            return false;
+        }
+    }
+
+    // the body of a function is a list of expressions run in a row,
+    // any other tree is one expression
+    const auto top = tree.node_at(root);
+    if (!scopes.empty() && top.type == NodeType::LIST_CONSTANT && top.form == Form::SYNTAX) {
+        tree.seen[root] = true;
+        if (!tree.all(top.value, 0, top.size)) {
+            return false;
+        }
+    }
+    else if (!tree.walk(root)) {
+        return false;
+    }
+
+    for (std::uint32_t i = 0; i < ast.caches; ++i) {
+        BinaryOp op;
+        if (!cursor.take(op) || op > BinaryOp::DIV) {
+            return false;
+        }
+    }
+
+    for (std::uint32_t i = 0; i < ast.functions; ++i) {
+        ImageFunction function;
+        const auto &frames = tree.functions[i];
+
+        if (!cursor.take(function) || (function.named && function.name >= symbols.size())
+            || frames.empty() || function.arity != frames.back()
+            || !check_ast(cursor, symbols, function.body, frames)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Load the tree starting at "cursor", which was checked, into the
+ *        empty "ast", lifting its functions again, and move past it.
+ *
+ * @param cursor
+ * @param symbols
+ * @param ast
+ */
+static auto load_ast(Cursor &cursor, const std::vector<SymbolId> &symbols, Ast &ast) -> void {
+    ImageAst counts;
+    cursor.take(counts);
+
+    std::vector<std::uint32_t> strings(counts.strings);
+    for (auto &string : strings) {
+        std::string_view text;
+        cursor.take_text(text);
+        string = ast.strings.intern(text);
+    }
+
+    const auto numbers = cursor.data.data() + cursor.offset;
+    cursor.offset += counts.numbers * sizeof(std::int64_t);
+
+    ast.children.resize(counts.children);
+    std::memcpy(ast.children.data(), cursor.data.data() + cursor.offset, counts.children * sizeof(NodeId));
+    cursor.offset += counts.children * sizeof(NodeId);
+
+    std::vector<NodeId> calls;
+    ast.nodes.reserve(counts.nodes);
+    for (std::uint32_t i = 0; i < counts.nodes; ++i) {
+        ImageNode image;
+        cursor.take(image);
+
+        Node node;
+        node.type = image.type;
+        node.form = image.form;
+        node.binding = image.binding;
+        node.size = image.size;
+        node.depth = image.depth;
+        node.slot = image.slot;
+
+        switch (image.type) {
+            case NodeType::NUM_CONSTANT:
+            case NodeType::REAL_CONSTANT:
+                std::memcpy(&node.number, numbers + image.value * sizeof(std::int64_t), sizeof(std::int64_t));
+                break;
+
+            case NodeType::STR_CONSTANT:
+                node.string = strings[image.value];
+                break;
+
+            case NodeType::BIG_CONSTANT:
+                node.string = strings[image.value];
+                node.bignum = BigInt::parse(ast.strings.get(node.string)->view());
+                ast.bignums.push_back(node.bignum);
+                break;
+
+            case NodeType::SYM_CONSTANT:
+                node.symbol = symbols[image.value];
+                break;
+
+            case NodeType::LIST_CONSTANT:
+                node.first = image.value;
+                node.callee = nullptr;
+                if (image.builtin) {
+                    calls.push_back(i);
+                }
+                break;
+        }
+        ast.nodes.push_back(node);
+    }
+
+    // offsets only ever end up in errors, so any value will do
+    ast.offsets.resize(counts.nodes);
+    std::memcpy(ast.offsets.data(), cursor.data.data() + cursor.offset, counts.nodes * sizeof(std::uint32_t));
+    cursor.offset += counts.nodes * sizeof(std::uint32_t);
+
+    for (const auto call : calls) {
+        auto &list = ast.nodes[call];
+        list.callee = find_builtin(ast.nodes[ast.children[list.first]].symbol);
+    }
+
+    ast.caches.reserve(counts.caches);
+    for (std::uint32_t i = 0; i < counts.caches; ++i) {
+        CallCache cache {CacheState::EMPTY, BinaryOp::NONE, 0, nullptr};
+        cursor.take(cache.op);
+        ast.caches.push_back(cache);
+    }
+
+    ast.functions.reserve(counts.functions);
+    for (std::uint32_t i = 0; i < counts.functions; ++i) {
+        ImageFunction image;
+        cursor.take(image);
+
+        auto function = new Function;
+        function->refs = 1;
+        function->arity = image.arity;
+        if (image.named) {
+            function->name = symbols[image.name];
+        }
+        function->body = image.body;
+        ast.functions.push_back(function);
+
+        load_ast(cursor, symbols, function->ast);
+    }
+}
+
+/**
+ * @brief Construct a new Image object mapping the file at "path".
+ *
+ * @param path
+ */
+Image::Image(const char *path)
+    : file(path), offset(0), remaining(0) {
+}
+
+/**
+ * @brief Open the image of a source of "size" bytes hashing to "hash"
+ *        in the directory "dir". Returns null if there is none, or if
+ *        it was written for another source or by another version of
+ *        the interpreter, or is damaged in any way.
+ *
+ * @param dir
+ * @param hash
+ * @param size
+ * @return std::unique_ptr<Image>
+ */
+auto Image::open(const std::string &dir, std::uint64_t hash, std::size_t size) -> std::unique_ptr<Image> {
+    const auto path = image_path(dir, hash);
+
+    struct stat info {};
+    if (::stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) {
+        return nullptr;
+    }
+
+    std::unique_ptr<Image> image(new Image(path.c_str()));
+    if (!image->check(hash, size)) {
+        return nullptr;
+    }
+    return image;
+}
+
+/**
+ * @brief Return whether every form has been loaded.
+ *
+ * @return bool
+ */
+auto Image::done() const -> bool {
+    return this->remaining == 0;
+}
+
+/**
+ * @brief Load the next form into "ast", which must be empty, and
+ *        return the index of its root. Only called until done.
+ *
+ * @param ast
+ * @return NodeId
+ */
+auto Image::next(Ast &ast) -> NodeId {
+    Cursor cursor {this->file.view(), this->offset};
+    NodeId root = 0;
+
+    cursor.take(root);
+    load_ast(cursor, this->symbols, ast);
+
+    this->offset = cursor.offset;
+    --this->remaining;
+    return root;
+}
+
+/**
+ * @brief Check the image is one of a source of "size" bytes hashing
+ *        to "hash", is whole, and can be loaded without going out of
+ *        bounds, referring to anything missing or holding a tree the
+ *        resolver would not have left, and read its symbols.
+ *
+ * @param hash
+ * @param size
+ * @return bool
+ */
+auto Image::check(std::uint64_t hash, std::size_t size) -> bool {
+    Cursor cursor {this->file.view(), 0};
+    ImageHeader header;
+
+    if (!cursor.take(header)
+        || std::memcmp(header.magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) != 0
+        || header.version != IMAGE_VERSION || header.order != IMAGE_ORDER
+        || header.hash != hash || header.size != size
+        || header.checksum != hash_source(cursor.data.substr(sizeof(ImageHeader)))) {
+        return false;
+    }
+
+    if (header.symbols > (cursor.data.size() - cursor.offset) / sizeof(std::uint32_t)) {
+        return false;
+    }
+    this->symbols.reserve(header.symbols);
+    for (std::uint32_t i = 0; i < header.symbols; ++i) {
+        std::string_view name;
+        if (!cursor.take_text(name)) {
+            return false;
+        }
+        this->symbols.push_back(intern_symbol(name));
+    }
+
+    const auto start = cursor.offset;
+    for (std::uint32_t i = 0; i < header.forms; ++i) {
+        NodeId root;
+        if (!cursor.take(root) || !check_ast(cursor, this->symbols, root, {})) {
+            return false;
+        }
+    }
+    if (cursor.offset != cursor.data.size()) {
+        return false;
+    }
+
+    this->offset = start;
+    this->remaining = header.forms;
+    return true;
+}
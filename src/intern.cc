@@ -0,0 +1,72 @@
+#include "../include/intern.h"
+
+/**
+ * @brief Destroy the StringPool object, dropping its references.
+ */
+StringPool::~StringPool() {
+    this->clear();
+}
+
+/**
+ * @brief Return the index of "text", adding it to the pool if it is new.
+ *
+ * @param text
+ * @return std::uint32_t
+ */
+auto StringPool::intern(std::string_view text) -> std::uint32_t {
+    const auto found = this->lookup.find(text);
+    if (found != this->lookup.end()) {
+        return found->second;
+    }
+
+    const auto index = static_cast<std::uint32_t>(this->strings.size());
+    const auto string = String::make(text);
+
+    this->strings.push_back(string);
+    this->lookup.emplace(string->view(), index);
+    return index;
+}
+
+/**
+ * @brief Return the index of "text" if it has already been interned.
+ *
+ * @param text
+ * @return std::optional<std::uint32_t>
+ */
+auto StringPool::find(std::string_view text) const -> std::optional<std::uint32_t> {
+    const auto found = this->lookup.find(text);
+    if (found == this->lookup.end()) {
+        return std::nullopt;
+    }
+    return found->second;
+}
+
+/**
+ * @brief Return the string stored at "index".
+ *
+ * @param index
+ * @return String*
+ */
+auto StringPool::get(std::uint32_t index) const -> String* {
+    return this->strings[index];
+}
+
+/**
+ * @brief Return how many strings are in the pool.
+ *
+ * @return std::size_t
+ */
+auto StringPool::size() const -> std::size_t {
+    return this->strings.size();
+}
+
+/**
+ * @brief Drop every string from the pool.
+ */
+auto StringPool::clear() -> void {
+    this->lookup.clear();
+    for (const auto string : this->strings) {
+        string->release();
+    }
+    this->strings.clear();
+}
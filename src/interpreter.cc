@@ -0,0 +1,1069 @@
+#include "../include/interpreter.h"
+#include "../include/builtin.h"
+#include "../include/cache.h"
+#include "../include/compiler.h"
+#include "../include/error.h"
+#include "../include/function.h"
+#include "../include/image.h"
+#include "../include/optimize.h"
+#include "../include/parser.h"
+#include "../include/pool.h"
+#include "../include/profile.h"
+#include "../include/ref.h"
+#include "../include/resolve.h"
+#include "../include/result.h"
+#include "../include/schedule.h"
+#include "../include/symbol.h"
+
+#include <cstdint>
+#include <deque>
+#include <memory_resource>
+#include <optional>
+#include <pthread.h>
+#include <sstream>
+#include <string>
+#include <utility>
+
+static auto prepare(Ast &ast, NodeId root) -> Result<void>;
+static auto place_error(Error &err, std::string_view source) -> void;
+static auto place_error(Error &err, const Reader &reader) -> void;
+
+/**
+ * @brief Calls with at most this many arguments never allocate for them.
+ */
+static constexpr std::size_t SMALL_ARITY = 8;
+
+/**
+ * @brief The interpreter running on the calling thread and the VM
+ *        its Scope borrowed there, if any.
+ */
+static thread_local Interpreter *current_interpreter = nullptr;
+static thread_local Vm *current_vm = nullptr;
+
+/**
+ * @brief Calls of user functions the tree-walker on the calling thread
+ *        is inside of, each one an eval_node frame on the native stack.
+ */
+static thread_local std::size_t call_depth = 0;
+
+/**
+ * @brief Functions builtins on the calling thread called back into that
+ *        have not returned yet, with either engine. Each one also takes the
+ *        native stack of the builtin and of a fresh run of the engine, so
+ *        far fewer of them are allowed than of plain calls.
+ */
+static thread_local std::size_t callback_depth = 0;
+static constexpr std::size_t MAX_CALLBACK_DEPTH = 1000;
+
+/**
+ * @brief Native stack left free below the deepest call, for the builtins it
+ *        makes and for throwing the error that stops it.
+ */
+static constexpr std::size_t STACK_RESERVE = 256 * 1024;
+
+/**
+ * @brief Return whether the native stack of the calling thread is nearly
+ *        used up. How much a call takes depends on how the interpreter was
+ *        built, so this backs up the limits on how deep calls go. Where the
+ *        stack ends is only looked up once per thread.
+ *
+ * @return bool
+ */
+static auto stack_exhausted() -> bool {
+    static thread_local std::uintptr_t floor = 0;
+
+    if (floor == 0) [[unlikely]] {
+        pthread_attr_t attr;
+        void *base = nullptr;
+        std::size_t size = 0;
+
+        if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+            pthread_attr_getstack(&attr, &base, &size);
+            pthread_attr_destroy(&attr);
+        }
+        // without a known stack the check never fires
+        floor = base != nullptr && size > STACK_RESERVE ? reinterpret_cast<std::uintptr_t>(base) + STACK_RESERVE : 1;
+    }
+    return reinterpret_cast<std::uintptr_t>(__builtin_frame_address(0)) < floor;
+}
+
+/**
+ * @brief Struct counting the frame it lives in as one level deeper in
+ *        "count" from when it is first entered until it is destroyed.
+ *        Entering it again, like a tail call does, counts nothing.
+ */
+struct CallDepth final {
+    /**
+     * @brief Construct a new CallDepth object counting into "count",
+     *        not entered yet.
+     *
+     * @param count
+     */
+    explicit CallDepth(std::size_t &count)
+        : count(count) {
+    }
+
+    CallDepth(const CallDepth&) = delete;
+    auto operator=(const CallDepth&) -> CallDepth& = delete;
+
+    /**
+     * @brief Destroy the CallDepth object, leaving its level.
+     */
+    ~CallDepth() {
+        if (this->active) {
+            --this->count;
+        }
+    }
+
+    /**
+     * @brief Count the frame as one level deeper, unless it already is,
+     *        and return true, or return false if "limit" levels are in use
+     *        or the native stack is nearly used up, which is only looked
+     *        at every few levels.
+     *
+     * @param limit
+     * @return bool
+     */
+    inline auto enter(std::size_t limit) -> bool {
+        if (this->active) {
+            return true;
+        }
+        if (this->count == limit || (this->count % 16 == 0 && stack_exhausted())) [[unlikely]] {
+            return false;
+        }
+        ++this->count;
+        this->active = true;
+        return true;
+    }
+
+private:
+    std::size_t &count;
+    bool active = false;
+};
+
+/**
+ * @brief Struct representing where the top-level forms of a script come
+ *        from: parsed from "reader", or loaded from "image" if it is set.
+ */
+struct Interpreter::Script final {
+    Reader *reader;
+    Image *image;
+    ImageWriter *writer; // records every form parsed, if set
+};
+
+/**
+ * @brief Construct a new Scope object making "interpreter"
+ *        the one running on the calling thread.
+ *
+ * @param interpreter
+ */
+Interpreter::Scope::Scope(Interpreter &interpreter)
+    : interpreter(interpreter), previous(current_interpreter), previous_vm(current_vm),
+      vm(interpreter.borrow_vm()), level(0), redirect(interpreter.config.sinks) {
+    current_interpreter = &interpreter;
+    current_vm = this->vm;
+}
+
+/**
+ * @brief Destroy the Scope object, giving the VM back and
+ *        putting back whatever ran on the thread before.
+ */
+Interpreter::Scope::~Scope() {
+    current_interpreter = this->previous;
+    current_vm = this->previous_vm;
+    this->interpreter.give_back_vm(this->vm);
+}
+
+/**
+ * @brief Construct a new Interpreter object set up as "config" says.
+ *
+ * @param config
+ */
+Interpreter::Interpreter(Config config)
+    : config(std::move(config)), forms(0) {
+}
+
+/**
+ * @brief Evaluate the top-level form at the start of "source" and return
+ *        its value, which is only valid until the next form is evaluated
+ *        unless it is persisted. Errors are thrown as Error,
+ *        placed at the line and column of "source" they come from.
+ *
+ * @param source
+ * @return Data
+ */
+auto Interpreter::eval(std::string_view source) -> Data {
+    return this->try_eval(source).take();
+}
+
+/**
+ * @brief Evaluate the top-level form at the start of "source" like eval,
+ *        but hand back the error instead of throwing it, for callers
+ *        that expect many of them, like a REPL.
+ *
+ * @param source
+ * @return Result<Data>
+ */
+auto Interpreter::try_eval(std::string_view source) -> Result<Data> {
+    const Scope scope(*this);
+    const ArenaScope arena(this->arena);
+    Text text(source);
+
+    auto result = [&]() -> Result<Data> {
+        // only what runs outside of the parser and the evaluator still throws
+        try {
+            form_arena().reset();
+            this->ast.reset();
+
+            auto root = parse_ast(text, this->ast);
+            if (!root.ok()) {
+                return std::move(root.error());
+            }
+            if (auto prepared = prepare(this->ast, root.value()); !prepared.ok()) {
+                return std::move(prepared.error());
+            }
+            return this->evaluate(root.value());
+        }
+        catch (Error &err) {
+            return std::move(err);
+        }
+    }();
+
+    if (!result.ok()) {
+        place_error(result.error(), source);
+    }
+    return result;
+}
+
+/**
+ * @brief Evaluate every top-level form of "source" in order and return
+ *        the value of the last one, or nothing if there are none. It is
+ *        only valid until the next form is evaluated unless it is
+ *        persisted. The first error stops the run and is thrown as Error,
+ *        placed at the line and column of "source" it comes from.
+ *
+ * @param source
+ * @return Data
+ */
+auto Interpreter::run(std::string_view source) -> Data {
+    const Scope scope(*this);
+    const ArenaScope arena(this->arena);
+    Reader reader(source.data(), source.size());
+    Script script {&reader, nullptr, nullptr};
+
+    auto result = this->run_forms(script);
+    if (!result.ok()) {
+        place_error(result.error(), reader);
+    }
+    return result.take();
+}
+
+/**
+ * @brief Evaluate the script at "path", or stdin if "path" is "-". Each
+ *        top-level form is evaluated as soon as it has all been read,
+ *        unless forms run in parallel. The first error stops the run
+ *        and is thrown as Error once everything before it is written,
+ *        placed at the line and column of the script it comes from.
+ *        With a cache directory set, a script that was run before with
+ *        the same contents is loaded from its compiled image instead of
+ *        being parsed, and one that wasn't gets an image once it ran.
+ *
+ * @param path
+ */
+auto Interpreter::run_file(const char *path) -> void {
+    const Scope scope(*this);
+    const ArenaScope arena(this->arena);
+    const auto &cache_dir = this->config.cache_dir;
+
+    if (cache_dir.empty() || std::string_view(path) == "-") {
+        Reader reader(path);
+        Script script {&reader, nullptr, nullptr};
+
+        auto result = this->run_script(script);
+        if (!result.ok()) {
+            place_error(result.error(), reader);
+        }
+        result.take();
+        return;
+    }
+
+    // images are keyed on what the script says, so editing it
+    // is all it takes for its old image to go unused
+    const Source source(path);
+    const auto text = source.view();
+    const auto hash = hash_source(text);
+
+    if (const auto image = Image::open(cache_dir, hash, text.size())) {
+        Script script {nullptr, image.get(), nullptr};
+
+        auto result = this->run_script(script);
+        if (!result.ok()) {
+            place_error(result.error(), text);
+        }
+        result.take();
+        return;
+    }
+
+    Reader reader(text.data(), text.size());
+    ImageWriter writer;
+    Script script {&reader, nullptr, &writer};
+
+    auto result = this->run_script(script);
+    if (!result.ok()) {
+        place_error(result.error(), text);
+    }
+    result.take();
+    writer.save(cache_dir, hash, text.size());
+}
+
+/**
+ * @brief Call the function "callee" with "args" for a builtin and return
+ *        its result, running user functions with the engine picked in
+ *        the config. Like any result, it may point into the form arena.
+ *        Errors are raised the way builtins raise their own.
+ *
+ * @param callee
+ * @param args
+ * @return Data
+ */
+auto Interpreter::apply(const Data &callee, Args args) -> Data {
+    // the builtin calling back may not have looked at what it raised yet
+    if (raised_error != nullptr) [[unlikely]] {
+        return Data();
+    }
+
+    if (callee.type != DataType::CLOSURE) {
+        CallCache spare {CacheState::MEGAMORPHIC, BinaryOp::NONE, 0, nullptr};
+        const auto fn = lookup_cached(spare, callee);
+
+        if (fn == nullptr) {
+            return fail(ErrorCode::NAME, "Tried to call an unknown function and failed!");
+        }
+        return call_builtin(fn, args);
+    }
+
+    CallDepth callback(callback_depth);
+    if (!callback.enter(MAX_CALLBACK_DEPTH)) [[unlikely]] {
+        return fail(ErrorCode::LIMIT, "Maximum recursion depth exceeded");
+    }
+
+    const auto &closure = *callee.closure;
+    if (this->config.engine == Engine::VM) {
+        return current_vm->call(closure, args);
+    }
+
+    const auto &function = *closure.function;
+    if (args.size() != function.arity) {
+        return fail(ErrorCode::ARITY, "Expected ", std::to_string(function.arity),
+                    " arguments but got ", std::to_string(args.size()));
+    }
+
+    const ProfileFrame profiled(function_frame(function));
+    auto frame = Ref<Env>(Env::make(args.size(), closure.env));
+    for (std::size_t i = 0; i < args.size(); ++i) {
+        frame->slots()[i] = args[i].persist();
+    }
+
+    const auto exprs = function.ast.children_of(function.body);
+    for (const auto expr : exprs.first(exprs.size() - 1)) {
+        this->eval_node(function.ast, expr, frame.get());
+    }
+    return this->eval_node(function.ast, exprs.back(), frame.get());
+}
+
+/**
+ * @brief Return how many top-level forms have been evaluated so far.
+ *
+ * @return std::size_t
+ */
+auto Interpreter::forms_evaluated() const -> std::size_t {
+    return this->forms.load();
+}
+
+/**
+ * @brief Return the interpreter running on the calling thread,
+ *        or null if there is none.
+ *
+ * @return Interpreter*
+ */
+auto Interpreter::current() -> Interpreter* {
+    return current_interpreter;
+}
+
+/**
+ * @brief Struct representing a top-level form of a script run in parallel,
+ *        kept along with what it printed until it can be written out.
+ */
+struct BatchForm final {
+    Ast ast;
+    NodeId root = 0;
+    Chunk chunk; // not the VM's own, which a form its thread waits in is using
+    Transcript transcript;
+    Error error;                        // what stopped it, if "failed"
+    bool failed = false;
+    bool done = false;                  // guarded by Interpreter::Batch::lock
+    std::atomic<std::uint32_t> waiting; // forms it still waits for
+};
+
+/**
+ * @brief Struct representing a script whose forms run in parallel.
+ */
+struct Interpreter::Batch final {
+    std::deque<BatchForm> forms;
+    FormGraph graph;
+    TaskGroup group;
+    std::mutex lock;
+    std::size_t written = 0;         // forms whose output is out, guarded by "lock"
+    std::atomic<std::size_t> stop {0}; // the first form that failed, or the form count
+};
+
+/**
+ * @brief Run the form "index" of "batch" on the calling thread, recording what
+ *        it prints, then write out every form whose turn has come and start
+ *        the forms that were only waiting for this one. Nothing after a form
+ *        that failed is started. The thread may be waiting in the middle of
+ *        another form, so the form gets an arena and a task level of its own.
+ *
+ * @param batch
+ * @param index
+ */
+auto Interpreter::run_batch_form(Batch &batch, std::size_t index) -> void {
+    auto &form = batch.forms[index];
+
+    if (index > batch.stop.load(std::memory_order_acquire)) {
+        return;
+    }
+    ++this->forms;
+
+    {
+        const TaskArena arena;
+        const TaskLevel level(0);
+        const Recording recording(&form.transcript);
+        const ProfileTask task({});
+        ProfileFrame profiled;
+
+        try {
+            if (profiling.load(std::memory_order_relaxed)) {
+                profiled.enter(form_frame(form.ast, form.root));
+            }
+            if (auto result = this->execute(form.ast, form.root, form.chunk); !result.ok()) {
+                form.error = std::move(result.error());
+                form.failed = true;
+            }
+        }
+        catch (Error &err) {
+            form.error = std::move(err);
+            form.failed = true;
+        }
+
+        if (form.failed) {
+            auto stop = batch.stop.load(std::memory_order_acquire);
+            while (index < stop && !batch.stop.compare_exchange_weak(stop, index)) {
+            }
+        }
+    }
+
+    {
+        const std::lock_guard guard(batch.lock);
+        const Recording straight_out(nullptr);
+
+        form.done = true;
+        while (batch.written < batch.forms.size() && batch.forms[batch.written].done) {
+            auto &next = batch.forms[batch.written];
+
+            next.transcript.replay();
+            next.transcript = Transcript();
+            if (next.failed) {
+                break;
+            }
+            ++batch.written;
+        }
+    }
+
+    if (form.failed) {
+        return;
+    }
+    for (const auto successor : batch.graph.successors[index]) {
+        if (batch.forms[successor].waiting.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            task_pool().spawn(batch.group, [this, &batch, successor] {
+                const Scope scope(*this);
+                this->run_batch_form(batch, successor);
+            });
+        }
+    }
+}
+
+/**
+ * @brief Run every form "script" has on the task pool. Every form is read
+ *        and prepared first, then forms that touch none of the same globals
+ *        run at the same time, each starting as soon as the forms it depends
+ *        on are done. What they print is held back and written out in source
+ *        order, and the first error in source order ends the run after
+ *        everything before it was written, just like running the forms one
+ *        after another.
+ *
+ * @param script
+ * @return Result<void>
+ */
+auto Interpreter::run_batch(Script &script) -> Result<void> {
+    std::optional<Error> error;
+
+    // every form has finished before the error is handed back
+    {
+        Batch batch;
+        std::vector<Effects> effects;
+
+        try {
+            while (true) {
+                auto &form = batch.forms.emplace_back();
+                auto next = this->next_form(script, form.ast, form.root);
+
+                if (!next.ok()) {
+                    error = std::move(next.error());
+                    break;
+                }
+                if (!next.value()) {
+                    batch.forms.pop_back();
+                    break;
+                }
+                effects.push_back(collect_effects(form.ast, form.root));
+            }
+        }
+        catch (Error &err) {
+            error = std::move(err);
+        }
+
+        // the forms before the broken one still run
+        if (batch.forms.size() > effects.size()) {
+            batch.forms.pop_back();
+        }
+
+        batch.graph = order_forms(effects);
+        batch.stop = batch.forms.size();
+        this->globals.reserve(symbol_count());
+
+        for (std::size_t i = 0; i < batch.forms.size(); ++i) {
+            batch.forms[i].waiting = batch.graph.predecessors[i];
+        }
+        for (std::size_t i = 0; i < batch.forms.size(); ++i) {
+            if (batch.graph.predecessors[i] == 0) {
+                task_pool().spawn(batch.group, [this, &batch, i] {
+                    const Scope scope(*this);
+                    this->run_batch_form(batch, i);
+                });
+            }
+        }
+        task_pool().wait(batch.group);
+
+        const auto stop = batch.stop.load();
+        if (stop < batch.forms.size()) {
+            error = batch.forms[stop].error;
+        }
+    }
+
+    if (error.has_value()) {
+        return std::move(*error);
+    }
+    return {};
+}
+
+/**
+ * @brief Record that the error raised on the calling thread, if there
+ *        is one, happened at "offset" in the source, unless code closer
+ *        to where it happened already did.
+ *
+ * @param offset
+ */
+static auto locate_raised(std::size_t offset) -> void {
+    if (raised_error != nullptr) [[unlikely]] {
+        raised_error->locate(offset);
+    }
+}
+
+/**
+ * @brief Call the built-in function "fn" with "args" for the call at "offset"
+ *        in the source and return its result, locating any error it raises
+ *        there. Once an error was raised nothing is called anymore, since the
+ *        arguments are only what was left behind by whatever raised it.
+ *
+ * @param offset
+ * @param fn
+ * @param args
+ * @return Data
+ */
+static inline auto call_at(std::size_t offset, BuiltinFn fn, Args args) -> Data {
+    if (raised_error != nullptr) [[unlikely]] {
+        return Data();
+    }
+    auto result = call_builtin(fn, args);
+    locate_raised(offset);
+    return result;
+}
+
+/**
+ * @brief Take function/list as a span of Data and call it by looking its name up
+ *        in the built-in table, through the inline cache of the call site at
+ *        "offset". Only used for call sites that could not be bound while parsing
+ *        and whose head did not evaluate to a user function.
+ *
+ * @param offset
+ * @param args
+ * @param cache
+ * @return Data
+ */
+static auto call_func(std::size_t offset, Args args, CallCache &cache) -> Data {
+    if (raised_error != nullptr) [[unlikely]] {
+        return Data();
+    }
+    if (args.empty()) {
+        return fail_at(offset, ErrorCode::SYNTAX, "Tried to call an empty list!");
+    }
+    const auto fn = lookup_cached(cache, args[0]);
+
+    if (fn == nullptr) {
+        // looking it up may have raised a better error already
+        fail(ErrorCode::NAME, "Tried to call an unknown function and failed!");
+        locate_raised(offset);
+        return Data();
+    }
+    return call_at(offset, fn, args.subspan(1));
+}
+
+/**
+ * @brief Evaluate a node and slowly collapse an abstract syntax tree into a single value.
+ *        "env" is the frame of the innermost let or function around the node, null at
+ *        the top level. Expressions in tail position, the branch an if takes, the last
+ *        expression of a let and the body of a function being called, are evaluated by
+ *        looping rather than recursing, so tail calls run in constant native stack.
+ *        Errors are raised instead of thrown and only looked at where calls are
+ *        made, with no check after every node: once one was raised nothing more
+ *        is called, so the walk winds down on its own, and it is located at the
+ *        call that raised it.
+ *
+ * @param ast
+ * @param id
+ * @param env
+ * @return Data
+ */
+auto Interpreter::eval_node(const Ast &ast, NodeId id, Env *env) -> Data {
+    // what the loop is evaluating, kept alive here once it is a
+    // frame or function entered in tail position
+    const Ast *code = &ast;
+    Ref<Env> scope;
+    Ref<Function> running;
+    ProfileFrame profiled;
+    CallDepth depth(call_depth);
+
+    for (;;) {
+        const auto &node = code->nodes[id];
+
+        switch (node.type) {
+            case NodeType::SYM_CONSTANT:
+                if (node.binding == Binding::LOCAL) {
+                    return env->at(node.depth, node.slot);
+                }
+                return this->globals.get(node.symbol);
+
+            case NodeType::LIST_CONSTANT:
+                break;
+
+            default:
+                return convert_to_data(*code, id);
+        }
+
+        const auto body = code->children_of(id);
+
+        switch (node.form) {
+            case Form::CALL:
+                break;
+
+            case Form::IF:
+                if (this->eval_node(*code, body[1], env).is_truthy()) {
+                    id = body[2];
+                }
+                else if (body.size() == 4) {
+                    id = body[3];
+                }
+                else {
+                    return Data();
+                }
+                continue;
+
+            case Form::LET: {
+                const auto bindings = code->children_of(body[1]);
+                auto frame = Ref<Env>(Env::make(bindings.size(), env));
+
+                for (std::size_t i = 0; i < bindings.size(); ++i) {
+                    const auto value = code->children_of(bindings[i])[1];
+                    frame->slots()[i] = this->eval_node(*code, value, env).persist();
+                }
+                for (const auto expr : body.subspan(2, body.size() - 3)) {
+                    this->eval_node(*code, expr, frame.get());
+                }
+
+                env = frame.get();
+                scope = std::move(frame);
+                id = body.back();
+                continue;
+            }
+
+            default:
+                return this->eval_special(*code, id, env);
+        }
+
+        const auto callee = node.callee;
+        const auto params = callee != nullptr ? body.subspan(1) : body;
+
+        // arithmetic sites that have only seen numbers skip the call,
+        // unless the profiler has to see the builtin being called
+        if (callee != nullptr && node.slot != NO_CACHE) {
+            const Data pair[2] {this->eval_node(*code, params[0], env), this->eval_node(*code, params[1], env)};
+            Data result;
+
+            if (!profiling.load(std::memory_order_relaxed) && try_binary(code->caches[node.slot], pair[0], pair[1], result)) {
+                return result;
+            }
+            return call_at(code->offsets[id], callee, Args(pair, 2));
+        }
+
+        // small calls keep their arguments in this frame,
+        // wide ones spill into the form arena
+        Data inline_args[SMALL_ARITY];
+        std::pmr::vector<Data> spilled(&form_arena());
+        Data *args = inline_args;
+
+        if (params.size() > SMALL_ARITY) {
+            spilled.resize(params.size());
+            args = spilled.data();
+        }
+        for (std::size_t i = 0; i < params.size(); ++i) {
+            args[i] = this->eval_node(*code, params[i], env);
+        }
+
+        if (callee != nullptr) {
+            return call_at(code->offsets[id], callee, Args(args, params.size()));
+        }
+        if (params.empty() || args[0].type != DataType::CLOSURE) {
+            CallCache spare {CacheState::MEGAMORPHIC, BinaryOp::NONE, 0, nullptr};
+            auto &cache = node.slot != NO_CACHE ? code->caches[node.slot] : spare;
+
+            return call_func(code->offsets[id], Args(args, params.size()), cache);
+        }
+
+        // enter the function in place of the call, unless an error was
+        // raised, which also ends any loop the function would have made
+        if (raised_error != nullptr) [[unlikely]] {
+            return Data();
+        }
+        const auto closure = args[0].closure;
+        const auto argc = params.size() - 1;
+        auto function = Ref<Function>::share(closure->function);
+
+        if (argc != function->arity) {
+            return fail_at(code->offsets[id], ErrorCode::ARITY, "Expected ", std::to_string(function->arity),
+                           " arguments but got ", std::to_string(argc));
+        }
+
+        // a tail call leaves the frame of the function it was made in
+        if (!depth.enter(MAX_CALL_DEPTH)) [[unlikely]] {
+            return fail_at(code->offsets[id], ErrorCode::LIMIT, "Maximum recursion depth exceeded");
+        }
+        profiled.enter(function_frame(*function));
+        auto frame = Ref<Env>(Env::make(argc, closure->env));
+        for (std::size_t i = 0; i < argc; ++i) {
+            frame->slots()[i] = args[i + 1].persist();
+        }
+
+        const auto exprs = function->ast.children_of(function->body);
+        for (const auto expr : exprs.first(exprs.size() - 1)) {
+            this->eval_node(function->ast, expr, frame.get());
+        }
+
+        code = &function->ast;
+        id = exprs.back();
+        env = frame.get();
+        scope = std::move(frame);
+        running = std::move(function);
+    }
+}
+
+/**
+ * @brief Evaluate one of the special forms marked by the resolver that
+ *        has nothing in tail position. Values stored in variables are
+ *        persisted, since they may outlive the form arena. Like calls,
+ *        nothing is stored once an error was raised.
+ *
+ * @param ast
+ * @param id
+ * @param env
+ * @return Data
+ */
+auto Interpreter::eval_special(const Ast &ast, NodeId id, Env *env) -> Data {
+    const auto body = ast.children_of(id);
+    const auto &node = ast.nodes[id];
+
+    switch (node.form) {
+        case Form::DEFINE: {
+            auto value = this->eval_node(ast, body[2], env).persist();
+            if (raised_error != nullptr) [[unlikely]] {
+                return Data();
+            }
+
+            this->globals.define(ast.nodes[body[1]].symbol, value);
+            locate_raised(ast.offsets[id]);
+            return value;
+        }
+
+        case Form::SET: {
+            const auto &name = ast.nodes[body[1]];
+            auto value = this->eval_node(ast, body[2], env).persist();
+            if (raised_error != nullptr) [[unlikely]] {
+                return Data();
+            }
+
+            if (name.binding == Binding::LOCAL) {
+                env->assign_at(name.depth, name.slot, value);
+            }
+            else {
+                this->globals.assign(name.symbol, value);
+            }
+            locate_raised(ast.offsets[id]);
+            return value;
+        }
+
+        case Form::LAMBDA:
+        case Form::DEFUN: {
+            auto value = Data::from_closure(Closure::make(ast.functions[node.slot], env));
+            if (node.form == Form::DEFUN && raised_error == nullptr) {
+                this->globals.define(ast.nodes[body[1]].symbol, value);
+                locate_raised(ast.offsets[id]);
+            }
+            return value;
+        }
+
+        default:
+            return fail_at(ast.offsets[id], ErrorCode::RUNTIME, "Tried to evaluate a malformed form!");
+    }
+}
+
+/**
+ * @brief Resolve and optimize a top-level form so it is ready to run,
+ *        or return the error that makes it malformed.
+ *
+ * @param ast
+ * @param root
+ * @return Result<void>
+ */
+static auto prepare(Ast &ast, NodeId root) -> Result<void> {
+    if (auto resolved = resolve(ast, root); !resolved.ok()) {
+        return resolved;
+    }
+    fold_constants(ast, root);
+    lift_functions(ast, root);
+    attach_caches(ast, root);
+    return {};
+}
+
+/**
+ * @brief Give "err" the line and column of its offset into "source",
+ *        if it has one. Lines are only ever counted here, once an
+ *        error is on its way out.
+ *
+ * @param err
+ * @param source
+ */
+static auto place_error(Error &err, std::string_view source) -> void {
+    if (const auto offset = err.offset(); offset.has_value() && *offset <= source.size()) {
+        const auto position = position_of(source, *offset);
+        err.place(position.line, position.column);
+    }
+}
+
+/**
+ * @brief Give "err" the line and column of its offset into what
+ *        "reader" read, if it has one and the reader still knows it.
+ *
+ * @param err
+ * @param reader
+ */
+static auto place_error(Error &err, const Reader &reader) -> void {
+    if (const auto offset = err.offset()) {
+        if (const auto position = reader.position(*offset)) {
+            err.place(position->line, position->column);
+        }
+    }
+}
+
+/**
+ * @brief Evaluate a prepared top-level form with the engine picked in the
+ *        config, compiling it into "chunk" for the VM. The tree-walker is
+ *        kept around so both engines can be diffed.
+ *
+ * @param ast
+ * @param root
+ * @param chunk
+ * @return Result<Data>
+ */
+auto Interpreter::execute(const Ast &ast, NodeId root, Chunk &chunk) -> Result<Data> {
+    if (this->config.engine == Engine::VM) {
+        compile(ast, root, chunk);
+        return current_vm->run(chunk);
+    }
+
+    // the walker raises errors where it makes calls, since checking
+    // after every node slows it down, and they are taken once per form
+    auto value = this->eval_node(ast, root, nullptr);
+    if (raised_error != nullptr) [[unlikely]] {
+        return take_raised_error();
+    }
+    return value;
+}
+
+/**
+ * @brief Evaluate the prepared top-level form "root" of the form ast,
+ *        or print it with dump_ast set.
+ *
+ * @param root
+ * @return Result<Data>
+ */
+auto Interpreter::evaluate(NodeId root) -> Result<Data> {
+    ++this->forms;
+
+    if (this->config.dump_ast) {
+        std::ostringstream dump;
+        this->ast.print(root, dump);
+        dump << '\n';
+        standard_output().write(std::string_view(dump.view()));
+        return Data();
+    }
+
+    ProfileFrame profiled;
+    if (profiling.load(std::memory_order_relaxed)) {
+        profiled.enter(form_frame(this->ast, root));
+    }
+    return this->execute(this->ast, root, current_vm->chunk);
+}
+
+/**
+ * @brief Load the next top-level form of "script" into "ast", ready to
+ *        run, store the index of its root in "root" and return
+ *        true, or return false once there are none left, or the error
+ *        that keeps the form from running. The form arena and "ast" are
+ *        only reset once there is another form, so the value of the last
+ *        one stays valid.
+ *
+ * @param script
+ * @param ast
+ * @param root
+ * @return Result<bool>
+ */
+auto Interpreter::next_form(Script &script, Ast &ast, NodeId &root) -> Result<bool> {
+    std::string_view source;
+
+    if (script.image != nullptr ? script.image->done() : !script.reader->next(source)) {
+        return false;
+    }
+
+    form_arena().reset();
+    ast.reset();
+
+    if (script.image != nullptr) {
+        root = script.image->next(ast);
+        return true;
+    }
+
+    Text text(source, script.reader->offset());
+    auto parsed = parse_ast(text, ast);
+    if (!parsed.ok()) {
+        return std::move(parsed.error());
+    }
+    root = parsed.value();
+
+    if (auto prepared = prepare(ast, root); !prepared.ok()) {
+        return std::move(prepared.error());
+    }
+    if (script.writer != nullptr) {
+        script.writer->add(ast, root);
+    }
+    return true;
+}
+
+/**
+ * @brief Evaluate every top-level form of "script" one after another and
+ *        return the value of the last one, or nothing if there are none,
+ *        or the first error, whether it was handed back or thrown.
+ *
+ * @param script
+ * @return Result<Data>
+ */
+auto Interpreter::run_forms(Script &script) -> Result<Data> {
+    NodeId root;
+    Data last;
+
+    // only what runs outside of the parser and the evaluator still throws
+    try {
+        for (;;) {
+            auto next = this->next_form(script, this->ast, root);
+            if (!next.ok()) {
+                return std::move(next.error());
+            }
+            if (!next.value()) {
+                return last;
+            }
+
+            auto value = this->evaluate(root);
+            if (!value.ok()) {
+                return value;
+            }
+            last = std::move(value.value());
+        }
+    }
+    catch (Error &err) {
+        return std::move(err);
+    }
+}
+
+/**
+ * @brief Evaluate every top-level form of "script" in order, or all at
+ *        once if forms run in parallel, and return the first error.
+ *
+ * @param script
+ * @return Result<void>
+ */
+auto Interpreter::run_script(Script &script) -> Result<void> {
+    if (this->config.parallel_forms && !this->config.dump_ast) {
+        return this->run_batch(script);
+    }
+
+    auto result = this->run_forms(script);
+    if (!result.ok()) {
+        return std::move(result.error());
+    }
+    return {};
+}
+
+/**
+ * @brief Take a VM to run code on one thread, making one if none is spare.
+ *
+ * @return Vm*
+ */
+auto Interpreter::borrow_vm() -> Vm* {
+    const std::lock_guard guard(this->vms_lock);
+
+    if (this->spare_vms.empty()) {
+        this->spare_vms.push_back(std::make_unique<Vm>(this->globals));
+    }
+    const auto vm = this->spare_vms.back().release();
+    this->spare_vms.pop_back();
+    return vm;
+}
+
+/**
+ * @brief Give "vm", taken with borrow_vm, back for the next thread.
+ *
+ * @param vm
+ */
+auto Interpreter::give_back_vm(Vm *vm) -> void {
+    const std::lock_guard guard(this->vms_lock);
+    this->spare_vms.emplace_back(vm);
+}
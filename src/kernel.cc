@@ -0,0 +1,556 @@
+#include "../include/kernel.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LISP_KERNEL_X86 1
+#else
+#define LISP_KERNEL_X86 0
+#endif
+
+using IntsFn = auto (*)(const std::int64_t*, const std::int64_t*, std::int64_t*, std::size_t, bool) -> bool;
+using RealsFn = auto (*)(const double*, const double*, double*, std::size_t, bool) -> void;
+using SumIntsFn = auto (*)(const std::int64_t*, std::size_t, std::int64_t&) -> bool;
+using SumRealsFn = auto (*)(const double*, std::size_t) -> double;
+using DotRealsFn = auto (*)(const double*, const double*, std::size_t) -> double;
+
+/**
+ * @brief One element at a time fallback for add_ints.
+ *
+ * @param lhs
+ * @param rhs
+ * @param out
+ * @param size
+ * @param broadcast
+ * @return bool
+ */
+static auto add_ints_scalar(const std::int64_t *lhs, const std::int64_t *rhs, std::int64_t *out,
+                            std::size_t size, bool broadcast) -> bool {
+    bool overflow = false;
+    for (std::size_t i = 0; i < size; ++i) {
+        overflow |= __builtin_add_overflow(lhs[i], rhs[broadcast ? 0 : i], &out[i]);
+    }
+    return !overflow;
+}
+
+/**
+ * @brief One element at a time implementation of mul_ints. There is no
+ *        64 bit multiply before AVX-512, so this is the only one.
+ *
+ * @param lhs
+ * @param rhs
+ * @param out
+ * @param size
+ * @param broadcast
+ * @return bool
+ */
+static auto mul_ints_scalar(const std::int64_t *lhs, const std::int64_t *rhs, std::int64_t *out,
+                            std::size_t size, bool broadcast) -> bool {
+    bool overflow = false;
+    for (std::size_t i = 0; i < size; ++i) {
+        overflow |= __builtin_mul_overflow(lhs[i], rhs[broadcast ? 0 : i], &out[i]);
+    }
+    return !overflow;
+}
+
+/**
+ * @brief One element at a time fallback for add_reals.
+ *
+ * @param lhs
+ * @param rhs
+ * @param out
+ * @param size
+ * @param broadcast
+ */
+static auto add_reals_scalar(const double *lhs, const double *rhs, double *out,
+                             std::size_t size, bool broadcast) -> void {
+    for (std::size_t i = 0; i < size; ++i) {
+        out[i] = lhs[i] + rhs[broadcast ? 0 : i];
+    }
+}
+
+/**
+ * @brief One element at a time fallback for mul_reals.
+ *
+ * @param lhs
+ * @param rhs
+ * @param out
+ * @param size
+ * @param broadcast
+ */
+static auto mul_reals_scalar(const double *lhs, const double *rhs, double *out,
+                             std::size_t size, bool broadcast) -> void {
+    for (std::size_t i = 0; i < size; ++i) {
+        out[i] = lhs[i] * rhs[broadcast ? 0 : i];
+    }
+}
+
+/**
+ * @brief One element at a time fallback for sum_ints.
+ *
+ * @param values
+ * @param size
+ * @param total
+ * @return bool
+ */
+static auto sum_ints_scalar(const std::int64_t *values, std::size_t size, std::int64_t &total) -> bool {
+    std::int64_t sum = 0;
+    for (std::size_t i = 0; i < size; ++i) {
+        if (__builtin_add_overflow(sum, values[i], &sum)) {
+            return false;
+        }
+    }
+    total = sum;
+    return true;
+}
+
+/**
+ * @brief One element at a time fallback for sum_reals.
+ *
+ * @param values
+ * @param size
+ * @return double
+ */
+static auto sum_reals_scalar(const double *values, std::size_t size) -> double {
+    double sum = 0.0;
+    for (std::size_t i = 0; i < size; ++i) {
+        sum += values[i];
+    }
+    return sum;
+}
+
+/**
+ * @brief One element at a time fallback for dot_reals.
+ *
+ * @param lhs
+ * @param rhs
+ * @param size
+ * @return double
+ */
+static auto dot_reals_scalar(const double *lhs, const double *rhs, std::size_t size) -> double {
+    double sum = 0.0;
+    for (std::size_t i = 0; i < size; ++i) {
+        sum += lhs[i] * rhs[i];
+    }
+    return sum;
+}
+
+#if LISP_KERNEL_X86
+// Every vector routine works the same way: run whole blocks through the
+// registers and hand the leftovers to the scalar code. Integer overflow
+// is spotted lane by lane: a sum overflowed when its sign differs from
+// the signs of both inputs, so those sign bits are or-ed together and
+// checked once at the end instead of branching on every block.
+
+__attribute__((target("sse2")))
+static auto add_ints_sse2(const std::int64_t *lhs, const std::int64_t *rhs, std::int64_t *out,
+                          std::size_t size, bool broadcast) -> bool {
+    const auto splat = broadcast ? _mm_set1_epi64x(*rhs) : _mm_setzero_si128();
+    auto overflow = _mm_setzero_si128();
+    std::size_t i = 0;
+
+    for (; i + 2 <= size; i += 2) {
+        const auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lhs + i));
+        const auto b = broadcast ? splat : _mm_loadu_si128(reinterpret_cast<const __m128i*>(rhs + i));
+        const auto sum = _mm_add_epi64(a, b);
+
+        overflow = _mm_or_si128(overflow, _mm_and_si128(_mm_xor_si128(a, sum), _mm_xor_si128(b, sum)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), sum);
+    }
+
+    const bool fits = _mm_movemask_pd(_mm_castsi128_pd(overflow)) == 0;
+    return add_ints_scalar(lhs + i, broadcast ? rhs : rhs + i, out + i, size - i, broadcast) && fits;
+}
+
+__attribute__((target("sse2")))
+static auto add_reals_sse2(const double *lhs, const double *rhs, double *out,
+                           std::size_t size, bool broadcast) -> void {
+    const auto splat = broadcast ? _mm_set1_pd(*rhs) : _mm_setzero_pd();
+    std::size_t i = 0;
+
+    for (; i + 2 <= size; i += 2) {
+        const auto b = broadcast ? splat : _mm_loadu_pd(rhs + i);
+        _mm_storeu_pd(out + i, _mm_add_pd(_mm_loadu_pd(lhs + i), b));
+    }
+    add_reals_scalar(lhs + i, broadcast ? rhs : rhs + i, out + i, size - i, broadcast);
+}
+
+__attribute__((target("sse2")))
+static auto mul_reals_sse2(const double *lhs, const double *rhs, double *out,
+                           std::size_t size, bool broadcast) -> void {
+    const auto splat = broadcast ? _mm_set1_pd(*rhs) : _mm_setzero_pd();
+    std::size_t i = 0;
+
+    for (; i + 2 <= size; i += 2) {
+        const auto b = broadcast ? splat : _mm_loadu_pd(rhs + i);
+        _mm_storeu_pd(out + i, _mm_mul_pd(_mm_loadu_pd(lhs + i), b));
+    }
+    mul_reals_scalar(lhs + i, broadcast ? rhs : rhs + i, out + i, size - i, broadcast);
+}
+
+__attribute__((target("sse2")))
+static auto sum_ints_sse2(const std::int64_t *values, std::size_t size, std::int64_t &total) -> bool {
+    auto sum = _mm_setzero_si128();
+    auto overflow = _mm_setzero_si128();
+    std::size_t i = 0;
+
+    for (; i + 2 <= size; i += 2) {
+        const auto value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+        const auto next = _mm_add_epi64(sum, value);
+
+        overflow = _mm_or_si128(overflow, _mm_and_si128(_mm_xor_si128(sum, next), _mm_xor_si128(value, next)));
+        sum = next;
+    }
+    if (_mm_movemask_pd(_mm_castsi128_pd(overflow)) != 0) {
+        return false;
+    }
+
+    alignas(16) std::int64_t lanes[2];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), sum);
+
+    std::int64_t rest;
+    if (!sum_ints_scalar(values + i, size - i, rest)
+        || __builtin_add_overflow(lanes[0], lanes[1], &total)
+        || __builtin_add_overflow(total, rest, &total)) {
+        return false;
+    }
+    return true;
+}
+
+__attribute__((target("sse2")))
+static auto sum_reals_sse2(const double *values, std::size_t size) -> double {
+    auto sum = _mm_setzero_pd();
+    std::size_t i = 0;
+
+    for (; i + 2 <= size; i += 2) {
+        sum = _mm_add_pd(sum, _mm_loadu_pd(values + i));
+    }
+
+    alignas(16) double lanes[2];
+    _mm_store_pd(lanes, sum);
+    return lanes[0] + lanes[1] + sum_reals_scalar(values + i, size - i);
+}
+
+__attribute__((target("sse2")))
+static auto dot_reals_sse2(const double *lhs, const double *rhs, std::size_t size) -> double {
+    auto sum = _mm_setzero_pd();
+    std::size_t i = 0;
+
+    for (; i + 2 <= size; i += 2) {
+        sum = _mm_add_pd(sum, _mm_mul_pd(_mm_loadu_pd(lhs + i), _mm_loadu_pd(rhs + i)));
+    }
+
+    alignas(16) double lanes[2];
+    _mm_store_pd(lanes, sum);
+    return lanes[0] + lanes[1] + dot_reals_scalar(lhs + i, rhs + i, size - i);
+}
+
+__attribute__((target("avx2")))
+static auto add_ints_avx2(const std::int64_t *lhs, const std::int64_t *rhs, std::int64_t *out,
+                          std::size_t size, bool broadcast) -> bool {
+    const auto splat = broadcast ? _mm256_set1_epi64x(*rhs) : _mm256_setzero_si256();
+    auto overflow = _mm256_setzero_si256();
+    std::size_t i = 0;
+
+    for (; i + 4 <= size; i += 4) {
+        const auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lhs + i));
+        const auto b = broadcast ? splat : _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rhs + i));
+        const auto sum = _mm256_add_epi64(a, b);
+
+        overflow = _mm256_or_si256(overflow, _mm256_and_si256(_mm256_xor_si256(a, sum), _mm256_xor_si256(b, sum)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), sum);
+    }
+
+    const bool fits = _mm256_movemask_pd(_mm256_castsi256_pd(overflow)) == 0;
+    return add_ints_scalar(lhs + i, broadcast ? rhs : rhs + i, out + i, size - i, broadcast) && fits;
+}
+
+__attribute__((target("avx2")))
+static auto add_reals_avx2(const double *lhs, const double *rhs, double *out,
+                           std::size_t size, bool broadcast) -> void {
+    const auto splat = broadcast ? _mm256_set1_pd(*rhs) : _mm256_setzero_pd();
+    std::size_t i = 0;
+
+    for (; i + 4 <= size; i += 4) {
+        const auto b = broadcast ? splat : _mm256_loadu_pd(rhs + i);
+        _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_loadu_pd(lhs + i), b));
+    }
+    add_reals_scalar(lhs + i, broadcast ? rhs : rhs + i, out + i, size - i, broadcast);
+}
+
+__attribute__((target("avx2")))
+static auto mul_reals_avx2(const double *lhs, const double *rhs, double *out,
+                           std::size_t size, bool broadcast) -> void {
+    const auto splat = broadcast ? _mm256_set1_pd(*rhs) : _mm256_setzero_pd();
+    std::size_t i = 0;
+
+    for (; i + 4 <= size; i += 4) {
+        const auto b = broadcast ? splat : _mm256_loadu_pd(rhs + i);
+        _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(lhs + i), b));
+    }
+    mul_reals_scalar(lhs + i, broadcast ? rhs : rhs + i, out + i, size - i, broadcast);
+}
+
+__attribute__((target("avx2")))
+static auto sum_ints_avx2(const std::int64_t *values, std::size_t size, std::int64_t &total) -> bool {
+    // two accumulators so consecutive adds do not wait on each other
+    __m256i sums[2] {_mm256_setzero_si256(), _mm256_setzero_si256()};
+    auto overflow = _mm256_setzero_si256();
+    std::size_t i = 0;
+
+    for (; i + 8 <= size; i += 8) {
+        for (int half = 0; half < 2; ++half) {
+            const auto value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i + 4 * half));
+            const auto next = _mm256_add_epi64(sums[half], value);
+
+            overflow = _mm256_or_si256(overflow, _mm256_and_si256(_mm256_xor_si256(sums[half], next),
+                                                                  _mm256_xor_si256(value, next)));
+            sums[half] = next;
+        }
+    }
+    if (_mm256_movemask_pd(_mm256_castsi256_pd(overflow)) != 0) {
+        return false;
+    }
+
+    alignas(32) std::int64_t lanes[8];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), sums[0]);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes + 4), sums[1]);
+
+    std::int64_t rest;
+    if (!sum_ints_scalar(values + i, size - i, rest)
+        || !sum_ints_scalar(lanes, 8, total)
+        || __builtin_add_overflow(total, rest, &total)) {
+        return false;
+    }
+    return true;
+}
+
+__attribute__((target("avx2")))
+static auto sum_reals_avx2(const double *values, std::size_t size) -> double {
+    // two accumulators so consecutive adds do not wait on each other
+    auto even = _mm256_setzero_pd();
+    auto odd = _mm256_setzero_pd();
+    std::size_t i = 0;
+
+    for (; i + 8 <= size; i += 8) {
+        even = _mm256_add_pd(even, _mm256_loadu_pd(values + i));
+        odd = _mm256_add_pd(odd, _mm256_loadu_pd(values + i + 4));
+    }
+
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, _mm256_add_pd(even, odd));
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sum_reals_scalar(values + i, size - i);
+}
+
+__attribute__((target("avx2")))
+static auto dot_reals_avx2(const double *lhs, const double *rhs, std::size_t size) -> double {
+    auto even = _mm256_setzero_pd();
+    auto odd = _mm256_setzero_pd();
+    std::size_t i = 0;
+
+    for (; i + 8 <= size; i += 8) {
+        even = _mm256_add_pd(even, _mm256_mul_pd(_mm256_loadu_pd(lhs + i), _mm256_loadu_pd(rhs + i)));
+        odd = _mm256_add_pd(odd, _mm256_mul_pd(_mm256_loadu_pd(lhs + i + 4), _mm256_loadu_pd(rhs + i + 4)));
+    }
+
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, _mm256_add_pd(even, odd));
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + dot_reals_scalar(lhs + i, rhs + i, size - i);
+}
+#endif
+
+/**
+ * @brief Struct holding the kernel implementations currently in use.
+ */
+struct Kernels final {
+    KernelLevel level;
+    IntsFn add_ints;
+    IntsFn mul_ints;
+    RealsFn add_reals;
+    RealsFn mul_reals;
+    SumIntsFn sum_ints;
+    SumRealsFn sum_reals;
+    DotRealsFn dot_reals;
+};
+
+/**
+ * @brief Return the best level the CPU running us supports.
+ *
+ * @return KernelLevel
+ */
+static auto detect_level() -> KernelLevel {
+#if LISP_KERNEL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return KernelLevel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return KernelLevel::SSE2;
+    }
+#endif
+    return KernelLevel::SCALAR;
+}
+
+/**
+ * @brief Return the implementations for "level".
+ *
+ * @param level
+ * @return Kernels
+ */
+static auto kernels_for(KernelLevel level) -> Kernels {
+    switch (level) {
+#if LISP_KERNEL_X86
+        case KernelLevel::AVX2:
+            return {level, add_ints_avx2, mul_ints_scalar, add_reals_avx2, mul_reals_avx2,
+                    sum_ints_avx2, sum_reals_avx2, dot_reals_avx2};
+
+        case KernelLevel::SSE2:
+            return {level, add_ints_sse2, mul_ints_scalar, add_reals_sse2, mul_reals_sse2,
+                    sum_ints_sse2, sum_reals_sse2, dot_reals_sse2};
+#endif
+        default:
+            return {KernelLevel::SCALAR, add_ints_scalar, mul_ints_scalar, add_reals_scalar,
+                    mul_reals_scalar, sum_ints_scalar, sum_reals_scalar, dot_reals_scalar};
+    }
+}
+
+/**
+ * @brief Return the kernels picked for this CPU, chosen on first use.
+ *
+ * @return Kernels&
+ */
+static auto active() -> Kernels& {
+    static Kernels kernels = kernels_for(detect_level());
+    return kernels;
+}
+
+/**
+ * @brief Store "lhs[i]" + "rhs[i]" in "out[i]" for every i below "size",
+ *        or "lhs[i]" + "rhs[0]" for all of them when "broadcast" is set.
+ *        Returns false if any sum overflowed, in which case "out" holds
+ *        garbage.
+ *
+ * @param lhs
+ * @param rhs
+ * @param out
+ * @param size
+ * @param broadcast
+ * @return bool
+ */
+auto add_ints(const std::int64_t *lhs, const std::int64_t *rhs, std::int64_t *out,
+              std::size_t size, bool broadcast) -> bool {
+    return active().add_ints(lhs, rhs, out, size, broadcast);
+}
+
+/**
+ * @brief Store "lhs[i]" * "rhs[i]" in "out[i]" for every i below "size",
+ *        or "lhs[i]" * "rhs[0]" for all of them when "broadcast" is set.
+ *        Returns false if any product overflowed, in which case "out"
+ *        holds garbage.
+ *
+ * @param lhs
+ * @param rhs
+ * @param out
+ * @param size
+ * @param broadcast
+ * @return bool
+ */
+auto mul_ints(const std::int64_t *lhs, const std::int64_t *rhs, std::int64_t *out,
+              std::size_t size, bool broadcast) -> bool {
+    return active().mul_ints(lhs, rhs, out, size, broadcast);
+}
+
+/**
+ * @brief Store "lhs[i]" + "rhs[i]" in "out[i]" for every i below "size",
+ *        or "lhs[i]" + "rhs[0]" for all of them when "broadcast" is set.
+ *
+ * @param lhs
+ * @param rhs
+ * @param out
+ * @param size
+ * @param broadcast
+ */
+auto add_reals(const double *lhs, const double *rhs, double *out,
+               std::size_t size, bool broadcast) -> void {
+    active().add_reals(lhs, rhs, out, size, broadcast);
+}
+
+/**
+ * @brief Store "lhs[i]" * "rhs[i]" in "out[i]" for every i below "size",
+ *        or "lhs[i]" * "rhs[0]" for all of them when "broadcast" is set.
+ *
+ * @param lhs
+ * @param rhs
+ * @param out
+ * @param size
+ * @param broadcast
+ */
+auto mul_reals(const double *lhs, const double *rhs, double *out,
+               std::size_t size, bool broadcast) -> void {
+    active().mul_reals(lhs, rhs, out, size, broadcast);
+}
+
+/**
+ * @brief Store the sum of the "size" integers at "values" in "total".
+ *        Returns false if the sum might not fit in 64 bits, in which
+ *        case the caller has to add them up the slow way.
+ *
+ * @param values
+ * @param size
+ * @param total
+ * @return bool
+ */
+auto sum_ints(const std::int64_t *values, std::size_t size, std::int64_t &total) -> bool {
+    return active().sum_ints(values, size, total);
+}
+
+/**
+ * @brief Return the sum of the "size" reals at "values". The vector
+ *        kernels add them up in several lanes at once, so the rounding
+ *        can differ from adding them one after the other.
+ *
+ * @param values
+ * @param size
+ * @return double
+ */
+auto sum_reals(const double *values, std::size_t size) -> double {
+    return active().sum_reals(values, size);
+}
+
+/**
+ * @brief Return the sum of "lhs[i]" * "rhs[i]" for every i below "size",
+ *        rounded like sum_reals.
+ *
+ * @param lhs
+ * @param rhs
+ * @param size
+ * @return double
+ */
+auto dot_reals(const double *lhs, const double *rhs, std::size_t size) -> double {
+    return active().dot_reals(lhs, rhs, size);
+}
+
+/**
+ * @brief Return the instruction set the kernels are currently using.
+ *
+ * @return KernelLevel
+ */
+auto kernel_level() -> KernelLevel {
+    return active().level;
+}
+
+/**
+ * @brief Force the kernels to "level", clamped to what the CPU
+ *        supports, and return the level actually picked. Only
+ *        meant for benchmarks comparing implementations.
+ *
+ * @param level
+ * @return KernelLevel
+ */
+auto set_kernel_level(KernelLevel level) -> KernelLevel {
+    const auto best = detect_level();
+    if (static_cast<int>(level) > static_cast<int>(best)) {
+        level = best;
+    }
+    active() = kernels_for(level);
+    return level;
+}
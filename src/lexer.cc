@@ -0,0 +1,175 @@
+#include "../include/lexer.h"
+#include "../include/error.h"
+
+#include <charconv>
+#include <system_error>
+
+/**
+ * @brief Compare the type of "tok" with "type"
+ *        and return an error if they're different,
+ *        at the token. Used for comparing tokens
+ *        and creating the AST.
+ *
+ * @param tok
+ * @param type
+ * @return Result<void>
+ */
+auto expect(const Token &tok, TokenType type) -> Result<void> {
+    static const char *const repr[] {
+        "symbol",
+        "string constant",
+        "number constant",
+        "(",
+        ")",
+        "nothing",
+    };
+
+    const auto i_type = static_cast<int>(type);
+    const auto i_toktype = static_cast<int>(tok.type);
+
+    if (tok.type != type) {
+        // running out of input is only a missing end to whoever can read more
+        const auto code = tok.type == TokenType::THE_END && type == TokenType::RPAREN ? ErrorCode::INCOMPLETE
+                                                                                     : ErrorCode::SYNTAX;
+        return error_at(tok.offset, code, "Expected ", repr[i_type], " but got ", repr[i_toktype]);
+    }
+    return {};
+}
+
+/**
+ * @brief Return the index just past the digits starting at "index" of "text",
+ *        which is "index" itself if there are none.
+ *
+ * @param text
+ * @param index
+ * @return std::size_t
+ */
+static auto skip_digits(const Text &text, std::size_t index) -> std::size_t {
+    while (index < text.size && is_class(text[index], CHAR_DIGIT)) {
+        ++index;
+    }
+    return index;
+}
+
+/**
+ * @brief Take a Text object positioned on a digit or a '-' and return the
+ *        number constant found there. Constants with a fraction or an
+ *        exponent are reals, integers that do not fit in 64 bits are
+ *        handed over as their digits so the parser can make a big integer.
+ *
+ * @param text
+ * @return Result<Token>
+ */
+static auto parse_number(Text &text) -> Result<Token> {
+    const auto start = text.position;
+    const auto sign = text.curr() == '-' ? start + 1 : start;
+
+    auto end = skip_digits(text, sign);
+    if (end == sign) {
+        return error_at(text.origin + start, ErrorCode::SYNTAX, "Invalid number constant!");
+    }
+    bool is_real = false;
+
+    // a fraction or an exponent only counts with digits after it
+    if (end + 1 < text.size && text[end] == '.' && is_class(text[end + 1], CHAR_DIGIT)) {
+        end = skip_digits(text, end + 1);
+        is_real = true;
+    }
+    if (end < text.size && (text[end] == 'e' || text[end] == 'E')) {
+        auto digits = end + 1;
+        if (digits < text.size && (text[digits] == '-' || text[digits] == '+')) {
+            ++digits;
+        }
+        if (digits < text.size && is_class(text[digits], CHAR_DIGIT)) {
+            end = skip_digits(text, digits);
+            is_real = true;
+        }
+    }
+
+    const auto literal = text.substr(end);
+    const auto first = literal.data();
+    const auto last = literal.data() + literal.size();
+    text.position = end;
+
+    if (is_real) {
+        double real = 0.0;
+        if (std::from_chars(first, last, real).ec != std::errc()) {
+            return error_at(text.origin + start, ErrorCode::SYNTAX, "Invalid number constant!");
+        }
+        return Token(TokenType::NUMBER, real, text.origin + start);
+    }
+
+    std::int64_t number = 0;
+    const auto [ptr, ec] = std::from_chars(first, last, number);
+    if (ec == std::errc::result_out_of_range) {
+        return Token(TokenType::NUMBER, literal, text.origin + start);
+    }
+    if (ec != std::errc()) {
+        return error_at(text.origin + start, ErrorCode::SYNTAX, "Invalid number constant!");
+    }
+    return Token(TokenType::NUMBER, number, text.origin + start);
+}
+
+/**
+ * @brief Take a Text object and return the first token found within,
+ *        or THE_END at the end of it, or the error it is instead.
+ *
+ * @param text
+ * @return Result<Token>
+ */
+auto parse_token(Text &text) -> Result<Token> {
+    while (text.position < text.size) {
+        const auto start = text.origin + text.position;
+
+        switch (text.curr()) {
+            case  ' ':
+            case '\n':
+            case '\t':
+                text.position = text.skip_space();
+                break;
+
+            case '#':
+                text.position = text.find_char('\n');
+                break;
+
+            case '(':
+                ++text.position;
+                return Token(TokenType::LPAREN, 0, start);
+
+            case ')':
+                ++text.position;
+                return Token(TokenType::RPAREN, 0, start);
+
+            case '"': {
+                ++text.position;
+
+                auto new_index = text.find_char('"');
+                if (new_index == text.size) {
+                    return error_at(start, ErrorCode::INCOMPLETE, "Unterminated string!");
+                }
+                auto string = text.substr(new_index);
+                text.position = new_index + 1;
+
+                return Token(TokenType::STRING, string, start);
+            }
+
+            default:
+                if (is_class(text.curr(), CHAR_DIGIT) || text.curr() == '-') {
+                    return parse_number(text);
+                }
+                else if (is_class(text.curr(), CHAR_SYMBOL_START)) {
+                    auto new_index = text.find(CHAR_SYMBOL);
+
+                    auto symbol = text.substr(new_index);
+                    text.position = new_index;
+
+                    return Token(TokenType::SYMBOL, symbol, start);
+                }
+                else {
+                    return error_at(start, ErrorCode::SYNTAX, "Failed To Get Next Token!\n");
+                }
+        }
+    }
+
+    return Token(TokenType::THE_END, 0, text.origin + text.size);
+}
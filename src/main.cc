@@ -1,335 +1,164 @@
-#include "../include/token.h"
-#include "../include/text.h"
-#include "../include/node.h"
 #include "../include/data.h"
 #include "../include/error.h"
-#include "../include/builtin.h"
-
-#include <iostream>
+#include "../include/interpreter.h"
+#include "../include/options.h"
+#include "../include/output.h"
+#include "../include/pool.h"
+#include "../include/profile.h"
+#include "../include/stats.h"
+
+#include <cstdlib>
 #include <fstream>
-#include <deque>
-#include <list>
-#include <array>
+#include <iostream>
 #include <string>
-#include <variant>
-#include <functional>
-#include <unordered_map>
-#include <exception>
 
-static auto run_repl() -> void;
-static auto run_file(int argc, char *argv[]) -> void;
-static auto expect(const Token &tok, TokenType type)  -> void;
-static auto read_source(int argc, char *argv[]) -> std::string;
-static auto parse_token(Text &text) -> Token;
-static auto parse_ast(Text &text, bool check_lparen = true) -> Node;
-static auto call_func(std::deque<Data> &args) -> Node;
-static auto eval_node(const Node &node) -> Node;
+static auto run_repl(Interpreter &interpreter, const Options &options) -> void;
+static auto run_file(Interpreter &interpreter, const char *path) -> bool;
+static auto describe(const Error &err, std::string_view name) -> std::string;
+static auto write_profile(const char *path) -> void;
 
-std::unordered_map<std::string, Data> variables;
+int main(int argc, char *argv[]) {
+    // all output goes through Output, so iostreams need not track stdio
+    std::ios::sync_with_stdio(false);
+    const auto options = parse_options(argc, argv);
+    set_task_threads(options.jobs);
 
-/**
- * @brief Global map containing all the built-in functions of the language.
- */
-const std::unordered_map<std::string,
-                         std::function<Node(std::deque<Data>&)>
-                         > built_in_functions {
-    {
-        {"println", builtin_println},
-        {"print", builtin_print},
-        {"eprintln", builtin_eprintln},
-        {"eprint", builtin_eprint},
-        {"concat", builtin_concat},
-        {"to_string", builtin_to_string},
-        {"to_number", builtin_to_number},
-        {"add", builtin_add},
-        {"sub", builtin_sub},
-        {"mul", builtin_mul},
-        {"div", builtin_div},
+    if (options.alloc_stats) {
+        start_counting_allocations();
     }
-};
+    const auto allocations_before = allocation_count();
+    auto status = EXIT_SUCCESS;
 
-int main(int argc, char *argv[]) {
-    if (argc > 1) {
-        run_file(argc, argv);
+    if (options.profile != nullptr) {
+        start_profiling();
     }
-    else {
-        run_repl();
-    }
-
-    return EXIT_SUCCESS;
-}
-
-/**
- * @brief Run a repl and execute commands like a shell.
- */
-static auto run_repl() -> void {
-    Text text;
-    std::string input;
-    Node ast;
-    Data result;
 
-    while (true) {
-        std::cout << "> ";
-        std::getline(std::cin, input);
-        text = Text(input);
-
-        try {
-            ast = parse_ast(text);
-            result = convert_to_data(eval_node(ast));
-        }
-        catch (const Error &err) {
-            std::cerr << "ERROR: " << err.what() << '\n';
-            continue;
+    Interpreter interpreter(Config {
+        options.engine,
+        options.dump_ast,
+        options.jobs > 1,
+        Sinks(),
+        options.cache_dir != nullptr ? options.cache_dir : "",
+    });
+
+    if (options.script != nullptr) {
+        if (!run_file(interpreter, options.script)) {
+            status = EXIT_FAILURE;
         }
-
-        std::cout << "\n==> ";
-        std::visit([](const auto &v){ std::cout << v << '\n'; }, result.value);
     }
-}
-
-/**
- * @brief Execute the code inside of a given file.
- */
-static auto run_file(int argc, char *argv[]) -> void {
-    Text text(read_source(argc, argv));
-    bool first_run = false;
-
-    for (;;) {
-        try {
-            eval_node(parse_ast(text));
-        }
-        catch (const Error &err) {
-            const auto desc = err.what();
+    else {
+        run_repl(interpreter, options);
+    }
 
-            // this is to fix a bug which I am not interested enough
-            // to do so myself because I wish to start over.
-            if (std::string(desc) == "Expected ( got nothing") {
-                first_run = false;
-                continue;
-            }
-            else if (std::string(desc).find("nothing") != std::string::npos && !first_run) {
-                return;
-            }
-            else {
-                std::cerr << "ERROR: " << err.what() << '\n';
-                std::exit(EXIT_FAILURE);
-            }
-        }
+    standard_output().flush();
 
-        if (first_run) {
-            first_run = false;
-        }
+    if (options.profile != nullptr) {
+        write_profile(options.profile);
     }
-}
-
-/**
- * @brief Compare the type of "tok" with "type"
- *        and error if they're different. Used
- *        for comparing tokens and creating the AST.
- *
- * @param tok
- * @param type
- */
-static auto expect(const Token &tok, TokenType type) -> void {
-    static const char *const repr[] {
-        "symbol",
-        "string constant",
-        "number constant",
-        "(",
-        ")",
-        "nothing",
-    };
 
-    const auto i_type = static_cast<int>(type);
-    const auto i_toktype = static_cast<int>(tok.type);
+    if (options.alloc_stats) {
+        const auto allocations = allocation_count() - allocations_before;
+        const auto evaluated = interpreter.forms_evaluated();
+        const auto forms = evaluated == 0 ? 1 : evaluated;
 
-    if (tok.type != type) {
-        quit("Expected ", repr[i_type], " but got ", repr[i_toktype]);
+        std::cerr << "allocations: " << allocations
+                  << ", forms: " << evaluated
+                  << ", per form: " << static_cast<double>(allocations) / forms << '\n';
     }
-}
 
-/**
- * @brief Take the command line arguments from main
- *        and return the contents of the file of argv[1]
- *        which would be the file containing the script.
- *
- * @param argc
- * @param argv
- * @return std::string
- */
-static auto read_source(int argc, char *argv[]) -> std::string {
-    if (argc != 2) {
-        std::cerr << "Usage: ./lisp <script.lisp>\n";
-        std::exit(EXIT_SUCCESS);
-    }
-    std::ifstream fp(argv[1]);
-    return std::string((std::istreambuf_iterator<char>(fp)),
-                       (std::istreambuf_iterator<char>()));
+    return status;
 }
 
 /**
- * @brief Take a Text object and return the first token found within.
+ * @brief Run a repl and execute commands like a shell. A form
+ *        left open at the end of a line goes on on the next one.
  *
- * @param text
- * @return Token
+ * @param interpreter
+ * @param options
  */
-static auto parse_token(Text &text) -> Token {
-    while (text.position < text.size) {
-        switch (text.curr()) {
-            case  ' ':
-            case '\n':
-            case '\t':
-                ++text.position;
-                break;
-
-            case '#':
-                while (text.curr() != '\n') {
-                    ++text.position;
-                }
-                break;
-
-            case '(':
-                ++text.position;
-                return Token(TokenType::LPAREN, 0);
+static auto run_repl(Interpreter &interpreter, const Options &options) -> void {
+    std::string input;
+    std::string line;
 
-            case ')':
-                ++text.position;
-                return Token(TokenType::RPAREN, 0);
+    auto &output = standard_output();
 
-            case '"': {
-                ++text.position;
+    while (true) {
+        output.write(input.empty() ? "> " : ". ");
+        output.flush();
+        if (!std::getline(std::cin, line)) {
+            output.write('\n');
+            return;
+        }
+        input += line;
 
-                auto new_index = text.find([](char c){ return c != '"'; });
-                auto string = text.substr(new_index);
-                text.position = new_index + 1;
+        // bad input is common here, so errors are handed back rather than thrown
+        auto result = interpreter.try_eval(input);
 
-                return Token(TokenType::STRING, string);
+        if (!result.ok()) {
+            if (result.error().code() == ErrorCode::INCOMPLETE) {
+                input += '\n';
+                continue;
             }
-
-            default:
-                if (std::isdigit(text.curr()) || text.curr() == '-') {
-                    bool is_minus = false;
-
-                    if (text.curr() == '-') {
-                        is_minus = true;
-                        text.position += 1;
-                    }
-
-                    auto new_index = text.find([](char c){ return std::isdigit(c); });
-                    auto number = std::stoi(text.substr(new_index));
-                    text.position = new_index;
-
-                    return Token(TokenType::NUMBER, is_minus ? -number : number);
-                }
-                else if (std::isalpha(text.curr()) || text.curr() == '_') {
-                    auto new_index = text.find(
-                        [](char c){ return std::isalnum(c) || c == '_'; });
-
-                    auto symbol = text.substr(new_index);
-                    text.position = new_index;
-
-                    return Token(TokenType::SYMBOL, symbol);
-                }
-                else {
-                    quit("Failed To Get Next Token!\n");
-                }
+            write_error(describe(result.error(), "<stdin>"));
+        }
+        else if (!options.dump_ast) {
+            output.write("\n==> ");
+            output.write(result.value());
+            output.write('\n');
         }
+        input.clear();
     }
-
-    // never runs, used just to silence compiler warnings
-    return Token(); // THE_END, 0
 }
 
 /**
- * @brief Convert a series of tokens into an abstract syntax tree.
+ * @brief Execute the code inside of a given file, or of stdin if "path" is "-",
+ *        and stop on the first error. Returns false if there was one.
  *
- * @param text
- * @return Node
+ * @param interpreter
+ * @param path
+ * @return bool
  */
-static auto parse_ast(Text &text, bool check_lparen) -> Node {
-    std::list<Node> elements;
-    Token curr_tok;
-
-    if (check_lparen) {
-        expect(parse_token(text), TokenType::LPAREN);
+static auto run_file(Interpreter &interpreter, const char *path) -> bool {
+    try {
+        interpreter.run_file(path);
+        return true;
     }
-
-    curr_tok = parse_token(text);
-    while (curr_tok.type != TokenType::RPAREN) {
-        switch (curr_tok.type) {
-            case TokenType::NUMBER:
-                elements.emplace_back(Node(NodeType::NUM_CONSTANT,
-                                           std::get<int>(curr_tok.value)));
-                break;
-
-            case TokenType::STRING:
-                elements.emplace_back(Node(NodeType::STR_CONSTANT,
-                                           std::get<std::string>(curr_tok.value)));
-                break;
-
-            case TokenType::SYMBOL:
-                elements.emplace_back(Node(NodeType::SYM_CONSTANT,
-                                           std::get<std::string>(curr_tok.value)));
-                break;
-
-            case TokenType::LPAREN:
-                elements.emplace_back(parse_ast(text, false));
-                break;
-
-            default:
-                quit("Unterminated list!");
-        }
-
-        curr_tok = parse_token(text);
+    catch (const Error &err) {
+        write_error(describe(err, std::string_view(path) == "-" ? "<stdin>" : path));
+        return false;
     }
-
-    expect(curr_tok, TokenType::RPAREN);
-    return Node(NodeType::LIST_CONSTANT, elements);
 }
 
 /**
- * @brief Take function/list as a deque of Data and call it using the global "functions" map.
+ * @brief Return the message of "err", led by "name" and the
+ *        line and column it happened at when they are known.
  *
- * @param args
- * @return Node
+ * @param err
+ * @param name
+ * @return std::string
  */
-static auto call_func(std::deque<Data> &args) -> Node {
-    Node return_value;
-    const auto func_name = std::get<std::string>(args[0].value);
-
-    // remove function name from args
-    args.pop_front();
-
-    if (built_in_functions.contains(func_name)) {
-        return_value = built_in_functions.at(func_name)(args);
+static auto describe(const Error &err, std::string_view name) -> std::string {
+    if (err.line() == 0) {
+        return err.what();
     }
-    else {
-        quit("Tried to call an unknown function and failed!");
-    }
-
-    return return_value; // return 0 by default
+    return std::string(name) + ':' + std::to_string(err.line()) + ':'
+         + std::to_string(err.column()) + ": " + err.what();
 }
 
 /**
- * @brief Evaluate a node and slowly collapse an abstract syntax tree into a single node.
+ * @brief Write the stacks recorded by the profiler to "path" as collapsed
+ *        stacks, ready for a flame graph, and a summary to standard error.
  *
- * @param node
- * @return Node
+ * @param path
  */
-static auto eval_node(const Node &node) -> Node {
-    switch (node.type) {
-        case NodeType::LIST_CONSTANT: {
-            std::deque<Data> args;
-            const auto body = std::get<std::list<Node>>(node.exp);
-
-            for (const auto &param : body) {
-                args.emplace_back(convert_to_data(eval_node(param)));
-            }
+static auto write_profile(const char *path) -> void {
+    std::ofstream file(path);
 
-            return call_func(args);
-        }
-
-        default:
-            return node;
+    if (!file) {
+        std::cerr << "Could not write the profile to " << path << '\n';
+    }
+    else {
+        write_collapsed_stacks(file);
     }
+    write_profile_summary(std::cerr);
 }
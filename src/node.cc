@@ -5,5 +5,6 @@
  *
  */
 Node::Node()
-    : type(NodeType::NUM_CONSTANT), exp(0) {
+    : type(NodeType::NUM_CONSTANT), form(Form::CALL), binding(Binding::GLOBAL),
+      size(0), first(0), depth(0), slot(0), number(0) {
 }
@@ -0,0 +1,190 @@
+#include "../include/number.h"
+#include "../include/error.h"
+#include "../include/ref.h"
+
+#include <charconv>
+#include <iterator>
+#include <limits>
+
+/**
+ * @brief Return the number "data" as a real, rounding integers that are
+ *        too precise for one.
+ *
+ * @param data
+ * @return double
+ */
+static auto to_real(const Data &data) -> double {
+    switch (data.type) {
+        case DataType::NUMBER:
+            return static_cast<double>(data.number);
+
+        case DataType::BIGNUM:
+            return data.bignum->to_double();
+
+        default:
+            return data.real;
+    }
+}
+
+/**
+ * @brief Return the integer "data" as a big integer with one reference.
+ *
+ * @param data
+ * @return Ref<BigInt>
+ */
+static auto to_big(const Data &data) -> Ref<BigInt> {
+    if (data.type == DataType::BIGNUM) {
+        return Ref<BigInt>::share(data.bignum);
+    }
+    return Ref<BigInt>(BigInt::from_int(data.number));
+}
+
+/**
+ * @brief Return whether the number "data" is zero. Big integers never
+ *        are, since they are turned back into numbers whenever they fit.
+ *
+ * @param data
+ * @return bool
+ */
+static auto is_zero(const Data &data) -> bool {
+    return (data.type == DataType::NUMBER && data.number == 0)
+        || (data.type == DataType::REAL && data.real == 0.0);
+}
+
+/**
+ * @brief Return the result of "op" on two numbers of any kind, erroring
+ *        if either is not a number. Integers that overflow become big
+ *        integers, big integers that fit again become numbers, and as
+ *        soon as a real is involved the result is a real. Division of
+ *        integers rounds towards zero and errors on a zero divisor.
+ *
+ * @param op
+ * @param lhs
+ * @param rhs
+ * @return Data
+ */
+auto apply_numeric(BinaryOp op, const Data &lhs, const Data &rhs) -> Data {
+    if (!lhs.is_numeric()) {
+        return lhs.reject("number");
+    }
+    if (!rhs.is_numeric()) {
+        return rhs.reject("number");
+    }
+
+    switch (op) {
+        case BinaryOp::LT:
+            return Data::from_number(compare_numbers(lhs, rhs) < 0);
+
+        case BinaryOp::GT:
+            return Data::from_number(compare_numbers(lhs, rhs) > 0);
+
+        case BinaryOp::EQ:
+            return Data::from_number(compare_numbers(lhs, rhs) == 0);
+
+        case BinaryOp::DIV:
+            if (is_zero(rhs)) {
+                return fail(ErrorCode::VALUE, "Division by zero in (div x y ...)");
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    if (lhs.type == DataType::REAL || rhs.type == DataType::REAL) {
+        return real_binary(op, to_real(lhs), to_real(rhs));
+    }
+
+    if (lhs.type == DataType::NUMBER && rhs.type == DataType::NUMBER) {
+        std::int64_t result;
+
+        if (op != BinaryOp::DIV && int_binary(op, lhs.number, rhs.number, result)) {
+            return Data::from_number(result);
+        }
+        // the one quotient of two numbers that is not a number
+        if (op == BinaryOp::DIV
+            && (lhs.number != std::numeric_limits<std::int64_t>::min() || rhs.number != -1)) {
+            return Data::from_number(lhs.number / rhs.number);
+        }
+    }
+
+    const auto left = to_big(lhs);
+    const auto right = to_big(rhs);
+
+    switch (op) {
+        case BinaryOp::ADD:
+            return Data::from_bignum(big_add(*left, *right));
+
+        case BinaryOp::SUB:
+            return Data::from_bignum(big_sub(*left, *right));
+
+        case BinaryOp::MUL:
+            return Data::from_bignum(big_mul(*left, *right));
+
+        default:
+            return Data::from_bignum(big_div(*left, *right));
+    }
+}
+
+/**
+ * @brief Return "total" combined with each of "rest" in turn by "op",
+ *        for the built-ins taking any number of arguments once their
+ *        64 bit loop has run into something it cannot handle.
+ *
+ * @param op
+ * @param total
+ * @param rest
+ * @return Data
+ */
+auto fold_numeric(BinaryOp op, Data total, Args rest) -> Data {
+    for (const auto &arg : rest) {
+        total = apply_numeric(op, total, arg);
+    }
+    return total;
+}
+
+/**
+ * @brief Return how the numbers "lhs" and "rhs" are ordered,
+ *        unordered if either is a real that is not a number.
+ *
+ * @param lhs
+ * @param rhs
+ * @return std::partial_ordering
+ */
+auto compare_numbers(const Data &lhs, const Data &rhs) -> std::partial_ordering {
+    if (lhs.type == DataType::NUMBER && rhs.type == DataType::NUMBER) {
+        return lhs.number <=> rhs.number;
+    }
+    if (lhs.type == DataType::REAL || rhs.type == DataType::REAL) {
+        return to_real(lhs) <=> to_real(rhs);
+    }
+    if (lhs.type == DataType::BIGNUM && rhs.type == DataType::BIGNUM) {
+        return big_compare(*lhs.bignum, *rhs.bignum) <=> 0;
+    }
+
+    // a big integer lies beyond every number on the side of its sign
+    if (lhs.type == DataType::BIGNUM) {
+        return lhs.bignum->negative ? std::partial_ordering::less
+                                    : std::partial_ordering::greater;
+    }
+    return rhs.bignum->negative ? std::partial_ordering::greater
+                                : std::partial_ordering::less;
+}
+
+/**
+ * @brief Return the shortest text that reads back as "real",
+ *        with a ".0" added to whole values so they still look like reals.
+ *
+ * @param real
+ * @return std::string
+ */
+auto format_real(double real) -> std::string {
+    char digits[32];
+    const auto [end, ec] = std::to_chars(std::begin(digits), std::end(digits), real);
+
+    std::string text(digits, end);
+    if (text.find_first_not_of("-0123456789") == std::string::npos) {
+        text += ".0";
+    }
+    return text;
+}
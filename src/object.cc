@@ -0,0 +1,231 @@
+#include "../include/object.h"
+#include "../include/arena.h"
+#include "../include/env.h"
+#include "../include/function.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+/**
+ * @brief Allocate a string holding a copy of "text" with one reference.
+ *
+ * @param text
+ * @return String*
+ */
+auto String::make(std::string_view text) -> String* {
+    auto string = String::make(text.size());
+    std::memcpy(string->chars(), text.data(), text.size());
+    return string;
+}
+
+/**
+ * @brief Allocate a string of "size" uninitialised characters with one
+ *        reference, for callers that fill it in place.
+ *
+ * @param size
+ * @return String*
+ */
+auto String::make(std::size_t size) -> String* {
+    auto memory = ::operator new(sizeof(String) + size + 1);
+    auto string = new (memory) String;
+
+    string->refs = 1;
+    string->size = size;
+    string->chars()[size] = '\0';
+    return string;
+}
+
+/**
+ * @brief Allocate a pinned string of "size" uninitialised characters
+ *        inside of "arena", for temporaries that die with the form.
+ *
+ * @param size
+ * @param arena
+ * @return String*
+ */
+auto String::make(std::size_t size, Arena &arena) -> String* {
+    auto memory = arena.allocate(sizeof(String) + size + 1, alignof(String));
+    auto string = new (memory) String;
+
+    string->refs = PINNED;
+    string->size = size;
+    string->chars()[size] = '\0';
+    return string;
+}
+
+/**
+ * @brief Free "string" once nothing refers to it anymore.
+ *
+ * @param string
+ */
+auto String::destroy(String *string) -> void {
+    string->~String();
+    ::operator delete(string);
+}
+
+/**
+ * @brief Allocate a closure over "function" and "env" with one
+ *        reference, taking a reference to both of them.
+ *
+ * @param function
+ * @param env
+ * @return Closure*
+ */
+auto Closure::make(Function *function, Env *env) -> Closure* {
+    auto closure = new Closure;
+
+    closure->refs = 1;
+    closure->function = function;
+    closure->env = env;
+
+    function->retain();
+    if (env != nullptr) {
+        env->retain();
+    }
+    return closure;
+}
+
+/**
+ * @brief Free "closure" once nothing refers to it anymore.
+ *
+ * @param closure
+ */
+auto Closure::destroy(Closure *closure) -> void {
+    closure->function->release();
+    if (closure->env != nullptr) {
+        closure->env->release();
+    }
+    delete closure;
+}
+
+/**
+ * @brief Allocate a rope over "parts" with one reference, taking
+ *        over the references they hold.
+ *
+ * @param parts
+ * @return Rope*
+ */
+auto Rope::make(std::vector<RopePart> parts) -> Rope* {
+    auto rope = new Rope;
+
+    rope->refs = 1;
+    rope->size = 0;
+    rope->flat = nullptr;
+    for (const auto &part : parts) {
+        rope->size += part.string != nullptr ? part.string->size : part.rope->size;
+    }
+    rope->parts = std::move(parts);
+    return rope;
+}
+
+/**
+ * @brief Return the text of the rope in one piece, copying the parts
+ *        together the first time and dropping them afterwards. Once
+ *        values are shared between threads the copy is made under a
+ *        lock and the parts are kept, since another thread may be
+ *        walking them to print the rope.
+ *
+ * @return std::string_view
+ */
+auto Rope::view() const -> std::string_view {
+    if (const auto flat = this->flat_text(); flat != nullptr) {
+        return flat->view();
+    }
+
+    const auto join = [this] {
+        auto flat = String::make(this->size);
+        auto out = flat->chars();
+
+        this->for_each_piece([&](std::string_view piece) {
+            out = std::copy(piece.begin(), piece.end(), out);
+        });
+        return flat;
+    };
+
+    if (threads_share_values.load(std::memory_order_relaxed)) {
+        static std::mutex lock;
+        const std::lock_guard guard(lock);
+
+        if (this->flat == nullptr) {
+            std::atomic_ref<String*>(this->flat).store(join(), std::memory_order_release);
+        }
+        return this->flat->view();
+    }
+
+    this->flat = join();
+
+    // the parts are only needed to build the text, so let them go
+    auto parts = std::move(this->parts);
+    this->parts.clear();
+
+    for (const auto &part : parts) {
+        if (part.string != nullptr) {
+            part.string->release();
+        }
+        else {
+            part.rope->release();
+        }
+    }
+    return this->flat->view();
+}
+
+/**
+ * @brief Free "rope" once nothing refers to it anymore, along with
+ *        every part only it referred to. Runs without recursing.
+ *
+ * @param rope
+ */
+auto Rope::destroy(Rope *rope) -> void {
+    std::vector<Rope*> dead {rope};
+
+    while (!dead.empty()) {
+        const auto current = dead.back();
+        dead.pop_back();
+
+        for (const auto &part : current->parts) {
+            if (part.string != nullptr) {
+                part.string->release();
+            }
+            else if (count_down(part.rope->refs)) {
+                dead.push_back(part.rope);
+            }
+        }
+        if (current->flat != nullptr) {
+            current->flat->release();
+        }
+        delete current;
+    }
+}
+
+/**
+ * @brief Allocate a vector of "size" uninitialised elements of "kind"
+ *        with one reference, for callers that fill it in place.
+ *
+ * @param kind
+ * @param size
+ * @return Vector*
+ */
+auto Vector::make(VectorKind kind, std::size_t size) -> Vector* {
+    static_assert(sizeof(std::int64_t) == sizeof(double));
+
+    auto memory = ::operator new(sizeof(Vector) + size * sizeof(std::int64_t),
+                                 std::align_val_t(alignof(Vector)));
+    auto vector = new (memory) Vector;
+
+    vector->refs = 1;
+    vector->kind = kind;
+    vector->size = size;
+    return vector;
+}
+
+/**
+ * @brief Free "vector" once nothing refers to it anymore.
+ *
+ * @param vector
+ */
+auto Vector::destroy(Vector *vector) -> void {
+    vector->~Vector();
+    ::operator delete(vector, std::align_val_t(alignof(Vector)));
+}
@@ -0,0 +1,197 @@
+#include "../include/optimize.h"
+#include "../include/builtin.h"
+#include "../include/data.h"
+#include "../include/error.h"
+
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Return whether "node" is a constant of any numeric type.
+ *
+ * @param node
+ * @return bool
+ */
+static auto is_numeric_constant(const Node &node) -> bool {
+    return node.type == NodeType::NUM_CONSTANT || node.type == NodeType::REAL_CONSTANT
+        || node.type == NodeType::BIG_CONSTANT;
+}
+
+/**
+ * @brief Return whether "node" is a number or string constant.
+ *
+ * @param node
+ * @return bool
+ */
+static auto is_constant(const Node &node) -> bool {
+    return is_numeric_constant(node) || node.type == NodeType::STR_CONSTANT;
+}
+
+/**
+ * @brief Call "fn" on the constants "ids" and store the result in "result".
+ *        Returns false, leaving "result" alone, if the call fails or gives
+ *        back something that can't be written as a constant.
+ *
+ * @param ast
+ * @param fn
+ * @param ids
+ * @param result
+ * @return bool
+ */
+static auto try_call(const Ast &ast, BuiltinFn fn, std::span<const NodeId> ids, Data &result) -> bool {
+    std::vector<Data> args;
+    args.reserve(ids.size());
+
+    for (const auto id : ids) {
+        args.push_back(convert_to_data(ast, id));
+    }
+
+    auto value = fn(Args(args));
+    if (raised_error != nullptr) {
+        take_raised_error();
+        return false;
+    }
+    result = std::move(value);
+    return result.is_numeric() || result.is_string();
+}
+
+/**
+ * @brief Append a constant node holding "value" and return its index.
+ *
+ * @param ast
+ * @param value
+ * @return NodeId
+ */
+static auto add_constant(Ast &ast, const Data &value) -> NodeId {
+    switch (value.type) {
+        case DataType::NUMBER:
+            return ast.add_number(value.number);
+
+        case DataType::REAL:
+            return ast.add_real(value.real);
+
+        case DataType::BIGNUM:
+            return ast.add_bignum(value.bignum->to_string(), value.bignum);
+
+        default:
+            return ast.add_string(value.as_string());
+    }
+}
+
+/**
+ * @brief Combine the constant arguments of the call "id" that can be merged
+ *        without changing its result: the numbers leading the arguments of
+ *        add and mul, and each run of neighbouring strings for concat. Only
+ *        leading numbers are merged since those are combined first anyway,
+ *        while moving later ones would change the rounding of reals.
+ *
+ * @param ast
+ * @param id
+ */
+static auto fold_partial(Ast &ast, NodeId id) -> void {
+    const auto fn = ast.nodes[id].callee;
+    const auto body = ast.children_of(id);
+
+    // copy the arguments out since the rewritten list replaces them in place
+    const std::vector<NodeId> args(body.begin() + 1, body.end());
+    std::vector<NodeId> folded {body.front()};
+
+    if (fn == builtin_add || fn == builtin_mul) {
+        std::size_t prefix = 0;
+        while (prefix < args.size() && is_numeric_constant(ast.nodes[args[prefix]])) {
+            ++prefix;
+        }
+
+        for (const auto arg : args) {
+            if (ast.nodes[arg].type == NodeType::STR_CONSTANT) {
+                return;
+            }
+        }
+
+        Data value;
+        if (prefix < 2 || !try_call(ast, fn, std::span(args).first(prefix), value)) {
+            return;
+        }
+        folded.push_back(add_constant(ast, value));
+        folded.insert(folded.end(), args.begin() + static_cast<std::ptrdiff_t>(prefix), args.end());
+    }
+    else if (fn == builtin_concat) {
+        for (std::size_t i = 0; i < args.size();) {
+            std::size_t run = i;
+            while (run < args.size() && ast.nodes[args[run]].type == NodeType::STR_CONSTANT) {
+                ++run;
+            }
+
+            Data value;
+            if (run - i >= 2 && try_call(ast, fn, std::span(args).subspan(i, run - i), value)) {
+                folded.push_back(add_constant(ast, value));
+                i = run;
+            }
+            else {
+                folded.push_back(args[i]);
+                ++i;
+            }
+        }
+    }
+    else {
+        return;
+    }
+
+    if (folded.size() == body.size()) {
+        return;
+    }
+
+    auto &node = ast.nodes[id];
+    std::copy(folded.begin(), folded.end(), ast.children.begin() + node.first);
+    node.size = static_cast<std::uint32_t>(folded.size());
+}
+
+/**
+ * @brief Fold the subtree rooted at "id" bottom up.
+ *
+ * @param ast
+ * @param id
+ */
+static auto fold_node(Ast &ast, NodeId id) -> void {
+    if (ast.nodes[id].type != NodeType::LIST_CONSTANT) {
+        return;
+    }
+
+    bool all_constant = true;
+    const auto body = ast.children_of(id);
+
+    for (std::size_t i = 0; i < body.size(); ++i) {
+        fold_node(ast, body[i]);
+        all_constant &= i == 0 || is_constant(ast.nodes[body[i]]);
+    }
+
+    const auto fn = ast.nodes[id].callee;
+    if (fn == nullptr || !is_pure_builtin(fn)) {
+        return;
+    }
+
+    Data value;
+    if (!all_constant || !try_call(ast, fn, body.subspan(1), value)) {
+        fold_partial(ast, id);
+        return;
+    }
+
+    const auto constant = ast.nodes[add_constant(ast, value)];
+    ast.nodes[id] = constant;
+}
+
+/**
+ * @brief Rewrite the tree under "root" so that calls to pure built-ins
+ *        whose arguments are all constants become the constant they
+ *        evaluate to. Constant subtrees are folded wherever they appear,
+ *        including inside calls that can't be folded themselves, and the
+ *        constant arguments of add, mul and concat are combined even when
+ *        other arguments are not constant. Calls that would fail are left
+ *        alone so the error still happens when the form runs.
+ *
+ * @param ast
+ * @param root
+ */
+auto fold_constants(Ast &ast, NodeId root) -> void {
+    fold_node(ast, root);
+}
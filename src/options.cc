@@ -0,0 +1,98 @@
+#include "../include/options.h"
+
+#include <charconv>
+#include <iostream>
+#include <string_view>
+#include <cstdlib>
+
+/**
+ * @brief Print how the interpreter is meant to be invoked and exit.
+ *
+ * @param status
+ */
+[[noreturn]] static auto usage(int status) -> void {
+    std::cerr << "Usage: ./lisp [--engine=tree|vm] [--alloc-stats] [--dump-ast] [--jobs N]\n               [--cache-dir DIR] [--profile[=FILE]] [script.lisp | -]\n";
+    std::exit(status);
+}
+
+/**
+ * @brief Return the thread count "text", which must be a whole number
+ *        between 1 and 256, printing the usage and exiting otherwise.
+ *
+ * @param text
+ * @return std::size_t
+ */
+static auto parse_jobs(std::string_view text) -> std::size_t {
+    std::size_t jobs = 0;
+    const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), jobs);
+
+    if (ec != std::errc() || end != text.data() + text.size() || jobs == 0 || jobs > 256) {
+        usage(EXIT_FAILURE);
+    }
+    return jobs;
+}
+
+/**
+ * @brief Construct a new Options object.
+ */
+Options::Options()
+    : engine(Engine::TREE), script(nullptr), cache_dir(nullptr), profile(nullptr), alloc_stats(false), dump_ast(false), jobs(0) {
+}
+
+/**
+ * @brief Take the command line arguments from main and turn them into
+ *        Options. Prints the usage and exits on anything unrecognised.
+ *
+ * @param argc
+ * @param argv
+ * @return Options
+ */
+auto parse_options(int argc, char *argv[]) -> Options {
+    Options options;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+
+        if (arg == "--engine=tree") {
+            options.engine = Engine::TREE;
+        }
+        else if (arg == "--engine=vm") {
+            options.engine = Engine::VM;
+        }
+        else if (arg == "--alloc-stats") {
+            options.alloc_stats = true;
+        }
+        else if (arg == "--dump-ast") {
+            options.dump_ast = true;
+        }
+        else if (arg == "--jobs" && i + 1 < argc) {
+            options.jobs = parse_jobs(argv[++i]);
+        }
+        else if (arg.starts_with("--jobs=")) {
+            options.jobs = parse_jobs(arg.substr(7));
+        }
+        else if (arg == "--cache-dir" && i + 1 < argc) {
+            options.cache_dir = argv[++i];
+        }
+        else if (arg.starts_with("--cache-dir=")) {
+            options.cache_dir = argv[i] + 12;
+        }
+        else if (arg == "--profile") {
+            options.profile = "profile.folded";
+        }
+        else if (arg.starts_with("--profile=")) {
+            options.profile = argv[i] + 10;
+        }
+        else if (arg == "--help") {
+            usage(EXIT_SUCCESS);
+        }
+        else if (arg.starts_with("--") || options.script != nullptr) {
+            usage(EXIT_FAILURE);
+        }
+        else {
+            options.script = argv[i];
+        }
+    }
+
+    return options;
+}
@@ -0,0 +1,282 @@
+#include "../include/output.h"
+#include "../include/number.h"
+
+#include <cerrno>
+#include <charconv>
+#include <iterator>
+#include <sstream>
+#include <unistd.h>
+
+/**
+ * @brief Write all of [data, data + size) to "fd", retrying short writes
+ *        and interrupted calls. Output that can't be written (a closed
+ *        pipe, a full disk) is dropped, as nothing could be done about it.
+ *
+ * @param fd
+ * @param data
+ * @param size
+ */
+static auto write_all(int fd, const char *data, std::size_t size) -> void {
+    while (size != 0) {
+        const auto written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+}
+
+/**
+ * @brief Where the calling thread records what it flushes, or null
+ *        when it writes straight to the file descriptors.
+ */
+static thread_local Transcript *recording = nullptr;
+
+/**
+ * @brief Where the calling thread sends what it flushes, or null
+ *        when it writes to the file descriptors.
+ */
+static thread_local const Sinks *sinks = nullptr;
+
+/**
+ * @brief Write [data, data + size) to "fd", or to the sink standing in
+ *        for it, or record it if the calling thread is recording its output.
+ *
+ * @param fd
+ * @param data
+ * @param size
+ */
+static auto emit(int fd, const char *data, std::size_t size) -> void {
+    if (recording != nullptr) {
+        recording->append(fd, std::string_view(data, size));
+        return;
+    }
+    if (sinks != nullptr && size != 0) {
+        const auto &sink = fd == STDERR_FILENO ? sinks->err : sinks->out;
+        if (sink) {
+            sink(std::string_view(data, size));
+            return;
+        }
+    }
+    write_all(fd, data, size);
+}
+
+/**
+ * @brief Add "text" flushed to "fd" after everything recorded so far.
+ *
+ * @param fd
+ * @param text
+ */
+auto Transcript::append(int fd, std::string_view text) -> void {
+    if (text.empty()) {
+        return;
+    }
+    if (this->pieces.empty() || this->pieces.back().fd != fd) {
+        this->pieces.push_back(Piece {fd, std::string()});
+    }
+    this->pieces.back().text.append(text);
+}
+
+/**
+ * @brief Flush everything recorded again, in order, from the calling
+ *        thread, so it goes wherever that thread's output goes now.
+ */
+auto Transcript::replay() const -> void {
+    for (const auto &piece : this->pieces) {
+        emit(piece.fd, piece.text.data(), piece.text.size());
+    }
+}
+
+/**
+ * @brief Construct a new Output object writing to "fd".
+ *
+ * @param fd
+ */
+Output::Output(int fd)
+    : fd(fd), used(0), buffer(new char[CAPACITY]) {
+}
+
+/**
+ * @brief Destroy the Output object, flushing what is left.
+ */
+Output::~Output() {
+    this->flush();
+}
+
+/**
+ * @brief Append "text". Text larger than the buffer is written directly.
+ *
+ * @param text
+ */
+auto Output::write(std::string_view text) -> void {
+    if (text.size() > CAPACITY - this->used) {
+        this->flush();
+
+        if (text.size() >= CAPACITY) {
+            emit(this->fd, text.data(), text.size());
+            return;
+        }
+    }
+    std::copy(text.begin(), text.end(), this->buffer.get() + this->used);
+    this->used += text.size();
+}
+
+/**
+ * @brief Append "number" in decimal.
+ *
+ * @param number
+ */
+auto Output::write(std::int64_t number) -> void {
+    char digits[24];
+    const auto [end, ec] = std::to_chars(std::begin(digits), std::end(digits), number);
+    this->write(std::string_view(digits, static_cast<std::size_t>(end - digits)));
+}
+
+/**
+ * @brief Append "data" the way print shows it.
+ *
+ * @param data
+ */
+auto Output::write(const Data &data) -> void {
+    switch (data.type) {
+        case DataType::NUMBER:
+            return this->write(data.number);
+
+        case DataType::STRING:
+            return this->write(data.string->view());
+
+        case DataType::ROPE:
+            return data.rope->for_each_piece([this](std::string_view piece) {
+                this->write(piece);
+            });
+
+        case DataType::SYMBOL:
+            return this->write(symbol_name(data.symbol));
+
+        case DataType::REAL:
+            return this->write(std::string_view(format_real(data.real)));
+
+        case DataType::VECTOR: {
+            const auto &vector = *data.vector;
+
+            this->write('[');
+            for (std::size_t i = 0; i < vector.size; ++i) {
+                if (i != 0) {
+                    this->write(' ');
+                }
+                if (vector.kind == VectorKind::INTS) {
+                    this->write(vector.ints()[i]);
+                }
+                else {
+                    this->write(std::string_view(format_real(vector.reals()[i])));
+                }
+            }
+            return this->write(']');
+        }
+
+        default: {
+            // big integers and functions are rare enough to go through iostreams
+            std::ostringstream text;
+            text << data;
+            return this->write(std::string_view(text.view()));
+        }
+    }
+}
+
+/**
+ * @brief Hand everything buffered so far to the kernel.
+ */
+auto Output::flush() -> void {
+    emit(this->fd, this->buffer.get(), this->used);
+    this->used = 0;
+}
+
+/**
+ * @brief Return the buffered writer for standard output. Each thread
+ *        has its own, so output is only ever split where it is flushed.
+ *
+ * @return Output&
+ */
+auto standard_output() -> Output& {
+    static thread_local Output output(STDOUT_FILENO);
+    return output;
+}
+
+/**
+ * @brief Return the buffered writer for standard error. Whoever writes
+ *        to it flushes it straight away, after flushing standard output
+ *        so the two streams stay in order on a terminal.
+ *
+ * @return Output&
+ */
+auto standard_error() -> Output& {
+    static thread_local Output output(STDERR_FILENO);
+    return output;
+}
+
+/**
+ * @brief Report "message" as an error on standard error.
+ *
+ * @param message
+ */
+auto write_error(std::string_view message) -> void {
+    auto &error = standard_error();
+
+    standard_output().flush();
+    error.write("ERROR: ");
+    error.write(message);
+    error.write('\n');
+    error.flush();
+}
+
+/**
+ * @brief Construct a new Recording object recording
+ *        what the calling thread flushes in "transcript".
+ *
+ * @param transcript
+ */
+Recording::Recording(Transcript *transcript)
+    : previous(recording) {
+    standard_output().flush();
+    standard_error().flush();
+    recording = transcript;
+}
+
+/**
+ * @brief Destroy the Recording object, flushing what is left
+ *        into it and going back to what the thread did before.
+ */
+Recording::~Recording() {
+    standard_output().flush();
+    standard_error().flush();
+    recording = this->previous;
+}
+
+/**
+ * @brief Construct a new Redirect object sending what
+ *        the calling thread flushes to "sinks".
+ *
+ * @param sinks
+ */
+Redirect::Redirect(const Sinks &sinks)
+    : previous_sinks(::sinks), previous_recording(recording) {
+    standard_output().flush();
+    standard_error().flush();
+    ::sinks = &sinks;
+    recording = nullptr;
+}
+
+/**
+ * @brief Destroy the Redirect object, flushing what is left
+ *        into the sinks and going back to what the thread did before.
+ */
+Redirect::~Redirect() {
+    standard_output().flush();
+    standard_error().flush();
+    sinks = this->previous_sinks;
+    recording = this->previous_recording;
+}
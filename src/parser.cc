@@ -0,0 +1,102 @@
+#include "../include/parser.h"
+#include "../include/bignum.h"
+#include "../include/builtin.h"
+#include "../include/error.h"
+#include "../include/lexer.h"
+#include "../include/token.h"
+
+#include <cstdint>
+#include <string_view>
+#include <variant>
+
+/**
+ * @brief Convert a series of tokens into an abstract syntax tree
+ *        stored inside of "ast" and return the index of its root,
+ *        or the first error in them. Every node records the offset
+ *        of its first token, which for a nested list is done by the
+ *        list holding it.
+ *
+ * @param text
+ * @param ast
+ * @return Result<NodeId>
+ */
+auto parse_ast(Text &text, Ast &ast, bool check_lparen) -> Result<NodeId> {
+    std::size_t count = 0;
+    Result<Token> curr_tok = Token();
+
+    if (check_lparen) {
+        curr_tok = parse_token(text);
+        if (!curr_tok.ok()) {
+            return std::move(curr_tok.error());
+        }
+        if (auto opened = expect(curr_tok.value(), TokenType::LPAREN); !opened.ok()) {
+            return std::move(opened.error());
+        }
+    }
+    const auto start = curr_tok.value().offset;
+
+    for (;;) {
+        curr_tok = parse_token(text);
+        if (!curr_tok.ok()) {
+            return std::move(curr_tok.error());
+        }
+
+        const auto &token = curr_tok.value();
+        if (token.type == TokenType::RPAREN) {
+            break;
+        }
+        NodeId child;
+
+        switch (token.type) {
+            case TokenType::NUMBER:
+                if (const auto number = std::get_if<std::int64_t>(&token.value)) {
+                    child = ast.add_number(*number);
+                }
+                else if (const auto real = std::get_if<double>(&token.value)) {
+                    child = ast.add_real(*real);
+                }
+                else {
+                    // the lexer only hands out digits, so this always parses
+                    const auto digits = std::get<std::string_view>(token.value);
+                    const auto value = BigInt::parse(digits);
+                    child = ast.add_bignum(digits, value);
+                    value->release();
+                }
+                break;
+
+            case TokenType::STRING:
+                child = ast.add_string(std::get<std::string_view>(token.value));
+                break;
+
+            case TokenType::SYMBOL:
+                child = ast.add_symbol(std::get<std::string_view>(token.value));
+                break;
+
+            case TokenType::LPAREN: {
+                auto list = parse_ast(text, ast, false);
+                if (!list.ok()) {
+                    return list;
+                }
+                child = list.value();
+                break;
+            }
+
+            default:
+                return error_at(token.offset, ErrorCode::INCOMPLETE, "Unterminated list!");
+        }
+
+        ast.offsets[child] = token.offset;
+        ast.push_child(child);
+        ++count;
+    }
+
+    const auto list = ast.add_list(count);
+    ast.offsets[list] = start;
+    if (count != 0) {
+        const auto &head = ast.nodes[ast.children_of(list).front()];
+        if (head.type == NodeType::SYM_CONSTANT) {
+            ast.nodes[list].callee = find_builtin(head.symbol);
+        }
+    }
+    return list;
+}
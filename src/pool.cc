@@ -0,0 +1,237 @@
+#include "../include/pool.h"
+#include "../include/refcount.h"
+
+/**
+ * @brief The pool the calling thread was started by, if any, and its index in it.
+ */
+static thread_local const Pool *current_pool = nullptr;
+static thread_local std::size_t current_index = 0;
+
+/**
+ * @brief How many threads the shared pool is made with, 0 for one per core.
+ */
+static std::size_t task_threads = 0;
+
+/**
+ * @brief Construct a new Pool object of "threads" threads in total,
+ *        the calling one included, so "threads" - 1 are started.
+ *
+ * @param threads
+ */
+Pool::Pool(std::size_t threads)
+    : queued(0), stopping(false) {
+    const auto count = threads == 0 ? 1 : threads;
+
+    for (std::size_t i = 0; i < count; ++i) {
+        this->queues.push_back(std::make_unique<Queue>());
+    }
+    for (std::size_t i = 1; i < count; ++i) {
+        this->threads.emplace_back([this, i] {
+            this->work(i);
+        });
+    }
+}
+
+/**
+ * @brief Destroy the Pool object once every thread has run out of
+ *        tasks, stopping and joining the ones it started.
+ */
+Pool::~Pool() {
+    {
+        const std::lock_guard guard(this->idle_lock);
+        this->stopping = true;
+    }
+    this->idle.notify_all();
+
+    for (auto &thread : this->threads) {
+        thread.join();
+    }
+}
+
+/**
+ * @brief Add "task" to "group" and queue it on the calling thread.
+ *
+ * @param group
+ * @param task
+ */
+auto Pool::spawn(TaskGroup &group, Task task) -> void {
+    group.pending.fetch_add(1, std::memory_order_relaxed);
+
+    auto &queue = *this->queues[this->self()];
+    {
+        // counted first, so "queued" is never below what the queues hold
+        const std::lock_guard guard(queue.lock);
+        this->queued.fetch_add(1, std::memory_order_release);
+        queue.jobs.push_back(Job {&group, std::move(task)});
+    }
+
+    // taking the lock orders this against a thread about to go to sleep
+    {
+        const std::lock_guard guard(this->idle_lock);
+    }
+    this->idle.notify_one();
+}
+
+/**
+ * @brief Run queued tasks, stealing them if need be, until every task
+ *        of "group" has finished. Only sleeps when there are none.
+ *
+ * @param group
+ */
+auto Pool::wait(TaskGroup &group) -> void {
+    const auto self = this->self();
+
+    while (group.pending.load(std::memory_order_acquire) != 0) {
+        Job job;
+        if (this->take(self, job)) {
+            this->run(job);
+            continue;
+        }
+
+        std::unique_lock guard(this->idle_lock);
+        this->idle.wait(guard, [&] {
+            return this->queued.load(std::memory_order_acquire) != 0
+                || group.pending.load(std::memory_order_acquire) == 0;
+        });
+    }
+}
+
+/**
+ * @brief Return how many threads run tasks, the calling one included.
+ *
+ * @return std::size_t
+ */
+auto Pool::size() const -> std::size_t {
+    return this->queues.size();
+}
+
+/**
+ * @brief Return whether no task is queued anywhere, in which case any
+ *        thread that runs out of work will go to sleep. A task with
+ *        a lot left to do should hand some of it out then.
+ *
+ * @return bool
+ */
+auto Pool::hungry() const -> bool {
+    return this->queued.load(std::memory_order_relaxed) == 0;
+}
+
+/**
+ * @brief Take the newest job queued by thread "self", or else the
+ *        oldest job of another thread, into "job". Returns false if
+ *        every queue was empty.
+ *
+ * @param self
+ * @param job
+ * @return bool
+ */
+auto Pool::take(std::size_t self, Job &job) -> bool {
+    if (this->queued.load(std::memory_order_acquire) == 0) {
+        return false;
+    }
+
+    const auto count = this->queues.size();
+    for (std::size_t i = 0; i < count; ++i) {
+        auto &queue = *this->queues[(self + i) % count];
+        const std::lock_guard guard(queue.lock);
+
+        if (queue.jobs.empty()) {
+            continue;
+        }
+        if (i == 0) {
+            job = std::move(queue.jobs.back());
+            queue.jobs.pop_back();
+        }
+        else {
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+        }
+        this->queued.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Run "job" and count it as finished in its group.
+ *
+ * @param job
+ */
+auto Pool::run(Job &job) -> void {
+    job.task();
+    job.task = nullptr;
+
+    // the group may be gone as soon as its count reaches zero
+    if (job.group->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        {
+            const std::lock_guard guard(this->idle_lock);
+        }
+        this->idle.notify_all();
+    }
+}
+
+/**
+ * @brief Run tasks on the started thread "self" until the pool stops.
+ *
+ * @param self
+ */
+auto Pool::work(std::size_t self) -> void {
+    current_pool = this;
+    current_index = self;
+
+    while (true) {
+        Job job;
+        if (this->take(self, job)) {
+            this->run(job);
+            continue;
+        }
+
+        std::unique_lock guard(this->idle_lock);
+        this->idle.wait(guard, [this] {
+            return this->queued.load(std::memory_order_acquire) != 0 || this->stopping;
+        });
+        if (this->stopping && this->queued.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Return the index of the calling thread in the pool, which
+ *        is 0 for the thread that made it or any thread outside of it.
+ *
+ * @return std::size_t
+ */
+auto Pool::self() const -> std::size_t {
+    return current_pool == this ? current_index : 0;
+}
+
+/**
+ * @brief Set how many threads the shared pool is made with. Only has an
+ *        effect before its first use. 0, the default, means one per core.
+ *
+ * @param threads
+ */
+auto set_task_threads(std::size_t threads) -> void {
+    task_threads = threads;
+}
+
+/**
+ * @brief Return the pool shared by everything in the process that runs in
+ *        parallel, making it on first use. Values are shared between
+ *        threads from then on if it has more than one.
+ *
+ * @return Pool&
+ */
+auto task_pool() -> Pool& {
+    static Pool pool([] {
+        const std::size_t threads = task_threads != 0 ? task_threads : std::thread::hardware_concurrency();
+
+        // before any thread starts, so every count is shared safely
+        if (threads > 1) {
+            threads_share_values.store(true, std::memory_order_relaxed);
+        }
+        return threads;
+    }());
+    return pool;
+}
@@ -0,0 +1,507 @@
+#include "../include/profile.h"
+#include "../include/builtin.h"
+#include "../include/function.h"
+#include "../include/stats.h"
+#include "../include/symbol.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * @brief Forms are named after this many characters of
+ *        their text, so the names stay readable.
+ */
+static constexpr std::size_t FORM_NAME_LENGTH = 48;
+
+/**
+ * @brief Struct representing a frame of the profile as reached through
+ *        the frames above it: how often it was entered that way and what
+ *        was spent in it. Time spent in a frame entered from itself counts
+ *        once in "total_ns", since it is already part of the outer call.
+ */
+struct ProfileNode final {
+    FrameKey key;
+    std::uint32_t parent;
+    std::uint64_t calls = 0;
+    std::uint64_t total_ns = 0;    // including the frames it entered
+    std::uint64_t self_ns = 0;     // excluding them
+    std::uint64_t allocations = 0; // made in the frame itself
+    FrameKey last_key {FrameKind::FORM, 0}; // the frame last entered from it,
+    std::uint32_t last_child = 0;           // and its node, if any
+};
+
+/**
+ * @brief Struct representing the edge from a node of a profile tree
+ *        to the node of the frame "key" entered from it.
+ */
+struct ProfileEdge final {
+    std::uint32_t parent;
+    FrameKey key;
+
+    auto operator==(const ProfileEdge&) const -> bool = default;
+};
+
+/**
+ * @brief Struct hashing a FrameKey.
+ */
+struct FrameKeyHash final {
+    auto operator()(const FrameKey &key) const -> std::size_t {
+        return std::hash<std::uintptr_t>()(key.id) * 4 + static_cast<std::size_t>(key.kind);
+    }
+};
+
+/**
+ * @brief Struct hashing a ProfileEdge.
+ */
+struct ProfileEdgeHash final {
+    auto operator()(const ProfileEdge &edge) const -> std::size_t {
+        return FrameKeyHash()(edge.key) * 31 + edge.parent;
+    }
+};
+
+/**
+ * @brief Struct representing every stack a thread went through as a tree of
+ *        frames, each parent pointing at the frames entered from it. Nodes
+ *        only ever get appended, so parents always come before children.
+ */
+struct ProfileTree final {
+    std::vector<ProfileNode> nodes; // the first is the root, which stands for no frame
+    std::unordered_map<ProfileEdge, std::uint32_t, ProfileEdgeHash> edges;
+
+    /**
+     * @brief Construct a new ProfileTree object holding only its root.
+     */
+    ProfileTree() {
+        this->nodes.push_back(ProfileNode {FrameKey {FrameKind::FORM, 0}, 0});
+    }
+
+    /**
+     * @brief Return the node of the frame "key" entered from
+     *        the node "parent", adding one if need be.
+     *
+     * @param parent
+     * @param key
+     * @return std::uint32_t
+     */
+    auto child(std::uint32_t parent, FrameKey key) -> std::uint32_t {
+        // a loop enters the same frame from the same node over and over
+        if (const auto &node = this->nodes[parent]; node.last_child != 0 && node.last_key == key) {
+            return node.last_child;
+        }
+
+        const auto [it, added] = this->edges.try_emplace(ProfileEdge {parent, key},
+                                                         static_cast<std::uint32_t>(this->nodes.size()));
+        if (added) {
+            this->nodes.push_back(ProfileNode {key, parent});
+        }
+        this->nodes[parent].last_key = key;
+        this->nodes[parent].last_child = it->second;
+        return it->second;
+    }
+
+    /**
+     * @brief Add everything recorded in "other" to the matching nodes.
+     *
+     * @param other
+     */
+    auto merge(const ProfileTree &other) -> void {
+        std::vector<std::uint32_t> mapped(other.nodes.size(), 0);
+
+        for (std::size_t i = 1; i < other.nodes.size(); ++i) {
+            const auto &from = other.nodes[i];
+            mapped[i] = this->child(mapped[from.parent], from.key);
+
+            auto &to = this->nodes[mapped[i]];
+            to.calls += from.calls;
+            to.total_ns += from.total_ns;
+            to.self_ns += from.self_ns;
+            to.allocations += from.allocations;
+        }
+    }
+};
+
+/**
+ * @brief Struct representing a frame a thread is in.
+ */
+struct OpenFrame final {
+    std::uint32_t node;
+    bool counted;   // unset for the frame a task runs in, which it did not enter
+    bool reentered; // the frame is a recursive call of the one it is in
+    std::uint64_t started;
+    std::uint64_t children_ns; // spent in the frames it entered
+    std::size_t allocations;   // made on the thread before it was entered
+    std::size_t children_allocations;
+};
+
+struct ThreadProfile;
+
+/**
+ * @brief The profile of every thread still running, and what the
+ *        threads that are gone recorded, guarded by "profiles_lock".
+ */
+static std::mutex profiles_lock;
+static std::vector<ThreadProfile*> profiles;
+static ProfileTree retired;
+
+/**
+ * @brief The names of the forms run so far, indexed by the id of their
+ *        frame, and the frame of each name, guarded by "forms_lock".
+ */
+static std::mutex forms_lock;
+static std::vector<std::string> form_names;
+static std::unordered_map<std::string, std::uintptr_t> form_ids;
+
+/**
+ * @brief Struct representing what one thread recorded and the frames it
+ *        is in. Only its thread touches it while it runs; it is read once
+ *        nothing runs, and merged into "retired" when the thread exits.
+ */
+struct ThreadProfile final {
+    ProfileTree tree;
+    std::vector<OpenFrame> stack;
+
+    /**
+     * @brief Construct a new ThreadProfile object and register it.
+     */
+    ThreadProfile() {
+        const std::lock_guard guard(profiles_lock);
+        profiles.push_back(this);
+    }
+
+    ThreadProfile(const ThreadProfile&) = delete;
+    auto operator=(const ThreadProfile&) -> ThreadProfile& = delete;
+
+    /**
+     * @brief Destroy the ThreadProfile object, keeping what it recorded.
+     */
+    ~ThreadProfile() {
+        const std::lock_guard guard(profiles_lock);
+        retired.merge(this->tree);
+        profiles.erase(std::find(profiles.begin(), profiles.end(), this));
+    }
+};
+
+/**
+ * @brief Return the profile of the calling thread, making it on first use.
+ *
+ * @return ThreadProfile&
+ */
+static auto thread_profile() -> ThreadProfile& {
+    static thread_local ThreadProfile profile;
+    return profile;
+}
+
+/**
+ * @brief Return the time in nanoseconds since some fixed point.
+ *
+ * @return std::uint64_t
+ */
+static auto now_ns() -> std::uint64_t {
+    const auto since = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(since).count());
+}
+
+/**
+ * @brief Start recording every top-level form, user function and builtin
+ *        run from now on, on any thread, until the process exits. Starts
+ *        counting allocations too, which the report breaks down by frame.
+ */
+auto start_profiling() -> void {
+    start_counting_allocations();
+    profiling.store(true, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Return the frame of the top-level form "root" of "ast",
+ *        named after how it starts. Forms that start the same way share
+ *        a frame, so a REPL does not add one per line it evaluates. Only
+ *        called while profiling.
+ *
+ * @param ast
+ * @param root
+ * @return FrameKey
+ */
+auto form_frame(const Ast &ast, NodeId root) -> FrameKey {
+    std::ostringstream text;
+    ast.print(root, text);
+
+    auto name = std::move(text).str();
+    if (name.size() > FORM_NAME_LENGTH) {
+        name.resize(FORM_NAME_LENGTH);
+        name += "...";
+    }
+
+    const std::lock_guard guard(forms_lock);
+    const auto [it, added] = form_ids.try_emplace(name, form_names.size());
+    if (added) {
+        form_names.push_back(std::move(name));
+    }
+    return FrameKey {FrameKind::FORM, it->second};
+}
+
+/**
+ * @brief Return the frame of the user function "function".
+ *
+ * @param function
+ * @return FrameKey
+ */
+auto function_frame(const Function &function) -> FrameKey {
+    if (function.name.has_value()) {
+        return FrameKey {FrameKind::FUNCTION, *function.name};
+    }
+    return FrameKey {FrameKind::LAMBDA, 0};
+}
+
+/**
+ * @brief Enter the frame "key" on the calling thread, below the one it
+ *        is in. A function calling itself stays in the same node, so
+ *        deep recursion does not make the stacks any deeper. Only called
+ *        while profiling.
+ *
+ * @param key
+ */
+auto enter_frame(FrameKey key) -> void {
+    auto &profile = thread_profile();
+    auto &stack = profile.stack;
+    const auto parent = stack.empty() ? 0 : stack.back().node;
+    const auto reentered = parent != 0 && stack.back().counted && profile.tree.nodes[parent].key == key;
+    const auto node = reentered ? parent : profile.tree.child(parent, key);
+
+    stack.push_back(OpenFrame {node, true, reentered, now_ns(), 0, thread_allocation_count(), 0});
+}
+
+/**
+ * @brief Leave the frame the calling thread is in, if any, and
+ *        count what was spent in it there and in the frame above.
+ */
+auto leave_frame() -> void {
+    auto &profile = thread_profile();
+    auto &stack = profile.stack;
+
+    if (stack.empty() || !stack.back().counted) {
+        return;
+    }
+
+    const auto open = stack.back();
+    const auto elapsed = now_ns() - open.started;
+    const auto allocations = thread_allocation_count() - open.allocations;
+    auto &node = profile.tree.nodes[open.node];
+    stack.pop_back();
+
+    node.calls += 1;
+    node.self_ns += elapsed - std::min(elapsed, open.children_ns);
+    node.allocations += allocations - std::min(allocations, open.children_allocations);
+    if (!open.reentered) {
+        node.total_ns += elapsed;
+    }
+
+    if (!stack.empty()) {
+        stack.back().children_ns += elapsed;
+        stack.back().children_allocations += allocations;
+    }
+}
+
+/**
+ * @brief Return the frames the calling thread is in, outermost first,
+ *        or nothing if the profiler is off.
+ *
+ * @return std::vector<FrameKey>
+ */
+auto profile_path() -> std::vector<FrameKey> {
+    std::vector<FrameKey> path;
+
+    if (!profiling.load(std::memory_order_relaxed)) {
+        return path;
+    }
+
+    const auto &profile = thread_profile();
+    auto node = profile.stack.empty() ? 0 : profile.stack.back().node;
+    for (; node != 0; node = profile.tree.nodes[node].parent) {
+        path.push_back(profile.tree.nodes[node].key);
+    }
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+/**
+ * @brief Construct a new ProfileTask object running in
+ *        the frames "path", if the profiler is on.
+ *
+ * @param path
+ */
+ProfileTask::ProfileTask(const std::vector<FrameKey> &path)
+    : active(profiling.load(std::memory_order_relaxed)), depth(0), started(0) {
+    if (!this->active) {
+        return;
+    }
+
+    auto &profile = thread_profile();
+    std::uint32_t node = 0;
+    for (const auto key : path) {
+        node = profile.tree.child(node, key);
+    }
+
+    this->depth = profile.stack.size();
+    this->started = now_ns();
+    profile.stack.push_back(OpenFrame {node, false, false, this->started, 0, thread_allocation_count(), 0});
+}
+
+/**
+ * @brief Destroy the ProfileTask object, putting
+ *        back the frames the thread was in.
+ */
+ProfileTask::~ProfileTask() {
+    if (!this->active) {
+        return;
+    }
+
+    auto &stack = thread_profile().stack;
+    const auto allocations = thread_allocation_count() - stack[this->depth].allocations;
+    stack.resize(this->depth);
+
+    if (!stack.empty()) {
+        stack.back().children_ns += now_ns() - this->started;
+        stack.back().children_allocations += allocations;
+    }
+}
+
+/**
+ * @brief Return the name of the frame "key", with nothing in it that
+ *        would break a line of collapsed stacks.
+ *
+ * @param key
+ * @return std::string
+ */
+static auto frame_name(FrameKey key) -> std::string {
+    std::string name;
+
+    switch (key.kind) {
+        case FrameKind::FORM: {
+            const std::lock_guard guard(forms_lock);
+            name = form_names[key.id];
+            break;
+        }
+
+        case FrameKind::FUNCTION:
+            name = symbol_name(static_cast<SymbolId>(key.id));
+            break;
+
+        case FrameKind::LAMBDA:
+            name = "lambda";
+            break;
+
+        case FrameKind::BUILTIN:
+            name = builtin_name(reinterpret_cast<BuiltinFn>(key.id));
+            break;
+    }
+
+    std::replace(name.begin(), name.end(), ';', ':');
+    std::replace(name.begin(), name.end(), '\n', ' ');
+    return name;
+}
+
+/**
+ * @brief Return everything every thread recorded so far in one tree.
+ *
+ * @return ProfileTree
+ */
+static auto merged_profile() -> ProfileTree {
+    const std::lock_guard guard(profiles_lock);
+    ProfileTree tree;
+
+    tree.merge(retired);
+    for (const auto profile : profiles) {
+        tree.merge(profile->tree);
+    }
+    return tree;
+}
+
+/**
+ * @brief Write every stack recorded so far to "os" in the collapsed format
+ *        flame graph tools read: one line per stack, frames separated by
+ *        ';', followed by the nanoseconds spent in its innermost frame.
+ *        Only called once nothing runs anymore.
+ *
+ * @param os
+ */
+auto write_collapsed_stacks(std::ostream &os) -> void {
+    const auto tree = merged_profile();
+    std::vector<std::string> paths(tree.nodes.size());
+
+    // parents come first, so their path is always ready
+    for (std::size_t i = 1; i < tree.nodes.size(); ++i) {
+        const auto &node = tree.nodes[i];
+        const auto &parent = paths[node.parent];
+
+        paths[i] = parent.empty() ? frame_name(node.key) : parent + ';' + frame_name(node.key);
+        if (node.self_ns != 0) {
+            os << paths[i] << ' ' << node.self_ns << '\n';
+        }
+    }
+}
+
+/**
+ * @brief Write a table of every frame recorded so far to "os": how often
+ *        it was entered, the time spent in it with and without what it
+ *        called, and the allocations it made itself, most self time first.
+ *        Time a frame spent inside of itself further up the stack is only
+ *        counted once. Only called once nothing runs anymore.
+ *
+ * @param os
+ */
+auto write_profile_summary(std::ostream &os) -> void {
+    struct Row final {
+        FrameKey key;
+        std::uint64_t calls = 0;
+        std::uint64_t total_ns = 0;
+        std::uint64_t self_ns = 0;
+        std::uint64_t allocations = 0;
+    };
+
+    const auto tree = merged_profile();
+    std::vector<Row> rows;
+    std::unordered_map<FrameKey, std::size_t, FrameKeyHash> row_of;
+
+    for (std::size_t i = 1; i < tree.nodes.size(); ++i) {
+        const auto &node = tree.nodes[i];
+        const auto [it, added] = row_of.try_emplace(node.key, rows.size());
+        if (added) {
+            rows.push_back(Row {node.key});
+        }
+
+        auto &row = rows[it->second];
+        row.calls += node.calls;
+        row.self_ns += node.self_ns;
+        row.allocations += node.allocations;
+
+        auto outermost = true;
+        for (auto up = node.parent; up != 0 && outermost; up = tree.nodes[up].parent) {
+            outermost = tree.nodes[up].key != node.key;
+        }
+        if (outermost) {
+            row.total_ns += node.total_ns;
+        }
+    }
+
+    std::sort(rows.begin(), rows.end(), [](const Row &lhs, const Row &rhs) {
+        return lhs.self_ns > rhs.self_ns;
+    });
+
+    const auto ms = [](std::uint64_t ns) {
+        return static_cast<double>(ns) / 1e6;
+    };
+
+    os << std::setw(12) << "calls" << std::setw(14) << "total ms" << std::setw(14) << "self ms"
+       << std::setw(14) << "allocations" << "  frame\n";
+    os << std::fixed << std::setprecision(3);
+    for (const auto &row : rows) {
+        os << std::setw(12) << row.calls << std::setw(14) << ms(row.total_ns) << std::setw(14) << ms(row.self_ns)
+           << std::setw(14) << row.allocations << "  " << frame_name(row.key) << '\n';
+    }
+}
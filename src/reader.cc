@@ -0,0 +1,298 @@
+#include "../include/reader.h"
+#include "../include/error.h"
+#include "../include/output.h"
+#include "../include/scan.h"
+#include "../include/text.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <string_view>
+
+/**
+ * @brief Return where "within", a position in some text, is in
+ *        a larger text which that one starts at "start" of.
+ *
+ * @param start
+ * @param within
+ * @return TextPosition
+ */
+static auto shift_position(const TextPosition &start, const TextPosition &within) -> TextPosition {
+    if (within.line == 1) {
+        return TextPosition {start.line, start.column + within.column - 1};
+    }
+    return TextPosition {start.line + within.line - 1, within.column};
+}
+
+/**
+ * @brief Construct a new Reader object for the file at "path",
+ *        or for stdin if "path" is "-". Errors if it can't be opened.
+ *
+ * @param path
+ */
+Reader::Reader(const char *path)
+    : fd(-1), eof(false), dropped(0), dropped_end {1, 1}, form_offset(0), scanned(0),
+      start(std::string_view::npos), depth(0), state(State::CODE) {
+    if (std::string_view(path) == "-") {
+        this->name = "standard input";
+        this->fd = STDIN_FILENO;
+        return;
+    }
+
+    struct stat info {};
+    if (::stat(path, &info) == 0 && S_ISREG(info.st_mode)) {
+        this->source = std::make_unique<Source>(path);
+        this->input = this->source->view();
+        this->eof = true;
+        return;
+    }
+
+    this->name = path;
+    this->fd = ::open(path, O_RDONLY);
+    if (this->fd < 0) {
+        quit(ErrorCode::IO, "Could not open ", path);
+    }
+}
+
+/**
+ * @brief Construct a new Reader object for the text [data, data + size),
+ *        which must outlive it.
+ *
+ * @param data
+ * @param size
+ */
+Reader::Reader(const char *data, std::size_t size)
+    : fd(-1), eof(true), input(data, size), dropped(0), dropped_end {1, 1}, form_offset(0), scanned(0),
+      start(std::string_view::npos), depth(0), state(State::CODE) {
+}
+
+/**
+ * @brief Destroy the Reader object and close its file.
+ */
+Reader::~Reader() {
+    if (this->fd > STDIN_FILENO) {
+        ::close(this->fd);
+    }
+}
+
+/**
+ * @brief Store the text of the next complete top-level form in "form"
+ *        and return true, or return false once the input is exhausted.
+ *        "form" stays valid until the next call. An unterminated form
+ *        at the end of input is still returned so the parser can
+ *        report what is wrong with it.
+ *
+ * @param form
+ * @return bool
+ */
+auto Reader::next(std::string_view &form) -> bool {
+    for (;;) {
+        const auto data = this->input.data();
+        auto p = data + this->scanned;
+
+        if (this->scan(p, data + this->input.size())) {
+            return this->take(form, static_cast<std::size_t>(p - data));
+        }
+        this->scanned = static_cast<std::size_t>(p - data);
+
+        if (!this->refill()) {
+            if (this->start == std::string_view::npos) {
+                return false;
+            }
+            return this->take(form, this->input.size());
+        }
+    }
+}
+
+/**
+ * @brief Return how far into the input the form last handed out starts.
+ *
+ * @return std::size_t
+ */
+auto Reader::offset() const -> std::size_t {
+    return this->form_offset;
+}
+
+/**
+ * @brief Return the line and column of the byte at "offset" in the
+ *        input, or nothing if it is part of a form that was already
+ *        dropped. Only the text still held is counted through.
+ *
+ * @param offset
+ * @return std::optional<TextPosition>
+ */
+auto Reader::position(std::size_t offset) const -> std::optional<TextPosition> {
+    if (offset < this->dropped) {
+        return std::nullopt;
+    }
+
+    return shift_position(this->dropped_end, position_of(this->input, offset - this->dropped));
+}
+
+/**
+ * @brief Advance "p" through the form being read. Returns true with "p"
+ *        just past the form once it is complete, or false with "p" at
+ *        "end" if the rest of it has not been read yet.
+ *
+ * @param p
+ * @param end
+ * @return bool
+ */
+auto Reader::scan(const char *&p, const char *end) -> bool {
+    while (p < end) {
+        switch (this->state) {
+            case State::STRING:
+                p = find_byte(p, end, '"');
+                if (p == end) {
+                    return false;
+                }
+                ++p;
+                this->state = State::CODE;
+
+                if (this->depth == 0) {
+                    return true;
+                }
+                break;
+
+            case State::COMMENT:
+                p = find_byte(p, end, '\n');
+                if (p == end) {
+                    return false;
+                }
+                this->state = State::CODE;
+                break;
+
+            case State::ATOM:
+                // a top-level atom is handed over on its own so the
+                // parser can complain about it like any other form
+                while (p < end && (is_class(*p, CHAR_SYMBOL) || *p == '-')) {
+                    ++p;
+                }
+                if (p == end) {
+                    return false;
+                }
+                this->state = State::CODE;
+                return true;
+
+            case State::CODE:
+                p = skip_space(p, end);
+                if (p == end) {
+                    return false;
+                }
+
+                if (*p == '#') {
+                    this->state = State::COMMENT;
+                    ++p;
+                    break;
+                }
+                if (this->start == std::string_view::npos) {
+                    this->start = static_cast<std::size_t>(p - this->input.data());
+                }
+
+                switch (*p++) {
+                    case '"':
+                        this->state = State::STRING;
+                        break;
+
+                    case '(':
+                        ++this->depth;
+                        break;
+
+                    case ')':
+                        if (this->depth <= 1) {
+                            this->depth = 0;
+                            return true;
+                        }
+                        --this->depth;
+                        break;
+
+                    default:
+                        if (this->depth == 0) {
+                            this->state = State::ATOM;
+                        }
+                        break;
+                }
+                break;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Hand out the form being read, which ends at "stop",
+ *        and get ready to read the one after it.
+ *
+ * @param form
+ * @param stop
+ * @return bool
+ */
+auto Reader::take(std::string_view &form, std::size_t stop) -> bool {
+    form = this->input.substr(this->start, stop - this->start);
+    this->form_offset = this->dropped + this->start;
+
+    this->scanned = stop;
+    this->start = std::string_view::npos;
+    this->depth = 0;
+    this->state = State::CODE;
+    return true;
+}
+
+/**
+ * @brief Read another chunk into the buffer, dropping the forms that
+ *        were already handed out. Returns false at the end of input and
+ *        errors if reading fails.
+ *        Standard output is flushed first if the read would have to
+ *        wait, so what the forms so far printed is not held back.
+ *
+ * @return bool
+ */
+auto Reader::refill() -> bool {
+    if (this->eof) {
+        return false;
+    }
+
+    // keep only the unfinished form, everything before it has been evaluated,
+    // counting lines through what goes since nothing can count them later
+    const auto keep = this->start != std::string_view::npos ? this->start : this->scanned;
+    this->dropped_end = shift_position(this->dropped_end, position_of(this->buffer, keep));
+    this->dropped += keep;
+    this->buffer.erase(0, keep);
+    this->scanned -= keep;
+    if (this->start != std::string_view::npos) {
+        this->start -= keep;
+    }
+
+    const auto old_size = this->buffer.size();
+    this->buffer.resize(old_size + CHUNK_SIZE);
+
+    // a pipe or a terminal may not send more for a while, so whoever
+    // is on the other end should see the output of the forms before
+    pollfd ready {this->fd, POLLIN, 0};
+    if (::poll(&ready, 1, 0) == 0) {
+        standard_output().flush();
+    }
+
+    ssize_t count;
+    do {
+        count = ::read(this->fd, this->buffer.data() + old_size, CHUNK_SIZE);
+    } while (count < 0 && errno == EINTR);
+
+    // only an empty read is the end, a failed one would cut the script short
+    if (count < 0) {
+        this->buffer.resize(old_size);
+        quit(ErrorCode::IO, "Could not read ", this->name);
+    }
+    if (count == 0) {
+        this->buffer.resize(old_size);
+        this->input = this->buffer;
+        this->eof = true;
+        return false;
+    }
+
+    this->buffer.resize(old_size + static_cast<std::size_t>(count));
+    this->input = this->buffer;
+    return true;
+}
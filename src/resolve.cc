@@ -0,0 +1,383 @@
+#include "../include/resolve.h"
+#include "../include/builtin.h"
+#include "../include/symbol.h"
+#include "../include/error.h"
+#include "../include/result.h"
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Names bound by each enclosing let or function, innermost last.
+ */
+using Scopes = std::vector<std::vector<SymbolId>>;
+
+/**
+ * @brief Struct holding the symbols of the special forms.
+ */
+struct Keywords final {
+    SymbolId define;
+    SymbolId set;
+    SymbolId let;
+    SymbolId if_;
+    SymbolId lambda;
+    SymbolId defun;
+};
+
+static auto resolve_node(Ast &ast, NodeId id, Scopes &scopes) -> Result<void>;
+
+/**
+ * @brief Return the symbols of the special forms, interning them once.
+ *
+ * @return const Keywords&
+ */
+static auto keywords() -> const Keywords& {
+    static const Keywords keywords {
+        intern_symbol("define"),
+        intern_symbol("set"),
+        intern_symbol("let"),
+        intern_symbol("if"),
+        intern_symbol("lambda"),
+        intern_symbol("defun"),
+    };
+    return keywords;
+}
+
+/**
+ * @brief Return whether "symbol" names a special form.
+ *
+ * @param symbol
+ * @return bool
+ */
+static auto is_keyword(SymbolId symbol) -> bool {
+    const auto &words = keywords();
+    return symbol == words.define || symbol == words.set || symbol == words.let
+        || symbol == words.if_ || symbol == words.lambda || symbol == words.defun;
+}
+
+/**
+ * @brief Return the symbol held by "id", or an error unless
+ *        it is a symbol that can be used as a variable name.
+ *
+ * @param ast
+ * @param id
+ * @return Result<SymbolId>
+ */
+static auto expect_name(const Ast &ast, NodeId id) -> Result<SymbolId> {
+    const auto &node = ast.nodes[id];
+
+    if (node.type != NodeType::SYM_CONSTANT || is_keyword(node.symbol)) {
+        return error_at(ast.offsets[id], ErrorCode::SYNTAX, "Expected a variable name!");
+    }
+    return node.symbol;
+}
+
+/**
+ * @brief Bind the symbol "id" to its global slot, or return an
+ *        error unless it is a name that a global can be given.
+ *
+ * @param ast
+ * @param id
+ * @return Result<void>
+ */
+static auto expect_global_name(Ast &ast, NodeId id) -> Result<void> {
+    auto name = expect_name(ast, id);
+    if (!name.ok()) {
+        return std::move(name.error());
+    }
+    if (find_builtin(name.value()) != nullptr) {
+        return error_at(ast.offsets[id], ErrorCode::NAME,
+                        "Cannot redefine the built-in ", symbol_name(name.value()), "!");
+    }
+    ast.nodes[id].binding = Binding::GLOBAL;
+    return {};
+}
+
+/**
+ * @brief Bind the symbol "id" to the innermost let or function naming it,
+ *        or to its global slot if none does.
+ *
+ * @param ast
+ * @param id
+ * @param scopes
+ * @return Result<void>
+ */
+static auto resolve_symbol(Ast &ast, NodeId id, const Scopes &scopes) -> Result<void> {
+    auto &node = ast.nodes[id];
+
+    for (std::size_t depth = 0; depth < scopes.size(); ++depth) {
+        const auto &names = scopes[scopes.size() - 1 - depth];
+        const auto found = std::find(names.begin(), names.end(), node.symbol);
+
+        if (found != names.end()) {
+            if (depth > std::numeric_limits<std::uint16_t>::max()) {
+                return error_at(ast.offsets[id], ErrorCode::LIMIT, "Scopes are nested too deeply!");
+            }
+            node.binding = Binding::LOCAL;
+            node.depth = static_cast<std::uint16_t>(depth);
+            node.slot = static_cast<std::uint16_t>(found - names.begin());
+            return {};
+        }
+    }
+    node.binding = Binding::GLOBAL;
+    return {};
+}
+
+/**
+ * @brief Resolve every node of "exprs" in turn, stopping at the first error.
+ *
+ * @param ast
+ * @param exprs
+ * @param scopes
+ * @return Result<void>
+ */
+static auto resolve_all(Ast &ast, std::span<const NodeId> exprs, Scopes &scopes) -> Result<void> {
+    for (const auto expr : exprs) {
+        if (auto resolved = resolve_node(ast, expr, scopes); !resolved.ok()) {
+            return resolved;
+        }
+    }
+    return {};
+}
+
+/**
+ * @brief Resolve (define name value). The name always refers to its global slot.
+ *
+ * @param ast
+ * @param id
+ * @param scopes
+ * @return Result<void>
+ */
+static auto resolve_define(Ast &ast, NodeId id, Scopes &scopes) -> Result<void> {
+    const auto body = ast.children_of(id);
+    if (body.size() != 3) {
+        return error_at(ast.offsets[id], ErrorCode::SYNTAX, "Expected (define name value)!");
+    }
+
+    if (auto named = expect_global_name(ast, body[1]); !named.ok()) {
+        return named;
+    }
+    return resolve_node(ast, body[2], scopes);
+}
+
+/**
+ * @brief Resolve (set name value), where the name may be local or global.
+ *
+ * @param ast
+ * @param id
+ * @param scopes
+ * @return Result<void>
+ */
+static auto resolve_set(Ast &ast, NodeId id, Scopes &scopes) -> Result<void> {
+    const auto body = ast.children_of(id);
+    if (body.size() != 3) {
+        return error_at(ast.offsets[id], ErrorCode::SYNTAX, "Expected (set name value)!");
+    }
+
+    if (auto name = expect_name(ast, body[1]); !name.ok()) {
+        return std::move(name.error());
+    }
+    if (auto symbol = resolve_symbol(ast, body[1], scopes); !symbol.ok()) {
+        return symbol;
+    }
+    return resolve_node(ast, body[2], scopes);
+}
+
+/**
+ * @brief Resolve (let ((name value) ...) body ...). The values are resolved
+ *        in the enclosing scope and the body in a new one holding the names.
+ *
+ * @param ast
+ * @param id
+ * @param scopes
+ * @return Result<void>
+ */
+static auto resolve_let(Ast &ast, NodeId id, Scopes &scopes) -> Result<void> {
+    const auto body = ast.children_of(id);
+    if (body.size() < 3 || ast.nodes[body[1]].type != NodeType::LIST_CONSTANT) {
+        return error_at(ast.offsets[id], ErrorCode::SYNTAX, "Expected (let ((name value) ...) body ...)!");
+    }
+
+    const auto bindings = ast.children_of(body[1]);
+    if (bindings.size() > std::numeric_limits<std::uint16_t>::max()) {
+        return error_at(ast.offsets[id], ErrorCode::LIMIT, "Too many variables in one let!");
+    }
+    ast.nodes[body[1]].form = Form::SYNTAX;
+    ast.nodes[body[1]].callee = nullptr;
+
+    std::vector<SymbolId> names;
+    names.reserve(bindings.size());
+
+    for (const auto binding : bindings) {
+        auto &pair = ast.nodes[binding];
+        if (pair.type != NodeType::LIST_CONSTANT || pair.size != 2) {
+            return error_at(ast.offsets[binding], ErrorCode::SYNTAX, "Expected (let ((name value) ...) body ...)!");
+        }
+        pair.form = Form::SYNTAX;
+        pair.callee = nullptr;
+
+        const auto name_and_value = ast.children_of(binding);
+        auto name = expect_name(ast, name_and_value[0]);
+        if (!name.ok()) {
+            return std::move(name.error());
+        }
+
+        if (std::find(names.begin(), names.end(), name.value()) != names.end()) {
+            return error_at(ast.offsets[binding], ErrorCode::SYNTAX,
+                            "Variable ", symbol_name(name.value()), " is bound twice in one let!");
+        }
+        names.push_back(name.value());
+        if (auto value = resolve_node(ast, name_and_value[1], scopes); !value.ok()) {
+            return value;
+        }
+    }
+
+    scopes.push_back(std::move(names));
+    auto resolved = resolve_all(ast, body.subspan(2), scopes);
+    scopes.pop_back();
+    return resolved;
+}
+
+/**
+ * @brief Resolve (if condition then) or (if condition then else).
+ *
+ * @param ast
+ * @param id
+ * @param scopes
+ * @return Result<void>
+ */
+static auto resolve_if(Ast &ast, NodeId id, Scopes &scopes) -> Result<void> {
+    const auto body = ast.children_of(id);
+    if (body.size() != 3 && body.size() != 4) {
+        return error_at(ast.offsets[id], ErrorCode::SYNTAX, "Expected (if condition then else)!");
+    }
+    return resolve_all(ast, body.subspan(1), scopes);
+}
+
+/**
+ * @brief Resolve (lambda (param ...) body ...), or (defun name (param ...) body ...)
+ *        which also binds the global "name". The body is resolved in a new scope
+ *        holding the parameters, nested inside of the one the function is made in.
+ *
+ * @param ast
+ * @param id
+ * @param scopes
+ * @return Result<void>
+ */
+static auto resolve_function(Ast &ast, NodeId id, Scopes &scopes) -> Result<void> {
+    const auto body = ast.children_of(id);
+    const bool named = ast.nodes[id].form == Form::DEFUN;
+    const std::size_t params = named ? 2 : 1;
+
+    if (body.size() < params + 2 || ast.nodes[body[params]].type != NodeType::LIST_CONSTANT) {
+        return error_at(ast.offsets[id], ErrorCode::SYNTAX, named ? "Expected (defun name (param ...) body ...)!"
+                                                                  : "Expected (lambda (param ...) body ...)!");
+    }
+    if (named) {
+        if (auto name = expect_global_name(ast, body[1]); !name.ok()) {
+            return name;
+        }
+    }
+
+    auto &list = ast.nodes[body[params]];
+    if (list.size > std::numeric_limits<std::uint16_t>::max()) {
+        return error_at(ast.offsets[id], ErrorCode::LIMIT, "Too many parameters in one function!");
+    }
+    list.form = Form::SYNTAX;
+    list.callee = nullptr;
+
+    std::vector<SymbolId> names;
+    for (const auto param : ast.children_of(body[params])) {
+        auto name = expect_name(ast, param);
+        if (!name.ok()) {
+            return std::move(name.error());
+        }
+        if (std::find(names.begin(), names.end(), name.value()) != names.end()) {
+            return error_at(ast.offsets[param], ErrorCode::SYNTAX,
+                            "Parameter ", symbol_name(name.value()), " is named twice!");
+        }
+        names.push_back(name.value());
+    }
+
+    scopes.push_back(std::move(names));
+    auto resolved = resolve_all(ast, body.subspan(params + 1), scopes);
+    scopes.pop_back();
+    return resolved;
+}
+
+/**
+ * @brief Resolve the subtree rooted at "id" top down, stopping at
+ *        the first error, which knows the node it is about.
+ *
+ * @param ast
+ * @param id
+ * @param scopes
+ * @return Result<void>
+ */
+static auto resolve_node(Ast &ast, NodeId id, Scopes &scopes) -> Result<void> {
+    const auto type = ast.nodes[id].type;
+
+    if (type == NodeType::SYM_CONSTANT) {
+        return resolve_symbol(ast, id, scopes);
+    }
+    if (type != NodeType::LIST_CONSTANT || ast.nodes[id].size == 0) {
+        return {};
+    }
+
+    const auto body = ast.children_of(id);
+    const auto &head = ast.nodes[body.front()];
+
+    if (head.type == NodeType::SYM_CONSTANT && is_keyword(head.symbol)) {
+        const auto &words = keywords();
+        const auto symbol = head.symbol;
+
+        ast.nodes[id].callee = nullptr;
+        if (symbol == words.define) {
+            ast.nodes[id].form = Form::DEFINE;
+            return resolve_define(ast, id, scopes);
+        }
+        if (symbol == words.set) {
+            ast.nodes[id].form = Form::SET;
+            return resolve_set(ast, id, scopes);
+        }
+        if (symbol == words.let) {
+            ast.nodes[id].form = Form::LET;
+            return resolve_let(ast, id, scopes);
+        }
+        if (symbol == words.if_) {
+            ast.nodes[id].form = Form::IF;
+            return resolve_if(ast, id, scopes);
+        }
+        ast.nodes[id].form = symbol == words.lambda ? Form::LAMBDA : Form::DEFUN;
+        return resolve_function(ast, id, scopes);
+    }
+
+    if (auto resolved = resolve_all(ast, body, scopes); !resolved.ok()) {
+        return resolved;
+    }
+
+    // a local named like a built-in hides it
+    if (ast.nodes[body.front()].binding == Binding::LOCAL) {
+        ast.nodes[id].callee = nullptr;
+    }
+    return {};
+}
+
+/**
+ * @brief Mark the special forms under "root" and bind every symbol to where
+ *        its value lives: a (depth, slot) pair into the enclosing frames,
+ *        or the global slot of the symbol. Calls whose head names a local
+ *        lose the built-in the parser bound them to. Returns an error for
+ *        malformed special forms. Must run before anything else rewrites
+ *        the tree.
+ *
+ * @param ast
+ * @param root
+ * @return Result<void>
+ */
+auto resolve(Ast &ast, NodeId root) -> Result<void> {
+    Scopes scopes;
+    return resolve_node(ast, root, scopes);
+}
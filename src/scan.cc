@@ -0,0 +1,240 @@
+#include "../include/scan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LISP_SCAN_X86 1
+#else
+#define LISP_SCAN_X86 0
+#endif
+
+using SkipFn = auto (*)(const char*, const char*) -> const char*;
+using FindFn = auto (*)(const char*, const char*, char) -> const char*;
+
+/**
+ * @brief Return whether "c" is whitespace as far as the lexer cares.
+ *
+ * @param c
+ * @return bool
+ */
+static inline auto is_space(char c) -> bool {
+    return c == ' ' || c == '\n' || c == '\t';
+}
+
+/**
+ * @brief Byte at a time fallback for skip_space.
+ *
+ * @param p
+ * @param end
+ * @return const char*
+ */
+static auto skip_space_scalar(const char *p, const char *end) -> const char* {
+    while (p < end && is_space(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+/**
+ * @brief Byte at a time fallback for find_byte.
+ *
+ * @param p
+ * @param end
+ * @param c
+ * @return const char*
+ */
+static auto find_byte_scalar(const char *p, const char *end, char c) -> const char* {
+    while (p < end && *p != c) {
+        ++p;
+    }
+    return p;
+}
+
+#if LISP_SCAN_X86
+// Every vector routine works the same way: compare a whole block against
+// the bytes of interest, squash the comparison into a bit mask and let
+// count-trailing-zeros name the first hit. Leftovers go to the scalar code.
+
+__attribute__((target("sse2")))
+static auto skip_space_sse2(const char *p, const char *end) -> const char* {
+    const auto space = _mm_set1_epi8(' ');
+    const auto newline = _mm_set1_epi8('\n');
+    const auto tab = _mm_set1_epi8('\t');
+
+    while (end - p >= 16) {
+        const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const auto hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, space),
+                                                    _mm_cmpeq_epi8(block, newline)),
+                                       _mm_cmpeq_epi8(block, tab));
+        const auto other = ~static_cast<unsigned>(_mm_movemask_epi8(hits)) & 0xffffu;
+
+        if (other != 0) {
+            return p + __builtin_ctz(other);
+        }
+        p += 16;
+    }
+    return skip_space_scalar(p, end);
+}
+
+__attribute__((target("sse2")))
+static auto find_byte_sse2(const char *p, const char *end, char c) -> const char* {
+    const auto needle = _mm_set1_epi8(c);
+
+    while (end - p >= 16) {
+        const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const auto hits = static_cast<unsigned>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)));
+
+        if (hits != 0) {
+            return p + __builtin_ctz(hits);
+        }
+        p += 16;
+    }
+    return find_byte_scalar(p, end, c);
+}
+
+__attribute__((target("avx2")))
+static auto skip_space_avx2(const char *p, const char *end) -> const char* {
+    const auto space = _mm256_set1_epi8(' ');
+    const auto newline = _mm256_set1_epi8('\n');
+    const auto tab = _mm256_set1_epi8('\t');
+
+    while (end - p >= 32) {
+        const auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const auto hits = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block, space),
+                                                          _mm256_cmpeq_epi8(block, newline)),
+                                          _mm256_cmpeq_epi8(block, tab));
+        const auto other = ~static_cast<unsigned>(_mm256_movemask_epi8(hits));
+
+        if (other != 0) {
+            return p + __builtin_ctz(other);
+        }
+        p += 32;
+    }
+    return skip_space_sse2(p, end);
+}
+
+__attribute__((target("avx2")))
+static auto find_byte_avx2(const char *p, const char *end, char c) -> const char* {
+    const auto needle = _mm256_set1_epi8(c);
+
+    while (end - p >= 32) {
+        const auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const auto hits = static_cast<unsigned>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle)));
+
+        if (hits != 0) {
+            return p + __builtin_ctz(hits);
+        }
+        p += 32;
+    }
+    return find_byte_sse2(p, end, c);
+}
+#endif
+
+/**
+ * @brief Struct holding the scanner implementations currently in use.
+ */
+struct Scanners final {
+    ScanLevel level;
+    SkipFn skip;
+    FindFn find;
+};
+
+/**
+ * @brief Return the best level the CPU running us supports.
+ *
+ * @return ScanLevel
+ */
+static auto detect_level() -> ScanLevel {
+#if LISP_SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return ScanLevel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return ScanLevel::SSE2;
+    }
+#endif
+    return ScanLevel::SCALAR;
+}
+
+/**
+ * @brief Return the implementations for "level".
+ *
+ * @param level
+ * @return Scanners
+ */
+static auto scanners_for(ScanLevel level) -> Scanners {
+    switch (level) {
+#if LISP_SCAN_X86
+        case ScanLevel::AVX2:
+            return {level, skip_space_avx2, find_byte_avx2};
+
+        case ScanLevel::SSE2:
+            return {level, skip_space_sse2, find_byte_sse2};
+#endif
+        default:
+            return {ScanLevel::SCALAR, skip_space_scalar, find_byte_scalar};
+    }
+}
+
+/**
+ * @brief Return the scanners picked for this CPU, chosen on first use.
+ *
+ * @return Scanners&
+ */
+static auto active() -> Scanners& {
+    static Scanners scanners = scanners_for(detect_level());
+    return scanners;
+}
+
+/**
+ * @brief Return the first byte in [begin, end) that is not a space,
+ *        tab or newline, or "end" if there is none.
+ *
+ * @param begin
+ * @param end
+ * @return const char*
+ */
+auto skip_space(const char *begin, const char *end) -> const char* {
+    return active().skip(begin, end);
+}
+
+/**
+ * @brief Return the first "c" in [begin, end), or "end" if there is none.
+ *        Used to find the end of comments and string constants.
+ *
+ * @param begin
+ * @param end
+ * @param c
+ * @return const char*
+ */
+auto find_byte(const char *begin, const char *end, char c) -> const char* {
+    return active().find(begin, end, c);
+}
+
+/**
+ * @brief Return the instruction set the scanners are currently using.
+ *
+ * @return ScanLevel
+ */
+auto scan_level() -> ScanLevel {
+    return active().level;
+}
+
+/**
+ * @brief Force the scanners to "level", clamped to what the CPU
+ *        supports, and return the level actually picked. Only
+ *        meant for benchmarks comparing implementations.
+ *
+ * @param level
+ * @return ScanLevel
+ */
+auto set_scan_level(ScanLevel level) -> ScanLevel {
+    const auto best = detect_level();
+    if (static_cast<int>(level) > static_cast<int>(best)) {
+        level = best;
+    }
+    active() = scanners_for(level);
+    return level;
+}
@@ -0,0 +1,219 @@
+#include "../include/schedule.h"
+#include "../include/builtin.h"
+
+#include <algorithm>
+#include <limits>
+#include <span>
+
+/**
+ * @brief Marks a form index that refers to no form.
+ */
+static constexpr std::uint32_t NO_FORM = std::numeric_limits<std::uint32_t>::max();
+
+/**
+ * @brief Add "symbol" to "symbols" unless it is already there.
+ *
+ * @param symbols
+ * @param symbol
+ */
+static auto add_once(std::vector<SymbolId> &symbols, SymbolId symbol) -> void {
+    if (std::find(symbols.begin(), symbols.end(), symbol) == symbols.end()) {
+        symbols.push_back(symbol);
+    }
+}
+
+/**
+ * @brief Add the globals read and written under "id" to "effects".
+ *        "in_function" is set inside the body of a lambda or defun,
+ *        which only runs when the function is called.
+ *
+ * @param ast
+ * @param id
+ * @param in_function
+ * @param effects
+ */
+static auto collect_node(const Ast &ast, NodeId id, bool in_function, Effects &effects) -> void {
+    const auto &node = ast.nodes[id];
+
+    if (node.type == NodeType::SYM_CONSTANT) {
+        if (node.binding == Binding::GLOBAL && find_builtin(node.symbol) == nullptr) {
+            add_once(effects.reads, node.symbol);
+        }
+        return;
+    }
+    if (node.type != NodeType::LIST_CONSTANT) {
+        return;
+    }
+
+    const auto write = [&](SymbolId symbol) {
+        add_once(effects.writes, symbol);
+        if (in_function) {
+            add_once(effects.call_writes, symbol);
+        }
+    };
+
+    const auto body = ast.children_of(id);
+    std::span<const NodeId> exprs = body;
+
+    switch (node.form) {
+        case Form::DEFINE:
+            write(ast.nodes[body[1]].symbol);
+            exprs = body.subspan(2);
+            break;
+
+        case Form::SET: {
+            const auto &name = ast.nodes[body[1]];
+            if (name.binding == Binding::GLOBAL) {
+                write(name.symbol);
+            }
+            else if (in_function) {
+                effects.sets_locals = true;
+            }
+            exprs = body.subspan(2);
+            break;
+        }
+
+        case Form::LET:
+            for (const auto binding : ast.children_of(body[1])) {
+                collect_node(ast, ast.children_of(binding)[1], in_function, effects);
+            }
+            exprs = body.subspan(2);
+            break;
+
+        case Form::IF:
+            exprs = body.subspan(1);
+            break;
+
+        case Form::LAMBDA:
+            for (const auto expr : body.subspan(2)) {
+                collect_node(ast, expr, true, effects);
+            }
+            return;
+
+        case Form::DEFUN:
+            write(ast.nodes[body[1]].symbol);
+            for (const auto expr : body.subspan(3)) {
+                collect_node(ast, expr, true, effects);
+            }
+            return;
+
+        default:
+            break;
+    }
+
+    for (const auto expr : exprs) {
+        collect_node(ast, expr, in_function, effects);
+    }
+}
+
+/**
+ * @brief Return the globals the resolved top-level form "root" of "ast"
+ *        may read or write. Built-in names are left out since they can't
+ *        be defined, and so are the names special forms bind locally.
+ *
+ * @param ast
+ * @param root
+ * @return Effects
+ */
+auto collect_effects(const Ast &ast, NodeId root) -> Effects {
+    Effects effects {{}, {}, {}, false};
+    collect_node(ast, root, false, effects);
+    return effects;
+}
+
+/**
+ * @brief Work out which of the top-level forms with "effects", given in
+ *        source order, have to wait for which earlier ones. A form waits
+ *        for the last form before it that wrote a global it reads or
+ *        writes, and for every form since then that read a global it
+ *        writes. Using a global counts as doing what the bodies of the
+ *        functions in it do: reading whatever the forms that wrote it
+ *        read and writing whatever those bodies write. Functions whose
+ *        bodies assign to locals may share that state between calls,
+ *        so using one counts as writing it too.
+ *
+ * @param effects
+ * @return FormGraph
+ */
+auto order_forms(const std::vector<Effects> &effects) -> FormGraph {
+    const auto forms = effects.size();
+    const auto symbols = symbol_count();
+
+    FormGraph graph;
+    graph.successors.resize(forms);
+    graph.predecessors.assign(forms, 0);
+
+    // per global, what calling what the forms that wrote it made may read
+    // and write, the last form that wrote it and the forms that read it since
+    std::vector<std::vector<SymbolId>> sources(symbols);
+    std::vector<std::vector<SymbolId>> targets(symbols);
+    std::vector<std::uint32_t> last_writer(symbols, NO_FORM);
+    std::vector<std::vector<std::uint32_t>> readers(symbols);
+
+    // the form that last reached each global or linked to each form,
+    // so neither is visited twice for the same form
+    std::vector<std::uint32_t> reached(symbols, NO_FORM);
+    std::vector<std::uint32_t> linked(forms, NO_FORM);
+
+    std::vector<SymbolId> reads;
+    std::vector<SymbolId> writes;
+
+    for (std::uint32_t form = 0; form < forms; ++form) {
+        const auto &effect = effects[form];
+        const auto link = [&](std::uint32_t from) {
+            if (from != NO_FORM && from != form && linked[from] != form) {
+                linked[from] = form;
+                graph.successors[from].push_back(form);
+                ++graph.predecessors[form];
+            }
+        };
+
+        reads.clear();
+        writes = effect.writes;
+
+        for (const auto symbol : effect.reads) {
+            reached[symbol] = form;
+            reads.push_back(symbol);
+        }
+        for (std::size_t i = 0; i < reads.size(); ++i) {
+            const auto symbol = reads[i];
+
+            for (const auto source : sources[symbol]) {
+                if (reached[source] != form) {
+                    reached[source] = form;
+                    reads.push_back(source);
+                }
+            }
+            for (const auto target : targets[symbol]) {
+                add_once(writes, target);
+            }
+        }
+
+        for (const auto symbol : reads) {
+            link(last_writer[symbol]);
+            readers[symbol].push_back(form);
+        }
+        for (const auto symbol : writes) {
+            link(last_writer[symbol]);
+            for (const auto reader : readers[symbol]) {
+                link(reader);
+            }
+            readers[symbol].clear();
+            last_writer[symbol] = form;
+        }
+
+        for (const auto symbol : effect.writes) {
+            for (const auto source : effect.reads) {
+                add_once(sources[symbol], source);
+            }
+            for (const auto target : effect.call_writes) {
+                add_once(targets[symbol], target);
+            }
+            if (effect.sets_locals) {
+                add_once(targets[symbol], symbol);
+            }
+        }
+    }
+
+    return graph;
+}
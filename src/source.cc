@@ -0,0 +1,73 @@
+#include "../include/source.h"
+#include "../include/error.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+/**
+ * @brief Construct a new Source object from the file at "path".
+ *        Errors if the file can't be opened or read.
+ *
+ * @param path
+ */
+Source::Source(const char *path)
+    : data(nullptr), size(0), mapped(false) {
+    const int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        quit(ErrorCode::IO, "Could not open ", path);
+    }
+
+    struct stat info {};
+    if (::fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void *map = ::mmap(nullptr, static_cast<std::size_t>(info.st_size),
+                           PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (map != MAP_FAILED) {
+            ::madvise(map, static_cast<std::size_t>(info.st_size), MADV_SEQUENTIAL);
+            this->data = static_cast<const char*>(map);
+            this->size = static_cast<std::size_t>(info.st_size);
+            this->mapped = true;
+        }
+    }
+
+    if (!this->mapped) {
+        char chunk[65536];
+        ssize_t count;
+
+        while ((count = ::read(fd, chunk, sizeof(chunk))) != 0) {
+            if (count > 0) {
+                this->buffer.append(chunk, static_cast<std::size_t>(count));
+            }
+            else if (errno != EINTR) {
+                ::close(fd);
+                quit(ErrorCode::IO, "Could not read ", path);
+            }
+        }
+        this->data = this->buffer.data();
+        this->size = this->buffer.size();
+    }
+
+    ::close(fd);
+}
+
+/**
+ * @brief Destroy the Source object and unmap the file.
+ */
+Source::~Source() {
+    if (this->mapped) {
+        ::munmap(const_cast<char*>(this->data), this->size);
+    }
+}
+
+/**
+ * @brief Return the contents of the file.
+ *
+ * @return std::string_view
+ */
+auto Source::view() const -> std::string_view {
+    return {this->data, this->size};
+}
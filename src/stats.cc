@@ -0,0 +1,98 @@
+#include "../include/stats.h"
+
+#include <atomic>
+#include <mutex>
+
+/**
+ * @brief Struct holding the allocations counted on one thread. Only its
+ *        own thread writes the count, so counting needs no atomic
+ *        read-modify-write, and the counters of all live threads are kept
+ *        in a list to be summed on demand. What a thread counted is moved
+ *        to "retired" when it exits.
+ */
+struct Counter final {
+    std::atomic<std::size_t> count {0};
+    Counter *next = nullptr;
+    bool listed = false;
+
+    Counter() = default;
+    Counter(const Counter&) = delete;
+    auto operator=(const Counter&) -> Counter& = delete;
+
+    ~Counter();
+};
+
+static std::mutex counters_lock;
+static Counter *counters = nullptr;
+static std::size_t retired = 0;
+static thread_local Counter counter;
+static thread_local bool exited = false;
+
+Counter::~Counter() {
+    const std::lock_guard guard(counters_lock);
+
+    if (this->listed) {
+        retired += this->count.load(std::memory_order_relaxed);
+        for (auto link = &counters; *link != nullptr; link = &(*link)->next) {
+            if (*link == this) {
+                *link = this->next;
+                break;
+            }
+        }
+    }
+    exited = true;
+}
+
+/**
+ * @brief Start counting allocations. Counts only cover what was
+ *        allocated from then on.
+ */
+auto start_counting_allocations() -> void {
+    counting_allocations.store(true, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Return how many times operator new has been called so far
+ *        on all threads together.
+ *
+ * @return std::size_t
+ */
+auto allocation_count() -> std::size_t {
+    const std::lock_guard guard(counters_lock);
+    auto total = retired;
+
+    for (auto it = counters; it != nullptr; it = it->next) {
+        total += it->count.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+/**
+ * @brief Return how many times operator new has been called so far
+ *        on the calling thread.
+ *
+ * @return std::size_t
+ */
+auto thread_allocation_count() -> std::size_t {
+    return exited ? 0 : counter.count.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Count an allocation on the calling thread, putting its counter
+ *        on the list the first time. Allocations made while the thread
+ *        exits, after its counter is gone, are not counted.
+ */
+auto count_allocation() -> void {
+    if (exited) {
+        return;
+    }
+
+    auto &mine = counter;
+    if (!mine.listed) [[unlikely]] {
+        const std::lock_guard guard(counters_lock);
+        mine.next = counters;
+        counters = &mine;
+        mine.listed = true;
+    }
+    mine.count.store(mine.count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
@@ -0,0 +1,81 @@
+#include "../include/symbol.h"
+#include "../include/intern.h"
+
+#include <mutex>
+#include <shared_mutex>
+
+/**
+ * @brief Return the global symbol table. Built on first use so
+ *        it is ready no matter which translation unit asks first.
+ *
+ * @return StringPool&
+ */
+static auto symbols() -> StringPool& {
+    static StringPool table;
+    return table;
+}
+
+/**
+ * @brief Return the lock guarding the symbol table. Every interpreter in
+ *        the process shares the table and may parse on a thread of its own.
+ *
+ * @return std::shared_mutex&
+ */
+static auto symbols_lock() -> std::shared_mutex& {
+    static std::shared_mutex lock;
+    return lock;
+}
+
+/**
+ * @brief Return the id of the symbol "name", adding it to the
+ *        global symbol table the first time it is seen.
+ *
+ * @param name
+ * @return SymbolId
+ */
+auto intern_symbol(std::string_view name) -> SymbolId {
+    {
+        const std::shared_lock guard(symbols_lock());
+        if (const auto found = symbols().find(name)) {
+            return *found;
+        }
+    }
+
+    const std::unique_lock guard(symbols_lock());
+    return symbols().intern(name);
+}
+
+/**
+ * @brief Return the id of the symbol "name" without adding it
+ *        to the global symbol table.
+ *
+ * @param name
+ * @return std::optional<SymbolId>
+ */
+auto find_symbol(std::string_view name) -> std::optional<SymbolId> {
+    const std::shared_lock guard(symbols_lock());
+    return symbols().find(name);
+}
+
+/**
+ * @brief Return the name of the symbol "id".
+ *
+ * @param id
+ * @return std::string_view
+ */
+auto symbol_name(SymbolId id) -> std::string_view {
+    // names never move, so the view outlives the lock
+    const std::shared_lock guard(symbols_lock());
+    return symbols().get(id)->view();
+}
+
+/**
+ * @brief Return how many symbols have been interned so far,
+ *        which is one more than the largest id given out.
+ *
+ * @return std::size_t
+ */
+auto symbol_count() -> std::size_t {
+    const std::shared_lock guard(symbols_lock());
+    return symbols().size();
+}
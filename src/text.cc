@@ -1,22 +1,46 @@
 #include "../include/text.h"
+#include "../include/scan.h"
+
+#include <algorithm>
+#include <cstdlib>
 
 /**
- * @brief Construct a new Text object.
+ * @brief Return the line and column of the byte at "offset" in "text".
+ *        Lines are counted here rather than while lexing, since this is
+ *        only ever needed to report an error.
+ *
+ * @param text
+ * @param offset
+ * @return TextPosition
+ */
+auto position_of(std::string_view text, std::size_t offset) -> TextPosition {
+    const auto before = text.substr(0, offset);
+    const auto lines = static_cast<std::size_t>(std::count(before.begin(), before.end(), '\n'));
+    const auto line_start = before.rfind('\n');
+    const auto column = line_start == std::string_view::npos ? before.size() : before.size() - line_start - 1;
+
+    return TextPosition {lines + 1, column + 1};
+}
+
+/**
+ * @brief Construct a new Text object for "contents", which
+ *        starts "origin" bytes into the source it is part of.
  *
  * @param contents
+ * @param origin
  */
-Text::Text(const std::string &contents)
-    : contents(contents), position(0), size(contents.size()) {
+Text::Text(std::string_view contents, std::size_t origin)
+    : contents(contents), position(0), size(contents.size()), origin(origin) {
 }
 
 /**
  * @brief Operator overloading just to type less when accessing an index.
- *        Throws std::out_of_range exception if the index is out of bounds.
+ *        Aborts if the index is out of bounds.
  *
  * @param index
- * @return char&
+ * @return char
  */
-auto Text::operator[](const std::size_t index) -> char& {
+auto Text::operator[](const std::size_t index) const -> char {
     if (index < this->size) {
         return contents[index];
     }
@@ -34,34 +58,53 @@ auto Text::curr() const -> char {
 }
 
 /**
- * @brief Begin from "this->position" and stop
- *        once the lambda "check" returns false.
+ * @brief Begin from "this->position" and stop at the first
+ *        character that has none of the flags in "mask".
  *        Great for discovering where specific
  *        portions of text end.
  *
- * @param check
+ * @param mask
  * @return std::size_t
  */
-auto Text::find(std::function<bool(char)> check)  -> std::size_t {
-    std::size_t i;
-    for (i = this->position; check(this->contents[i]); ++i) {
-        if (i >= this->size) {
-            return std::string::npos;
-        }
+auto Text::find(std::uint8_t mask) const -> std::size_t {
+    std::size_t i = this->position;
+    while (i < this->size && is_class(this->contents[i], mask)) {
+        ++i;
     }
     return i;
 }
 
 /**
- * @brief Return a substring from "this->position" up until "end".
+ * @brief Begin from "this->position" and return the index of the
+ *        first non-whitespace character, or "this->size" if there is none.
+ *
+ * @return std::size_t
+ */
+auto Text::skip_space() const -> std::size_t {
+    const auto data = this->contents.data();
+    return static_cast<std::size_t>(
+        ::skip_space(data + this->position, data + this->size) - data);
+}
+
+/**
+ * @brief Begin from "this->position" and return the index
+ *        of the first "c", or "this->size" if there is none.
+ *
+ * @param c
+ * @return std::size_t
+ */
+auto Text::find_char(char c) const -> std::size_t {
+    const auto data = this->contents.data();
+    return static_cast<std::size_t>(
+        find_byte(data + this->position, data + this->size, c) - data);
+}
+
+/**
+ * @brief Return a view from "this->position" up until "end".
  *
  * @param end
- * @return std::string
+ * @return std::string_view
  */
-auto Text::substr(std::size_t end) const  -> std::string {
-    std::string sub;
-    for (std::size_t i = this->position; i < end; ++i) {
-        sub += this->contents[i];
-    }
-    return sub;
+auto Text::substr(std::size_t end) const -> std::string_view {
+    return this->contents.substr(this->position, end - this->position);
 }
@@ -4,7 +4,7 @@
  * @brief Construct a new Token object.
  */
 Token::Token()
-    : type(TokenType::THE_END), value(0) {
+    : type(TokenType::THE_END), offset(0), value(std::int64_t(0)) {
 }
 
 /**
@@ -18,11 +18,19 @@ auto Token::repr() const  -> std::string {
     switch (this->type) {
         case TokenType::SYMBOL:
         case TokenType::STRING:
-            repr += std::get<std::string>(this->value);
+            repr += std::get<std::string_view>(this->value);
             break;
 
         case TokenType::NUMBER:
-            repr += std::to_string(std::get<int>(this->value));
+            if (const auto number = std::get_if<std::int64_t>(&this->value)) {
+                repr += std::to_string(*number);
+            }
+            else if (const auto real = std::get_if<double>(&this->value)) {
+                repr += std::to_string(*real);
+            }
+            else {
+                repr += std::get<std::string_view>(this->value);
+            }
             break;
 
         case TokenType::LPAREN:
@@ -0,0 +1,419 @@
+#include "../include/vm.h"
+#include "../include/builtin.h"
+#include "../include/error.h"
+#include "../include/compiler.h"
+#include "../include/function.h"
+#include "../include/cache.h"
+#include "../include/profile.h"
+
+#include <string>
+
+// GCC and Clang can jump straight from one handler to the next through
+// a table of label addresses, which keeps the branch predictor happy.
+// Everything else falls back to a plain switch inside a loop. A computed
+// goto does not run destructors, so every handler keeps its locals in a
+// block of its own and only dispatches once that block has closed.
+#if defined(__GNUC__) || defined(__clang__)
+#define LISP_COMPUTED_GOTO 1
+#else
+#define LISP_COMPUTED_GOTO 0
+#endif
+
+/**
+ * @brief Read a 16-bit little-endian operand and advance "ip" past it.
+ *
+ * @param ip
+ * @return std::size_t
+ */
+static inline auto read_u16(const std::uint8_t *&ip) -> std::size_t {
+    const auto operand = static_cast<std::size_t>(ip[0] | (ip[1] << 8));
+    ip += 2;
+    return operand;
+}
+
+/**
+ * @brief Read a 32-bit little-endian operand and advance "ip" past it.
+ *
+ * @param ip
+ * @return std::uint32_t
+ */
+static inline auto read_u32(const std::uint8_t *&ip) -> std::uint32_t {
+    const auto operand = static_cast<std::uint32_t>(ip[0])
+                       | static_cast<std::uint32_t>(ip[1]) << 8
+                       | static_cast<std::uint32_t>(ip[2]) << 16
+                       | static_cast<std::uint32_t>(ip[3]) << 24;
+    ip += 4;
+    return operand;
+}
+
+/**
+ * @brief Construct a new Vm object reading and
+ *        writing global variables in "globals".
+ *
+ * @param globals
+ */
+Vm::Vm(Globals &globals)
+    : globals(globals) {
+    this->stack.reserve(256);
+}
+
+/**
+ * @brief Execute "entry" from its first instruction in the frame
+ *        "scope", null at the top level, and return the value left on
+ *        top of the stack, or the error that stopped it. Calls to user
+ *        functions are run here too, on the frame stack.
+ *
+ * @param entry
+ * @param scope
+ * @return Result<Data>
+ */
+auto Vm::run(const Chunk &entry, Ref<Env> scope) -> Result<Data> {
+    const Chunk *chunk = &entry;
+    const std::uint8_t *ip = chunk->code.data();
+
+    // values may point into the form arena, so none may outlive the run
+    // even when a builtin throws out of the middle of it. A run started
+    // by a builtin only ever touches what is above where it started.
+    // Every frame above it is a function the profiler entered too.
+    struct ClearOnExit {
+        Vm &vm;
+        std::size_t stack_base;
+        std::size_t frame_base;
+        ~ClearOnExit() {
+            if (profiling.load(std::memory_order_relaxed)) {
+                for (auto i = frame_base; i < vm.frames.size(); ++i) {
+                    leave_frame();
+                }
+            }
+            vm.stack.resize(stack_base);
+            vm.frames.erase(vm.frames.begin() + static_cast<std::ptrdiff_t>(frame_base), vm.frames.end());
+        }
+    } clear_on_exit {*this, this->stack.size(), this->frames.size()};
+
+    // "scope" is the frame of the innermost let or function being
+    // run, null at the top level, and this is the function being run
+    Ref<Function> running;
+
+    // call "fn" on the values above stack[base] where they lie, then
+    // replace everything from stack[base - drop] up with its result;
+    // gives false if it raised an error, which stops the run
+    const auto call = [this](BuiltinFn fn, std::size_t base, std::size_t drop) -> bool {
+        auto result = call_builtin(fn, Args(this->stack.data() + base, this->stack.size() - base));
+        this->stack.resize(base - drop);
+        this->stack.push_back(std::move(result));
+        return raised_error == nullptr;
+    };
+
+    // start running the closure sitting below the arguments above
+    // stack[base] in a new frame holding them, replacing the current
+    // function; the caller saves the current one first unless it is
+    // a tail call, which leaves the current one for the profiler too.
+    // Gives false with an error raised if the arguments don't fit
+    const auto enter = [&](std::size_t base, bool tail) -> bool {
+        const auto closure = this->stack[base - 1].closure;
+        const auto argc = this->stack.size() - base;
+        auto function = Ref<Function>::share(closure->function);
+
+        if (profiling.load(std::memory_order_relaxed)) [[unlikely]] {
+            if (tail) {
+                leave_frame();
+            }
+            enter_frame(function_frame(*function));
+        }
+
+        if (argc != function->arity) {
+            fail(ErrorCode::ARITY, "Expected ", std::to_string(function->arity),
+                 " arguments but got ", std::to_string(argc));
+            return false;
+        }
+
+        auto env = Ref<Env>(Env::make(argc, closure->env));
+        for (std::size_t i = 0; i < argc; ++i) {
+            env->slots()[i] = this->stack[base + i].persist();
+        }
+        this->stack.resize(base - 1);
+
+        chunk = function->compiled.load(std::memory_order_acquire) ? &function->chunk
+                                                                   : &function_chunk(*function);
+        ip = chunk->code.data();
+        scope = std::move(env);
+        running = std::move(function);
+        return true;
+    };
+
+    // builtins and globals raise their errors, which are looked at after
+    // each of them; only compiling a function the first time it is called
+    // still throws. Like the switch below, the try does not indent the handlers
+    try {
+#if LISP_COMPUTED_GOTO
+    static const void *const dispatch_table[] {
+        &&op_push_const,
+        &&op_call_builtin,
+        &&op_call_dynamic,
+        &&op_return,
+        &&op_pop,
+        &&op_load_global,
+        &&op_define_global,
+        &&op_set_global,
+        &&op_load_local,
+        &&op_set_local,
+        &&op_enter_scope,
+        &&op_leave_scope,
+        &&op_jump,
+        &&op_jump_if_false,
+        &&op_make_closure,
+        &&op_tail_call,
+        &&op_call_binary,
+    };
+#define DISPATCH() goto *dispatch_table[*ip++]
+#define CASE(label, op) label:
+    DISPATCH();
+#else
+#define DISPATCH() continue
+#define CASE(label, op) case op:
+    for (;;) switch (static_cast<OpCode>(*ip++)) {
+#endif
+
+    CASE(op_push_const, OpCode::PUSH_CONST) {
+        this->stack.push_back(chunk->constants[read_u16(ip)]);
+    }
+    DISPATCH();
+
+    CASE(op_call_builtin, OpCode::CALL_BUILTIN) {
+        const auto fn = chunk->functions[read_u16(ip)];
+        const auto argc = read_u16(ip);
+        if (!call(fn, this->stack.size() - argc, 0)) {
+            goto fail;
+        }
+    }
+    DISPATCH();
+
+    CASE(op_call_dynamic, OpCode::CALL_DYNAMIC) {
+        const auto argc = read_u16(ip);
+        auto &cache = chunk->caches[read_u16(ip)];
+        const auto base = this->stack.size() - argc;
+        const auto &head = this->stack[base - 1];
+
+        if (head.type == DataType::CLOSURE) {
+            if (this->frames.size() == MAX_CALL_DEPTH) [[unlikely]] {
+                fail(ErrorCode::LIMIT, "Maximum recursion depth exceeded");
+                goto fail;
+            }
+            this->frames.push_back(Frame {chunk, ip, std::move(scope), std::move(running)});
+            if (!enter(base, false)) {
+                goto fail;
+            }
+        }
+        else {
+            const auto fn = lookup_cached(cache, head);
+            if (fn == nullptr) {
+                fail(ErrorCode::NAME, "Tried to call an unknown function and failed!");
+                goto fail;
+            }
+            if (!call(fn, base, 1)) {
+                goto fail;
+            }
+        }
+    }
+    DISPATCH();
+
+    CASE(op_return, OpCode::RETURN) {
+        if (this->frames.size() == clear_on_exit.frame_base) {
+            return std::move(this->stack.back());
+        }
+
+        // the result is already where the callee was
+        auto &frame = this->frames.back();
+        chunk = frame.chunk;
+        ip = frame.ip;
+        scope = std::move(frame.scope);
+        running = std::move(frame.function);
+        this->frames.pop_back();
+
+        if (profiling.load(std::memory_order_relaxed)) [[unlikely]] {
+            leave_frame();
+        }
+    }
+    DISPATCH();
+
+    CASE(op_pop, OpCode::POP) {
+        this->stack.pop_back();
+    }
+    DISPATCH();
+
+    CASE(op_load_global, OpCode::LOAD_GLOBAL) {
+        this->stack.push_back(this->globals.get(read_u32(ip)));
+    }
+    DISPATCH();
+
+    CASE(op_define_global, OpCode::DEFINE_GLOBAL) {
+        auto &value = this->stack.back();
+        value = value.persist();
+        this->globals.define(read_u32(ip), value);
+        if (raised_error != nullptr) [[unlikely]] {
+            goto fail;
+        }
+    }
+    DISPATCH();
+
+    CASE(op_set_global, OpCode::SET_GLOBAL) {
+        auto &value = this->stack.back();
+        value = value.persist();
+        this->globals.assign(read_u32(ip), value);
+        if (raised_error != nullptr) [[unlikely]] {
+            goto fail;
+        }
+    }
+    DISPATCH();
+
+    CASE(op_load_local, OpCode::LOAD_LOCAL) {
+        const auto depth = read_u16(ip);
+        this->stack.push_back(scope->at(depth, read_u16(ip)));
+    }
+    DISPATCH();
+
+    CASE(op_set_local, OpCode::SET_LOCAL) {
+        const auto depth = read_u16(ip);
+        auto &value = this->stack.back();
+        value = value.persist();
+        scope->assign_at(depth, read_u16(ip), value);
+        if (raised_error != nullptr) [[unlikely]] {
+            goto fail;
+        }
+    }
+    DISPATCH();
+
+    CASE(op_enter_scope, OpCode::ENTER_SCOPE) {
+        const auto count = read_u16(ip);
+        const auto base = this->stack.size() - count;
+        auto env = Ref<Env>(Env::make(count, scope.get()));
+
+        for (std::size_t i = 0; i < count; ++i) {
+            env->slots()[i] = this->stack[base + i].persist();
+        }
+        this->stack.resize(base);
+        scope = std::move(env);
+    }
+    DISPATCH();
+
+    CASE(op_leave_scope, OpCode::LEAVE_SCOPE) {
+        scope = Ref<Env>::share(scope->parent);
+    }
+    DISPATCH();
+
+    CASE(op_jump, OpCode::JUMP) {
+        ip = chunk->code.data() + read_u32(ip);
+    }
+    DISPATCH();
+
+    CASE(op_jump_if_false, OpCode::JUMP_IF_FALSE) {
+        const auto target = read_u32(ip);
+        if (!this->stack.back().is_truthy()) {
+            ip = chunk->code.data() + target;
+        }
+        this->stack.pop_back();
+    }
+    DISPATCH();
+
+    CASE(op_make_closure, OpCode::MAKE_CLOSURE) {
+        const auto function = chunk->lambdas[read_u16(ip)];
+        this->stack.push_back(Data::from_closure(Closure::make(function, scope.get())));
+    }
+    DISPATCH();
+
+    CASE(op_tail_call, OpCode::TAIL_CALL) {
+        const auto argc = read_u16(ip);
+        auto &cache = chunk->caches[read_u16(ip)];
+        const auto base = this->stack.size() - argc;
+        const auto &head = this->stack[base - 1];
+
+        // a builtin in tail position returns through the
+        // instructions that follow, exactly like a normal call
+        if (head.type == DataType::CLOSURE) {
+            if (!enter(base, true)) {
+                goto fail;
+            }
+        }
+        else {
+            const auto fn = lookup_cached(cache, head);
+            if (fn == nullptr) {
+                fail(ErrorCode::NAME, "Tried to call an unknown function and failed!");
+                goto fail;
+            }
+            if (!call(fn, base, 1)) {
+                goto fail;
+            }
+        }
+    }
+    DISPATCH();
+
+    CASE(op_call_binary, OpCode::CALL_BINARY) {
+        const auto fn = chunk->functions[read_u16(ip)];
+        auto &cache = chunk->caches[read_u16(ip)];
+        const auto base = this->stack.size() - 2;
+        auto &lhs = this->stack[base];
+
+        // the profiler has to see the builtin being called
+        if (profiling.load(std::memory_order_relaxed) || !try_binary(cache, lhs, this->stack[base + 1], lhs)) {
+            if (!call(fn, base, 0)) {
+                goto fail;
+            }
+        }
+        else {
+            this->stack.pop_back();
+        }
+    }
+    DISPATCH();
+
+#if !LISP_COMPUTED_GOTO
+    }
+#endif
+    }
+    catch (Error &err) {
+        raise_error(std::move(err));
+    }
+
+    // the error happened at the call or assignment being run
+fail:
+    auto failure = take_raised_error();
+    if (const auto offset = chunk->source_of(static_cast<std::size_t>(ip - chunk->code.data()))) {
+        failure.locate(*offset);
+    }
+    return failure;
+#undef DISPATCH
+#undef CASE
+}
+
+/**
+ * @brief Call "closure" with "args" and return its result. Used by
+ *        builtins that take a function, from inside of a run or not,
+ *        so errors are raised the way builtins raise their own.
+ *
+ * @param closure
+ * @param args
+ * @return Data
+ */
+auto Vm::call(const Closure &closure, Args args) -> Data {
+    auto &function = *closure.function;
+
+    if (args.size() != function.arity) {
+        return fail(ErrorCode::ARITY, "Expected ", std::to_string(function.arity),
+                    " arguments but got ", std::to_string(args.size()));
+    }
+
+    const ProfileFrame profiled(function_frame(function));
+    auto env = Ref<Env>(Env::make(args.size(), closure.env));
+    for (std::size_t i = 0; i < args.size(); ++i) {
+        env->slots()[i] = args[i].persist();
+    }
+
+    // the caller holds the closure, which keeps the function alive
+    const auto &chunk = function.compiled.load(std::memory_order_acquire) ? function.chunk
+                                                                          : function_chunk(function);
+    auto result = this->run(chunk, std::move(env));
+    if (!result.ok()) {
+        raise_error(std::move(result.error()));
+        return Data();
+    }
+    return std::move(result.value());
+}